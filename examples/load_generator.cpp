@@ -0,0 +1,298 @@
+#include <iostream>
+
+#include <tamed/request_statistics.h>
+#include <boost/asio/connect.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/ssl.hpp>
+#include <boost/asio/strand.hpp>
+#include <boost/beast/core.hpp>
+#include <boost/beast/http.hpp>
+#include <boost/beast/ssl.hpp>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <deque>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+/**
+ *  The settings for a run, and the results it collected
+ */
+struct load
+{
+    std::string                             host        { "127.0.0.1"   };  // the address of the server
+    std::string                             port        { "8080"        };  // the port of the server
+    std::string                             target      { "/"           };  // the target to request
+    std::size_t                             connections { 16            };  // the number of connections to open
+    std::size_t                             depth       { 1             };  // the number of requests in flight per connection
+    std::size_t                             threads     { 1             };  // the number of threads to run the connections on
+    std::chrono::seconds                    duration    { 10            };  // the time to send requests for
+    bool                                    tls         { false         };  // whether to connect with TLS
+
+    std::string                             request;                        // the serialized request to send
+    std::chrono::steady_clock::time_point   deadline;                       // the time after which no more requests are sent
+    tamed::latency_histogram                latency;                        // the time until each response arrived
+    std::atomic<std::size_t>                responses   { 0 };              // the number of responses received
+    std::atomic<std::size_t>                failures    { 0 };              // the number of responses without a 2xx status
+    std::atomic<std::size_t>                errors      { 0 };              // the number of connections that failed
+};
+
+/**
+ *  A keep-alive connection that sends requests
+ *  until the deadline, with a fixed number of
+ *  requests in flight
+ */
+template <typename stream_type>
+class client : public std::enable_shared_from_this<client<stream_type>>
+{
+    public:
+        /**
+         *  Constructor
+         *
+         *  @param  run         The settings and results of the run
+         *  @param  parameters  The arguments for constructing the stream
+         */
+        template <typename... arguments>
+        client(load& run, arguments&&... parameters) :
+            _run{ run },
+            _stream{ std::forward<arguments>(parameters)... }
+        {}
+
+        /**
+         *  Connect to the server and start sending
+         *
+         *  @param  endpoints   The resolved addresses of the server
+         */
+        void start(const boost::asio::ip::tcp::resolver::results_type& endpoints)
+        {
+            boost::asio::async_connect(boost::beast::get_lowest_layer(_stream), endpoints, [self = this->shared_from_this()](const boost::system::error_code& ec, const auto&) {
+                // did we manage to connect?
+                if (ec) {
+                    return self->fail(ec);
+                }
+
+                // do we need to secure the connection first?
+                if constexpr (std::is_same_v<stream_type, boost::beast::ssl_stream<boost::asio::ip::tcp::socket>>) {
+                    self->_stream.async_handshake(boost::asio::ssl::stream_base::client, [self](const boost::system::error_code& ec) {
+                        // did the handshake fail?
+                        if (ec) {
+                            return self->fail(ec);
+                        }
+
+                        // fill the pipeline
+                        self->send();
+                    });
+                } else {
+                    // fill the pipeline
+                    self->send();
+                }
+            });
+        }
+    private:
+        /**
+         *  Send requests until the pipeline is full
+         */
+        void send()
+        {
+            // queue a request for every place in the pipeline
+            _queued = _run.depth;
+
+            // write the requests, and wait for the responses
+            write();
+            read();
+        }
+
+        /**
+         *  Write the queued requests, unless
+         *  a write is already in progress
+         */
+        void write()
+        {
+            // requests are written one batch at a time
+            if (_writing || _queued == 0) {
+                return;
+            }
+
+            // the time the requests are sent
+            auto now = std::chrono::steady_clock::now();
+
+            // write all the queued requests together
+            _outgoing.clear();
+            for (; _queued != 0; --_queued) {
+                _outgoing.append(_run.request);
+                _sent.push_back(now);
+            }
+
+            // send the requests
+            _writing = true;
+            boost::asio::async_write(_stream, boost::asio::buffer(_outgoing), [self = this->shared_from_this()](const boost::system::error_code& ec, std::size_t) {
+                // did the write fail?
+                if (ec) {
+                    return self->fail(ec);
+                }
+
+                // write the requests queued in the meantime
+                self->_writing = false;
+                self->write();
+            });
+        }
+
+        /**
+         *  Read the response to the oldest request
+         */
+        void read()
+        {
+            // start with an empty response
+            _response = {};
+
+            boost::beast::http::async_read(_stream, _buffer, _response, [self = this->shared_from_this()](const boost::system::error_code& ec, std::size_t) {
+                // did the read fail?
+                if (ec) {
+                    return self->fail(ec);
+                }
+
+                // the response answers the oldest request
+                auto now = std::chrono::steady_clock::now();
+                self->_run.latency.record(now - self->_sent.front());
+                self->_sent.pop_front();
+
+                // count the response
+                self->_run.responses.fetch_add(1, std::memory_order_relaxed);
+                if (self->_response.result_int() / 100 != 2) {
+                    self->_run.failures.fetch_add(1, std::memory_order_relaxed);
+                }
+
+                // replace the request until the run is over
+                if (now < self->_run.deadline) {
+                    ++self->_queued;
+                    self->write();
+                }
+
+                // wait for the responses still in flight
+                if (!self->_sent.empty() || self->_queued != 0) {
+                    self->read();
+                }
+            });
+        }
+
+        /**
+         *  Give up on the connection after an error
+         *
+         *  @param  ec  The error that occurred
+         */
+        void fail(const boost::system::error_code& ec)
+        {
+            // the connection is no longer used, all pending
+            // operations release it when they complete
+            std::cerr << "Connection failed: " << ec.message() << std::endl;
+            _run.errors.fetch_add(1, std::memory_order_relaxed);
+
+            // the error code from closing, which we ignore
+            boost::system::error_code error;
+            boost::beast::get_lowest_layer(_stream).close(error);
+        }
+
+        load&                                                           _run;               // the settings and results of the run
+        stream_type                                                     _stream;            // the stream connected to the server
+        boost::beast::flat_buffer                                       _buffer;            // the buffer to read responses into
+        boost::beast::http::response<boost::beast::http::string_body>   _response;          // the response being read
+        std::string                                                     _outgoing;          // the requests being written
+        std::deque<std::chrono::steady_clock::time_point>               _sent;              // the time every request in flight was sent
+        std::size_t                                                     _queued{ 0 };       // the number of requests waiting to be written
+        bool                                                            _writing{ false };  // is a write in progress
+};
+
+/**
+ *  Parse the command line
+ *
+ *  @param  run     The settings to update
+ *  @param  argc    The number of arguments
+ *  @param  argv    The arguments, in --name=value form
+ *  @return Whether the arguments were valid
+ */
+bool parse(load& run, int argc, char** argv)
+{
+    // go over every argument
+    for (int index{ 1 }; index < argc; ++index) {
+        // split the name from the value
+        std::string argument{ argv[index] };
+        auto separator  = argument.find('=');
+        auto name       = argument.substr(0, separator);
+        auto value      = separator == std::string::npos ? std::string{} : argument.substr(separator + 1);
+
+        // update the setting with the name
+        if      (name == "--host")          { run.host          = value; }
+        else if (name == "--port")          { run.port          = value; }
+        else if (name == "--target")        { run.target        = value; }
+        else if (name == "--connections")   { run.connections   = std::strtoull(value.c_str(), nullptr, 10); }
+        else if (name == "--depth")         { run.depth         = std::strtoull(value.c_str(), nullptr, 10); }
+        else if (name == "--threads")       { run.threads       = std::strtoull(value.c_str(), nullptr, 10); }
+        else if (name == "--duration")      { run.duration      = std::chrono::seconds{ std::strtoll(value.c_str(), nullptr, 10) }; }
+        else if (name == "--tls")           { run.tls           = true; }
+        else                                { return false; }
+    }
+
+    // we need something to run
+    return run.connections != 0 && run.depth != 0 && run.threads != 0;
+}
+
+
+int main(int argc, char** argv)
+{
+    using plain_client  = client<boost::asio::ip::tcp::socket>;
+    using tls_client    = client<boost::beast::ssl_stream<boost::asio::ip::tcp::socket>>;
+
+    load run;
+
+    if (!parse(run, argc, argv)) {
+        std::cerr << "Usage: " << argv[0] << " [--host=127.0.0.1] [--port=8080] [--target=/] [--connections=16] [--depth=1] [--threads=1] [--duration=10] [--tls]" << std::endl;
+        return 1;
+    }
+
+    boost::asio::io_context         context     {                                                   };
+    boost::asio::ssl::context       tls         { boost::asio::ssl::context::tls_client             };
+    boost::asio::ip::tcp::resolver  resolver    { context                                           };
+    auto                            endpoints   { resolver.resolve(run.host, run.port)              };
+    std::vector<std::thread>        threads     {                                                   };
+
+    // the request to send over and over, the server is not verified
+    run.request = "GET " + run.target + " HTTP/1.1\r\nHost: " + run.host + "\r\nUser-Agent: tamed-load-generator\r\n\r\n";
+    tls.set_verify_mode(boost::asio::ssl::verify_none);
+
+    // the run starts now
+    auto start      = std::chrono::steady_clock::now();
+    run.deadline    = start + run.duration;
+
+    // open the connections, each on its own strand
+    for (std::size_t index{ 0 }; index < run.connections; ++index) {
+        if (run.tls) {
+            std::make_shared<tls_client>(run, boost::asio::make_strand(context), tls)->start(endpoints);
+        } else {
+            std::make_shared<plain_client>(run, boost::asio::make_strand(context))->start(endpoints);
+        }
+    }
+
+    // run until every connection is done
+    for (std::size_t index{ 1 }; index < run.threads; ++index) {
+        threads.emplace_back([&context]() { context.run(); });
+    }
+
+    context.run();
+
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    // the time it took to get all the responses
+    auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::cout << "connections:  " << run.connections << (run.tls ? " tls" : " plain") << ", depth " << run.depth << ", " << run.threads << " threads\n"
+              << "responses:    " << run.responses << " in " << elapsed << "s, " << run.responses / elapsed << " requests/s\n"
+              << "failures:     " << run.failures << " responses without 2xx, " << run.errors << " connection errors\n"
+              << "latency:      p50 " << run.latency.percentile(0.5).count() << "us, p99 " << run.latency.percentile(0.99).count() << "us, p99.9 " << run.latency.percentile(0.999).count() << "us" << std::endl;
+
+    return run.errors == 0 ? 0 : 1;
+}
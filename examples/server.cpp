@@ -2,6 +2,7 @@
 
 #include <tamed/server.h>
 #include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/signal_set.hpp>
 
 
 void handle_slash(tamed::connection connection, boost::beast::http::request<boost::beast::http::string_body>&& request)
@@ -34,17 +35,19 @@ int main()
 
     using server_type = tamed::server<server_config>;
 
-    boost::asio::io_context         io_context  {                                                   };
-    server_type                     server      { io_context                                        };
+    tamed::runner                   runner      {                                                   };
+    server_type                     server      { runner                                            };
     boost::asio::ip::tcp::endpoint  endpoint    { boost::asio::ip::make_address("127.0.0.1"), 8080  };
+    boost::asio::signal_set         signals     { runner.get_executors().front(), SIGINT, SIGTERM   };
 
     server.add<handle_slash>(boost::beast::http::verb::get, "/");
     server.add<handle_slash>(boost::beast::http::verb::get, "");
 
     server.set_not_found<handle_not_found>();
 
-    server.listen(endpoint);
-    io_context.run();
+    server.listen_sharded(endpoint);
+    signals.async_wait([&runner](const boost::system::error_code&, int) { runner.stop(); });
+    runner.run();
 
     return 0;
 }
@@ -0,0 +1,150 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+
+namespace tamed {
+
+    /**
+     *  Statistics on the number of connections accepted
+     *  each time an acceptor became readable.
+     *
+     *  The batch sizes are collected in power-of-two buckets,
+     *  bucket N counts the wakeups that accepted between 2^(N-1)
+     *  and 2^N - 1 connections (bucket 0 counts empty wakeups).
+     */
+    class accept_statistics
+    {
+        public:
+            /**
+             *  The number of buckets, the last bucket
+             *  also holds all larger batches
+             */
+            constexpr const static std::size_t bucket_count = 12;
+
+            /**
+             *  Constructor
+             */
+            accept_statistics() noexcept = default;
+
+            /**
+             *  Copy constructor
+             *
+             *  @param  that    The statistics to copy
+             */
+            accept_statistics(const accept_statistics& that) noexcept
+            {
+                // add all the counters
+                *this += that;
+            }
+
+            /**
+             *  Record the result of a wakeup
+             *
+             *  @param  accepted    The number of connections accepted
+             */
+            void record(std::size_t accepted) noexcept
+            {
+                // find the bucket for the batch size
+                std::size_t bucket{ 0 };
+
+                // every bucket holds double the batch sizes
+                while (accepted >> bucket != 0 && bucket < bucket_count - 1) {
+                    ++bucket;
+                }
+
+                // update the counters, they are only written
+                // from the executor running the acceptor
+                _batches[bucket].fetch_add(1, std::memory_order_relaxed);
+                _accepted.fetch_add(accepted, std::memory_order_relaxed);
+            }
+
+            /**
+             *  Record that the acceptor stopped accepting,
+             *  because the connection limit was reached
+             */
+            void record_pause() noexcept
+            {
+                _pauses.fetch_add(1, std::memory_order_relaxed);
+            }
+
+            /**
+             *  Add the counters from other statistics
+             *
+             *  @param  that    The statistics to add
+             *  @return Same object for chaining
+             */
+            accept_statistics& operator+=(const accept_statistics& that) noexcept
+            {
+                // add all the buckets
+                for (std::size_t bucket{ 0 }; bucket < bucket_count; ++bucket) {
+                    // add the number of batches in the bucket
+                    _batches[bucket].fetch_add(that.batches(bucket), std::memory_order_relaxed);
+                }
+
+                // add the number of accepted connections and pauses
+                _accepted.fetch_add(that.accepted(), std::memory_order_relaxed);
+                _pauses.fetch_add(that.pauses(), std::memory_order_relaxed);
+                return *this;
+            }
+
+            /**
+             *  Retrieve the number of wakeups in a bucket
+             *
+             *  @param  bucket  The bucket to retrieve
+             *  @return The number of wakeups with a batch size in the bucket
+             */
+            std::uint64_t batches(std::size_t bucket) const noexcept
+            {
+                return _batches[bucket].load(std::memory_order_relaxed);
+            }
+
+            /**
+             *  Retrieve the total number of wakeups
+             *
+             *  @return The number of times the acceptor became readable
+             */
+            std::uint64_t wakeups() const noexcept
+            {
+                // the total over all buckets
+                std::uint64_t result{ 0 };
+
+                // add all the buckets together
+                for (std::size_t bucket{ 0 }; bucket < bucket_count; ++bucket) {
+                    // add the batches in this bucket
+                    result += batches(bucket);
+                }
+
+                // return the total
+                return result;
+            }
+
+            /**
+             *  Retrieve the total number of accepted connections
+             *
+             *  @return The number of connections accepted
+             */
+            std::uint64_t accepted() const noexcept
+            {
+                return _accepted.load(std::memory_order_relaxed);
+            }
+
+            /**
+             *  Retrieve the number of pauses
+             *
+             *  @return The number of times accepting stopped at the connection limit
+             */
+            std::uint64_t pauses() const noexcept
+            {
+                return _pauses.load(std::memory_order_relaxed);
+            }
+        private:
+            std::array<std::atomic<std::uint64_t>, bucket_count>    _batches    {};     // the number of wakeups per bucket
+            std::atomic<std::uint64_t>                              _accepted   { 0 };  // the total number of accepted connections
+            std::atomic<std::uint64_t>                              _pauses     { 0 };  // the number of times accepting was paused
+    };
+
+}
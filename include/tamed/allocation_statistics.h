@@ -0,0 +1,117 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+
+namespace tamed {
+
+    /**
+     *  Statistics on how well the storage for new
+     *  connections on an executor is recycled
+     */
+    class allocation_statistics
+    {
+        public:
+            /**
+             *  Constructor
+             */
+            allocation_statistics() noexcept = default;
+
+            /**
+             *  Copy constructor
+             *
+             *  @param  that    The statistics to copy
+             */
+            allocation_statistics(const allocation_statistics& that) noexcept
+            {
+                // add all the counters
+                *this += that;
+            }
+
+            /**
+             *  Record the storage taken for a connection
+             *
+             *  @param  recycled    Whether the storage came from the pool
+             */
+            void record_connection(bool recycled) noexcept
+            {
+                // update the counter, they are written from
+                // the acceptors, so they may be contended
+                (recycled ? _connections_recycled : _connections_allocated).fetch_add(1, std::memory_order_relaxed);
+            }
+
+            /**
+             *  Record the read buffer taken for a connection
+             *
+             *  @param  recycled    Whether the buffer came from the pool
+             */
+            void record_buffer(bool recycled) noexcept
+            {
+                // update the counter
+                (recycled ? _buffers_recycled : _buffers_allocated).fetch_add(1, std::memory_order_relaxed);
+            }
+
+            /**
+             *  Add the counters from other statistics
+             *
+             *  @param  that    The statistics to add
+             *  @return Same object for chaining
+             */
+            allocation_statistics& operator+=(const allocation_statistics& that) noexcept
+            {
+                // add the counters
+                _connections_recycled.fetch_add(that.connections_recycled(), std::memory_order_relaxed);
+                _connections_allocated.fetch_add(that.connections_allocated(), std::memory_order_relaxed);
+                _buffers_recycled.fetch_add(that.buffers_recycled(), std::memory_order_relaxed);
+                _buffers_allocated.fetch_add(that.buffers_allocated(), std::memory_order_relaxed);
+                return *this;
+            }
+
+            /**
+             *  Retrieve the number of connections created in recycled storage
+             *
+             *  @return The number of connections that did not allocate
+             */
+            std::uint64_t connections_recycled() const noexcept
+            {
+                return _connections_recycled.load(std::memory_order_relaxed);
+            }
+
+            /**
+             *  Retrieve the number of connections created in new storage
+             *
+             *  @return The number of connections that allocated
+             */
+            std::uint64_t connections_allocated() const noexcept
+            {
+                return _connections_allocated.load(std::memory_order_relaxed);
+            }
+
+            /**
+             *  Retrieve the number of recycled read buffers
+             *
+             *  @return The number of connections that reused a buffer
+             */
+            std::uint64_t buffers_recycled() const noexcept
+            {
+                return _buffers_recycled.load(std::memory_order_relaxed);
+            }
+
+            /**
+             *  Retrieve the number of new read buffers
+             *
+             *  @return The number of connections that started with an empty buffer
+             */
+            std::uint64_t buffers_allocated() const noexcept
+            {
+                return _buffers_allocated.load(std::memory_order_relaxed);
+            }
+        private:
+            std::atomic<std::uint64_t>  _connections_recycled   { 0 };  // the connections created in recycled storage
+            std::atomic<std::uint64_t>  _connections_allocated  { 0 };  // the connections created in new storage
+            std::atomic<std::uint64_t>  _buffers_recycled       { 0 };  // the recycled read buffers
+            std::atomic<std::uint64_t>  _buffers_allocated      { 0 };  // the new read buffers
+    };
+
+}
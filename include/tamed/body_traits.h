@@ -0,0 +1,99 @@
+#pragma once
+
+#include <boost/beast/http/basic_dynamic_body.hpp>
+#include <boost/beast/http/basic_file_body.hpp>
+#include <boost/beast/http/empty_body.hpp>
+#include <boost/beast/http/span_body.hpp>
+#include <boost/beast/http/string_body.hpp>
+#include <boost/beast/http/vector_body.hpp>
+#include <type_traits>
+#include <utility>
+
+
+namespace tamed {
+
+    /**
+     *  Fallback struct for a body value that cannot
+     *  be cleared while keeping its storage
+     */
+    template <typename T, typename = void>
+    struct has_reusable_storage : std::false_type {};
+
+    /**
+     *  Structure matching on body values that can be
+     *  cleared while keeping their allocated capacity,
+     *  like strings and vectors
+     */
+    template <typename T>
+    struct has_reusable_storage<T, std::void_t<
+        // remove the contents
+        decltype(std::declval<T&>().clear()),
+
+        // retrieve the allocated capacity
+        decltype(std::declval<const T&>().capacity())
+    >> : std::true_type {};
+
+    /**
+     *  Value alias for the trait
+     */
+    template <typename T>
+    constexpr bool has_reusable_storage_v = has_reusable_storage<T>::value;
+
+    /**
+     *  Fallback struct for a body that may need several
+     *  visits of the serializer to produce all its data
+     */
+    template <typename T>
+    struct is_single_batch_body : std::false_type {};
+
+    /**
+     *  Bodies that hand all their data to the serializer
+     *  at once, so the header and the complete body are
+     *  produced by a single visit
+     */
+    template <typename T, typename traits, typename allocator>
+    struct is_single_batch_body<boost::beast::http::basic_string_body<T, traits, allocator>> : std::true_type {};
+
+    template <typename T, typename allocator>
+    struct is_single_batch_body<boost::beast::http::vector_body<T, allocator>> : std::true_type {};
+
+    template <typename T>
+    struct is_single_batch_body<boost::beast::http::span_body<T>> : std::true_type {};
+
+    template <typename buffer_type>
+    struct is_single_batch_body<boost::beast::http::basic_dynamic_body<buffer_type>> : std::true_type {};
+
+    template <>
+    struct is_single_batch_body<boost::beast::http::empty_body> : std::true_type {};
+
+    /**
+     *  Value alias for the trait
+     */
+    template <typename T>
+    constexpr bool is_single_batch_body_v = is_single_batch_body<T>::value;
+
+    /**
+     *  Fallback struct for a body that is
+     *  not backed by a file descriptor
+     */
+    template <typename T, typename = void>
+    struct is_file_body : std::false_type {};
+
+    /**
+     *  Structure matching on file bodies that give
+     *  access to their file descriptor, so that the
+     *  kernel can send the data without copying it
+     */
+    template <typename file_type>
+    struct is_file_body<boost::beast::http::basic_file_body<file_type>, std::enable_if_t<
+        // retrieve the file descriptor
+        std::is_same_v<decltype(std::declval<const file_type&>().native_handle()), int>
+    >> : std::true_type {};
+
+    /**
+     *  Value alias for the trait
+     */
+    template <typename T>
+    constexpr bool is_file_body_v = is_file_body<T>::value;
+
+}
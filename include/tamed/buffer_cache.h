@@ -0,0 +1,188 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <utility>
+
+
+namespace tamed {
+
+    /**
+     *  Keeps the largest buffer that was released, so
+     *  that output that is produced over and over, like
+     *  the metrics, can reuse the storage of the last
+     *  output instead of allocating it again
+     *
+     *  Buffers may be released on any thread.
+     */
+    class buffer_cache
+    {
+        public:
+            /**
+             *  Constructor
+             */
+            buffer_cache() noexcept = default;
+
+            /**
+             *  The cache cannot be copied
+             */
+            buffer_cache(const buffer_cache&) = delete;
+
+            /**
+             *  Destructor
+             */
+            ~buffer_cache()
+            {
+                // free the buffer, if we have one
+                ::operator delete(_buffer);
+            }
+
+            /**
+             *  Allocate a buffer
+             *
+             *  @param  size    The number of bytes to allocate
+             *  @return Pointer to the allocated memory
+             *  @throws std::bad_alloc
+             */
+            void* allocate(std::size_t size)
+            {
+                // take the cached buffer, if it is large enough
+                {
+                    std::lock_guard lock{ _mutex };
+
+                    if (_buffer != nullptr && _size >= size) {
+                        // the buffer is no longer cached
+                        _size = 0;
+                        return std::exchange(_buffer, nullptr);
+                    }
+                }
+
+                // allocate a new buffer
+                return ::operator new(size);
+            }
+
+            /**
+             *  Release a buffer, keeping it if it is
+             *  larger than the buffer already cached
+             *
+             *  @param  pointer The memory to release
+             *  @param  size    The number of bytes that were requested
+             */
+            void deallocate(void* pointer, std::size_t size) noexcept
+            {
+                // the buffer that is no longer needed
+                void* unused{ pointer };
+
+                // keep the larger of the two buffers
+                {
+                    std::lock_guard lock{ _mutex };
+
+                    if (_buffer == nullptr || _size < size) {
+                        // cache the released buffer instead
+                        std::swap(unused, _buffer);
+                        _size = size;
+                    }
+                }
+
+                // a buffer may have been handed out larger than its
+                // requested size, so we cannot use a sized delete
+                ::operator delete(unused);
+            }
+        private:
+            std::mutex  _mutex;                 // the lock protecting the buffer
+            void*       _buffer{ nullptr };     // the cached buffer
+            std::size_t _size{ 0 };             // the size of the cached buffer
+    };
+
+    /**
+     *  Allocator taking its memory from a buffer cache
+     */
+    template <typename T>
+    class buffer_cache_allocator
+    {
+        public:
+            using value_type = T;
+
+            /**
+             *  Constructor
+             *
+             *  @param  cache   The cache to allocate from
+             */
+            buffer_cache_allocator(std::shared_ptr<buffer_cache> cache) noexcept :
+                _cache{ std::move(cache) }
+            {}
+
+            /**
+             *  Constructor
+             *
+             *  @param  that    The allocator to rebind
+             */
+            template <typename U>
+            buffer_cache_allocator(const buffer_cache_allocator<U>& that) noexcept :
+                _cache{ that.get_cache() }
+            {}
+
+            /**
+             *  Retrieve the cache
+             *
+             *  @return The cache the memory comes from
+             */
+            const std::shared_ptr<buffer_cache>& get_cache() const noexcept
+            {
+                return _cache;
+            }
+
+            /**
+             *  Allocate memory for objects
+             *
+             *  @param  count   The number of objects to allocate
+             *  @return Pointer to the allocated memory
+             *  @throws std::bad_alloc
+             */
+            T* allocate(std::size_t count)
+            {
+                // the buffers come from operator new, which only guarantees this alignment
+                static_assert(alignof(T) <= __STDCPP_DEFAULT_NEW_ALIGNMENT__);
+
+                return static_cast<T*>(_cache->allocate(sizeof(T) * count));
+            }
+
+            /**
+             *  Deallocate memory
+             *
+             *  @param  pointer The memory to deallocate
+             *  @param  count   The number of objects that were allocated
+             */
+            void deallocate(T* pointer, std::size_t count) noexcept
+            {
+                _cache->deallocate(pointer, sizeof(T) * count);
+            }
+
+            /**
+             *  Compare allocators
+             *
+             *  @return Whether memory from one can be deallocated by the other
+             */
+            template <typename U>
+            bool operator==(const buffer_cache_allocator<U>& that) const noexcept
+            {
+                return _cache == that.get_cache();
+            }
+
+            /**
+             *  Compare allocators
+             *
+             *  @return Whether memory from one cannot be deallocated by the other
+             */
+            template <typename U>
+            bool operator!=(const buffer_cache_allocator<U>& that) const noexcept
+            {
+                return _cache != that.get_cache();
+            }
+        private:
+            std::shared_ptr<buffer_cache>   _cache;     // the cache the memory comes from
+    };
+
+}
@@ -0,0 +1,165 @@
+#pragma once
+
+#include <array>
+#include <cctype>
+#include <string_view>
+#include "data_source.h"
+
+
+namespace tamed {
+
+    /**
+     *  Data source for a response that was serialized
+     *  before, for example when the server starts. The
+     *  data is not copied and must stay valid until it
+     *  is written.
+     */
+    class buffer_data_source : public data_source
+    {
+        public:
+            /**
+             *  Constructor
+             *
+             *  @param  data    The serialized response to send
+             */
+            buffer_data_source(std::string_view data) noexcept :
+                _parts{ { { data.data(), data.size() }, {}, {} } }
+            {}
+
+            /**
+             *  Has all the data been consumed?
+             *
+             *  @return Whether all data was used up
+             */
+            bool is_done() noexcept override
+            {
+                return _parts[0].size() == 0 && _parts[1].size() == 0 && _parts[2].size() == 0;
+            }
+
+            /**
+             *  Is the data from the last call to next() all
+             *  that remains?
+             *
+             *  @return Whether all the parts fit in the buffers
+             */
+            bool is_final_batch() noexcept override
+            {
+                return _final;
+            }
+
+            /**
+             *  Retrieve bytes to be sent
+             *
+             *  @param  buffers The array to add the buffers to be sent to
+             *  @param  ec      The error code from getting the data
+             */
+            void next(buffers_type& buffers, boost::system::error_code&) noexcept override
+            {
+                // the response can no longer be changed
+                _started    = true;
+                _final      = true;
+
+                // add the parts that remain
+                for (const auto& part : _parts) {
+                    // skip the parts that were sent already
+                    if (part.size() == 0) {
+                        continue;
+                    }
+
+                    // is there room for the part?
+                    if (buffers.size() == buffers.capacity()) {
+                        _final = false;
+                        return;
+                    }
+
+                    // add the part to the result
+                    buffers.emplace_back(part.data(), part.size());
+                }
+            }
+
+            /**
+             *  Ask the client to close the connection after
+             *  this response, by adding the header after the
+             *  status line, unless the response already has
+             *  a connection header of its own
+             */
+            void close() noexcept override
+            {
+                // the header that we insert
+                constexpr std::string_view header{ "Connection: close\r\n" };
+
+                // the response, which was not split yet
+                std::string_view data{ static_cast<const char*>(_parts[0].data()), _parts[0].size() };
+
+                // the status line, and the header fields that follow it
+                auto status = data.find("\r\n");
+                auto fields = data.substr(0, data.find("\r\n\r\n"));
+
+                // was the data retrieved already, is the status line
+                // malformed, or did the response decide for itself?
+                if (_started || _parts[1].size() != 0 || status == std::string_view::npos || has_connection(fields)) {
+                    return;
+                }
+
+                // send the status line, our header and the rest of the response
+                _parts[0] = { data.data(), status + 2 };
+                _parts[1] = { header.data(), header.size() };
+                _parts[2] = { data.data() + status + 2, data.size() - status - 2 };
+            }
+
+            /**
+             *  Consume bytes
+             *
+             *  @param  size    The number of bytes to consume
+             */
+            void consume(std::size_t size) noexcept override
+            {
+                // move past the written data, part by part
+                for (auto& part : _parts) {
+                    // the bytes written from this part
+                    auto consumed = std::min(size, part.size());
+
+                    // move past them
+                    part += consumed;
+                    size -= consumed;
+                }
+            }
+        private:
+            /**
+             *  Check whether the fields of a response
+             *  contain a connection header
+             *
+             *  @param  fields  The status line and the fields of the response
+             *  @return Whether one of the fields is the connection header
+             */
+            static bool has_connection(std::string_view fields) noexcept
+            {
+                // the name of the field, with the line break before it
+                constexpr std::string_view name{ "\r\nconnection:" };
+
+                // try every position the field could start at
+                for (std::size_t position{ 0 }; position + name.size() <= fields.size(); ++position) {
+                    // the number of characters that match
+                    std::size_t index{ 0 };
+
+                    // names are compared without regard to case
+                    while (index < name.size() && std::tolower(static_cast<unsigned char>(fields[position + index])) == name[index]) {
+                        ++index;
+                    }
+
+                    // did we find the complete name?
+                    if (index == name.size()) {
+                        return true;
+                    }
+                }
+
+                // the field is not there
+                return false;
+            }
+
+            std::array<boost::asio::const_buffer, 3>    _parts;             // the data still to be sent, with any header we inserted
+            bool                                        _started{ false };  // was the data retrieved already
+            bool                                        _final{ true };     // did the last buffers hold all the data
+    };
+
+}
@@ -5,15 +5,75 @@
 #include <boost/asio/io_context.hpp>
 #include <boost/beast/http/verb.hpp>
 #include <boost/beast/http/string_body.hpp>
+#include <boost/beast/http/fields.hpp>
+#include "recycling_allocator.h"
+#include "logger.h"
+#include "request_tracer.h"
 
 
 namespace tamed {
 
     /**
-     *  Server configuration options
+     *  Header fields that recycle their storage through a per-thread
+     *  cache, so that requests on a keep-alive connection reuse the
+     *  memory of the requests before them
      */
-    template <typename body = boost::beast::http::string_body, typename executor = boost::asio::io_context::executor_type, boost::beast::http::verb... verbs>
-    struct config
+    using recycling_fields = boost::beast::http::basic_fields<recycling_allocator<char>>;
+
+    /**
+     *  The policies of a server configuration, kept apart
+     *  from the configuration itself, so that new policies
+     *  do not change the parameters of the configuration
+     */
+    template <typename fields = boost::beast::http::fields, typename logger = async_logger<>, typename tracer = null_tracer>
+    struct config_traits
+    {
+        /**
+         *  The container to store the fields
+         *  of incoming requests in
+         */
+        using fields_type = fields;
+
+        /**
+         *  The logger to report errors to, use the
+         *  null_logger to compile out all logging
+         */
+        using logger_type = logger;
+
+        /**
+         *  The tracer to report the stages of every
+         *  request to, the null_tracer stores nothing
+         */
+        using tracer_type = tracer;
+
+        /**
+         *  Select a different container for
+         *  the fields of incoming requests
+         */
+        template <typename fields_type>
+        using with_fields_type = config_traits<fields_type, logger, tracer>;
+
+        /**
+         *  Select a different logger, like
+         *  async_logger with another threshold
+         */
+        template <typename logger_type>
+        using with_logger_type = config_traits<fields, logger_type, tracer>;
+
+        /**
+         *  Select a tracer, which receives the
+         *  timeline of every answered request
+         */
+        template <typename tracer_type>
+        using with_tracer_type = config_traits<fields, logger, tracer_type>;
+    };
+
+    /**
+     *  Server configuration options, with the policies
+     *  in a separate traits type
+     */
+    template <typename body, typename executor, typename traits, boost::beast::http::verb... verbs>
+    struct basic_config
     {
         /**
          *  The body type to use for incoming requests
@@ -26,6 +86,27 @@ namespace tamed {
          */
         using executor_type = executor;
 
+        /**
+         *  The policies of the configuration
+         */
+        using traits_type = traits;
+
+        /**
+         *  The container to store the fields
+         *  of incoming requests in
+         */
+        using fields_type = typename traits::fields_type;
+
+        /**
+         *  The logger to report errors to
+         */
+        using logger_type = typename traits::logger_type;
+
+        /**
+         *  The tracer to report the stages of every request to
+         */
+        using tracer_type = typename traits::tracer_type;
+
         /**
          *  The HTTP methods that are supported by the server
          */
@@ -36,23 +117,56 @@ namespace tamed {
          *  requests
          */
         template <typename body_type>
-        using with_body_type = config<body_type, executor, verbs...>;
+        using with_body_type = basic_config<body_type, executor, traits, verbs...>;
 
         /**
          *  Select a different executor type
          *  for registering asynchronous events
          */
         template <typename executor_type>
-        using with_executor_type = config<body, executor_type, verbs...>;
+        using with_executor_type = basic_config<body, executor_type, traits, verbs...>;
+
+        /**
+         *  Select different policies
+         */
+        template <typename traits_type>
+        using with_traits = basic_config<body, executor, traits_type, verbs...>;
+
+        /**
+         *  Select a different container for
+         *  the fields of incoming requests
+         */
+        template <typename fields_type>
+        using with_fields_type = with_traits<typename traits::template with_fields_type<fields_type>>;
+
+        /**
+         *  Select a different logger, like
+         *  async_logger with another threshold
+         */
+        template <typename logger_type>
+        using with_logger_type = with_traits<typename traits::template with_logger_type<logger_type>>;
+
+        /**
+         *  Select a tracer, which receives the
+         *  timeline of every answered request
+         */
+        template <typename tracer_type>
+        using with_tracer_type = with_traits<typename traits::template with_tracer_type<tracer_type>>;
 
         /**
          *  Select a different set of supported
          *  request methods
          */
         template <boost::beast::http::verb... methods>
-        using with_methods = config<body, executor, methods...>;
+        using with_methods = basic_config<body, executor, traits, methods...>;
     };
 
+    /**
+     *  Server configuration options, with the default policies
+     */
+    template <typename body = boost::beast::http::string_body, typename executor = boost::asio::io_context::executor_type, boost::beast::http::verb... verbs>
+    using config = basic_config<body, executor, config_traits<>, verbs...>;
+
     /**
      *  Pre-defined server config for a simple REST server
      */
@@ -1,11 +1,25 @@
 #pragma once
 
+#include <boost/asio/any_io_executor.hpp>
 #include <boost/beast/core.hpp>
+#include <boost/core/empty_value.hpp>
 #include <boost/beast/http.hpp>
+#include <chrono>
 #include <memory>
+#include <optional>
+#include <vector>
 #include "derived_optional.h"
+#include "body_traits.h"
+#include "settings.h"
+#include "connection_pool.h"
+#include "executor_pool.h"
+#include "logger.h"
+#include "request_tracer.h"
 #include "message_data_source.h"
-#include "send_data.h"
+#include "buffer_data_source.h"
+#include "response_queue.h"
+#include "gather_write.h"
+#include "send_file.h"
 #include "stream_traits.h"
 #include "connection_data.h"
 #include "handshake_operation.h"
@@ -22,25 +36,87 @@ namespace tamed {
             /**
              *  Constructor
              *
-             *  @param  data    The existing state to work with
+             *  @param  data        The existing state to work with
+             *  @param  sequence    The sequence number of the request to answer
+             *  @param  head        Whether the request only asks for the headers
              */
-            connection(std::shared_ptr<connection_data> data) :
-                _data{ std::move(data) }
+            connection(std::shared_ptr<connection_data> data, std::size_t sequence, bool head) :
+                _data{ std::move(data) },
+                _sequence{ sequence },
+                _head{ head }
             {}
 
+            /**
+             *  Does the request only ask for the headers?
+             *
+             *  The body of responses to HEAD requests is never
+             *  written, so a handler may skip producing it, as
+             *  long as it sets the Content-Length it would have.
+             *
+             *  @return Whether the response body is left out
+             */
+            bool is_head() const noexcept
+            {
+                return _head;
+            }
+
+            /**
+             *  Retrieve the executor the connection runs on
+             *
+             *  A handler that finishes its work on another
+             *  executor must send the response from this one.
+             *
+             *  @return The executor of the connection
+             */
+            boost::asio::any_io_executor get_executor() const
+            {
+                return _data->get_any_executor();
+            }
+
             /**
              *  Send a response message
              *
+             *  When multiple requests are in flight, the responses
+             *  are sent in the order in which the requests arrived.
+             *
              *  @param  message     The message to send
              */
             template <typename response_body_type>
             void send(boost::beast::http::response<response_body_type> message) noexcept
             {
                 // start writing the response message
-                _data->write_response(std::move(message));
+                _data->write_response(_sequence, std::move(message), _head);
+            }
+
+            /**
+             *  Send a response that was serialized before
+             *
+             *  The data is not copied, and must stay valid until
+             *  it is written, for example because it was prepared
+             *  when the server was set up.
+             *
+             *  @param  response    The complete serialized response
+             */
+            void send(std::string_view response) noexcept
+            {
+                // only send the header in response to HEAD
+                if (_head) {
+                    // the header ends with an empty line
+                    auto end = response.find("\r\n\r\n");
+
+                    // leave out everything after the header
+                    if (end != std::string_view::npos) {
+                        response = response.substr(0, end + 4);
+                    }
+                }
+
+                // start writing the response data
+                _data->write_response(_sequence, response);
             }
         private:
-            std::shared_ptr<connection_data>    _data;  // connection state;
+            std::shared_ptr<connection_data>    _data;      // connection state
+            std::size_t                         _sequence;  // the request we are answering
+            bool                                _head;      // is the body left out of the response
     };
 
 }
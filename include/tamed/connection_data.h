@@ -13,16 +13,83 @@ namespace tamed {
             /**
              *  Write the given response
              *
+             *  @param  sequence    The sequence number of the request to answer
              *  @param  response    The response message to write
              */
             template <typename response_body_type>
-            void write_response(boost::beast::http::response<response_body_type> response) noexcept
+            void write_response(std::size_t sequence, boost::beast::http::response<response_body_type> response, bool head) noexcept
             {
-                // store the message inside the serializer and start writing
-                _response.template emplace<message_data_source<response_body_type>>(std::move(response));
-                write_response(*_response);
+                // the status is counted once the response is written
+                auto status = response.result_int();
+
+                // is the request still waiting for an answer?
+                if (!responses.awaiting(sequence)) {
+                    return;
+                }
+
+                // store the message inside the slot for the request, the
+                // responses are written in the order of the requests
+                response_ready(sequence);
+                if (responses.template emplace<message_data_source<response_body_type>>(sequence, std::move(response), head)) {
+                    // the response may be next in line
+                    trace(sequence).status = status;
+                    write_response();
+                }
+            }
+
+            /**
+             *  Write a response that was serialized before
+             *
+             *  @param  sequence    The sequence number of the request to answer
+             *  @param  response    The serialized response, which must stay valid until written
+             */
+            void write_response(std::size_t sequence, std::string_view response) noexcept
+            {
+                // is the request still waiting for an answer?
+                if (!responses.awaiting(sequence)) {
+                    return;
+                }
+
+                // store the data inside the slot for the request
+                response_ready(sequence);
+                if (responses.template emplace<buffer_data_source>(sequence, response)) {
+                    // the response may be next in line
+                    trace(sequence).status = status_of(response);
+                    write_response();
+                }
             }
+
+            /**
+             *  Retrieve the executor the connection runs on
+             *
+             *  @return The executor, without its specific type
+             */
+            virtual boost::asio::any_io_executor get_any_executor() = 0;
         protected:
+            /**
+             *  What we know about a request in flight,
+             *  for keeping statistics once it is answered
+             */
+            struct request_trace
+            {
+                std::chrono::steady_clock::time_point   started;    // the time the first byte of the request was read
+                std::size_t                             method;     // the index of the request method
+                std::size_t                             route;      // the number of the route that handled the request
+                std::size_t                             received;   // the number of bytes in the request
+                std::size_t                             sent;       // the number of bytes of the response written so far
+                unsigned                                status;     // the status code of the response
+            };
+
+            /**
+             *  Constructor
+             *
+             *  @param  depth   The maximum number of requests in flight
+             */
+            connection_data(std::size_t depth) :
+                responses{ depth },
+                traces(std::max<std::size_t>(depth, 1))
+            {}
+
             /**
              *  Destructor
              *
@@ -30,43 +97,136 @@ namespace tamed {
              *          being deleted through the base pointer
              */
             ~connection_data() = default;
+
+            /**
+             *  Retrieve the trace for a request in flight
+             *
+             *  @param  sequence    The sequence number of the request
+             *  @return The trace for the request
+             */
+            request_trace& trace(std::size_t sequence) noexcept
+            {
+                return traces[sequence % traces.size()];
+            }
+
+            response_queue                                                  responses;          // the responses for the requests in flight
+            std::vector<request_trace, recycling_allocator<request_trace>>  traces;             // the traces for the requests in flight
         private:
             /**
-             *  Write response data
+             *  Find the status code in a serialized response
              *
-             *  @param  response    The response message to write
+             *  @param  response    The serialized response
+             *  @return The status code, or zero if the status line is malformed
+             */
+            static unsigned status_of(std::string_view response) noexcept
+            {
+                // the status code follows the version, as in "HTTP/1.1 200"
+                if (response.size() < 12 || response.compare(0, 5, "HTTP/") != 0) {
+                    return 0;
+                }
+
+                // the result we are building
+                unsigned result{ 0 };
+
+                // parse the three digits
+                for (auto digit : response.substr(9, 3)) {
+                    // is this a digit at all?
+                    if (digit < '0' || digit > '9') {
+                        return 0;
+                    }
+
+                    // add the digit to the result
+                    result = result * 10 + static_cast<unsigned>(digit - '0');
+                }
+
+                return result;
+            }
+
+            /**
+             *  Record that the response for a request was handed
+             *  over, before it is stored and serialized
+             *
+             *  @param  sequence    The sequence number of the request
              */
-            virtual void write_response(data_source& response) noexcept = 0;
+            virtual void response_ready(std::size_t sequence) noexcept = 0;
 
-            derived_optional<data_source, 512>  _response;  // the response to send
+            /**
+             *  Write the next response, if it is ready
+             *  and no other response is being written
+             */
+            virtual void write_response() noexcept = 0;
     };
 
     /**
      *  The data implementation, templated on
      *  the specific stream- and executor type
+     *
+     *  The router, the executor slot and the settings belong
+     *  to the server, and are only used while handling the
+     *  connection, so the server must outlive running its
+     *  executors. A connection may still be destroyed after
+     *  the server, when the io_context destroys its pending
+     *  handlers without invoking them. The destructor then
+     *  only touches what the connection shares ownership of:
+     *  the connection count, the limits and the pool.
      */
-    template <class router_type, class body_type, typename stream_type, typename executor_type>
+    template <class router_type, class request_type, typename stream_type, typename executor_type, typename logger_type, typename tracer_type>
     class connection_data_impl final :
         public connection_data,
-        public std::enable_shared_from_this<connection_data_impl<router_type, body_type, stream_type, executor_type>>
+        public drain_list::entry,
+        public std::enable_shared_from_this<connection_data_impl<router_type, request_type, stream_type, executor_type, logger_type, tracer_type>>,
+        private boost::empty_value<request_tracer<tracer_type>>
     {
         public:
-            using request_type = boost::beast::http::request<body_type>;
-
+            using slot_type     = typename executor_pool<executor_type>::slot;
+            using parser_type   = boost::beast::http::request_parser<typename request_type::body_type, typename request_type::allocator_type>;
+            using clock_type    = std::chrono::steady_clock;
+            using tracer_base   = boost::empty_value<request_tracer<tracer_type>>;     // a base, so a tracer without state takes no space
 
             /**
              *  Constructor
              *
              *  @param  router      The routing table to route requests
-             *  @param  executor    The executor to bind to
+             *  @param  slot        The executor slot the connection runs on
+             *  @param  pool        The pool to recycle storage with
+             *  @param  options     The settings to tune the connection
+             *  @param  permit      The places the connection holds in the connection limits
+             *  @param  connected   The accepted socket to wrap in the stream
              *  @param  parameters  Optional additional arguments for constructing the stream
              */
-            template <typename... arguments>
-            connection_data_impl(router_type& router, executor_type executor, arguments&&... parameters) noexcept :
-                socket{ executor, std::forward<arguments>(parameters)... },
-                router{ router }
+            template <typename socket_type, typename... arguments>
+            connection_data_impl(router_type& router, slot_type& slot, std::shared_ptr<connection_pool> pool, const settings& options, connection_permit&& permit, socket_type&& connected, arguments&&... parameters) :
+                connection_data{ options.pipeline_depth },
+                tracer_base{ boost::empty_init_t{}, options.pipeline_depth },
+                permit{ std::move(permit) },
+                registered{ slot.add_connection() },
+                socket{ std::move(connected), std::forward<arguments>(parameters)... },
+                buffer{ pool->acquire_buffer() },
+                output{ options.gather_width },
+                router{ router },
+                slot{ slot },
+                pool{ std::move(pool) },
+                options{ options },
+                deadline{ &connection_data_impl::expired, this },
+                received{ 0 },
+                close{ false },
+                reading{ false },
+                writing{ false },
+                idle{ false }
             {}
 
+            /**
+             *  Destructor
+             */
+            ~connection_data_impl()
+            {
+                // the server must not drain us while we are destroyed
+                this->leave();
+
+                // the buffer can be reused by the next connection
+                pool->release_buffer(std::move(buffer));
+            }
+
             /**
              *  Retrieve the executor
              *
@@ -75,18 +235,65 @@ namespace tamed {
             executor_type get_executor() noexcept;
 
             /**
-             *  Accept an incoming connection
+             *  Retrieve the tracer
+             *
+             *  @return The tracer recording the stages of the requests
+             */
+            request_tracer<tracer_type>& tracer() noexcept
+            {
+                return tracer_base::get();
+            }
+
+            /**
+             *  Retrieve the executor the connection runs on
              *
-             *  @param  acceptor    The acceptor to that has an incoming connection waiting
+             *  @return The executor, without its specific type
+             */
+            boost::asio::any_io_executor get_any_executor() override;
+
+            /**
+             *  Start handling the accepted connection
              */
-            template <typename acceptor_type>
-            void accept(acceptor_type& acceptor) noexcept;
+            void start() noexcept;
 
             /**
              *  Read request data
              */
             void read_request() noexcept;
 
+            /**
+             *  Handle the first bytes of a request arriving,
+             *  and continue with reading the header
+             *
+             *  @param  transferred The number of bytes that were read
+             */
+            void request_started(std::size_t transferred) noexcept;
+
+            /**
+             *  Read the header of the request
+             */
+            void read_header() noexcept;
+
+            /**
+             *  Read the body of the request, after
+             *  the header has been read
+             */
+            void read_body() noexcept;
+
+            /**
+             *  Continue reading, if there is room
+             *  for another request in flight
+             */
+            void read_ahead() noexcept;
+
+            /**
+             *  Has the client started sending a request that we
+             *  are still reading, so it must be answered as well?
+             *
+             *  @return Whether a request has partly arrived
+             */
+            bool receiving() const noexcept;
+
             /**
              *  Route the request to registered
              *  callbacks
@@ -94,17 +301,96 @@ namespace tamed {
             void route_request() noexcept;
 
             /**
-             *  Write response data
+             *  Clear the request for reading the next
+             *  one, while keeping its storage
+             */
+            void reset_request() noexcept;
+
+            /**
+             *  Record that the response for a request was handed
+             *  over, before it is stored and serialized
              *
-             *  @param  response    The response message to write
+             *  @param  sequence    The sequence number of the request
+             */
+            void response_ready(std::size_t sequence) noexcept override;
+
+            /**
+             *  Write the next response, if it is ready
+             *  and no other response is being written
+             */
+            void write_response() noexcept override;
+
+            /**
+             *  Write the responses that are ready
+             *
+             *  @param  target  The stream or socket to write to
+             */
+            template <typename target_type>
+            void write_to(target_type& target) noexcept;
+
+            /**
+             *  Handle the completion of a write
+             *
+             *  @param  transferred The number of bytes that were written
+             */
+            void response_written(std::size_t transferred) noexcept;
+
+            /**
+             *  Finish the requests in flight, and close the
+             *  connection, which closes an idle connection
+             *  immediately
+             */
+            void drain() noexcept override;
+
+            /**
+             *  Abort the connection after an error
+             */
+            void abort() noexcept override;
+
+            /**
+             *  Set the deadline for the client, if
+             *  we are waiting for it to send data
+             */
+            void wait_for_client() noexcept;
+
+            /**
+             *  Set the deadline for the connection
+             *
+             *  @param  timeout The time until the connection is aborted, zero to disable
+             */
+            void set_deadline(std::chrono::milliseconds timeout) noexcept;
+
+            /**
+             *  Handle the deadline of a connection passing
+             *
+             *  @param  context The connection that timed out
+             */
+            static void expired(void* context) noexcept;
+
+            /**
+             *  The most data to read at once while
+             *  waiting for the start of a request
              */
-            void write_response(data_source& response) noexcept override;
+            constexpr const static std::size_t read_size = 65536;
 
-            stream_type                 socket;     // the socket to handle
-            boost::beast::flat_buffer   buffer;     // buffer to use for reading request data
-            router_type&                router;     // the table for routing requests
-            request_type                request;    // the incoming request to read
-            bool                        close;      // do we need to close the connection
+            connection_permit                   permit;     // the places in the connection limits, returned after the socket is closed
+            connection_registration             registered; // the place in the count of the executor, which may outlive the slot
+            stream_type                         socket;     // the socket to handle
+            boost::beast::flat_buffer           buffer;     // buffer to use for reading request data
+            gather_buffers                      output;     // the buffers of the responses being written
+            router_type&                        router;     // the table for routing requests, owned by the server
+            slot_type&                          slot;       // the executor slot we run on, owned by the server
+            std::shared_ptr<connection_pool>    pool;       // the pool to recycle storage with
+            const settings&                     options;    // the settings to tune the connection, owned by the server
+            request_type                        request;    // the incoming request to read
+            std::optional<parser_type>          parser;     // the parser for the request being read
+            timer_wheel::entry                  deadline;   // the timeout for the operation we wait for
+            clock_type::time_point              started;    // the time the first byte of the request being read arrived
+            std::size_t                         received;   // the number of bytes read for the request
+            bool                                close;      // do we need to close the connection
+            bool                                reading;    // is a request being read
+            bool                                writing;    // is a response being written
+            bool                                idle;       // has a request been answered, so the next one is kept alive
     };
 
 }
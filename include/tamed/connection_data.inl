@@ -12,36 +12,41 @@ namespace tamed {
      *
      *  @return The executor associated with the connection
      */
-    template <class router_type, class body_type, typename stream_type, typename executor_type>
-    executor_type connection_data_impl<router_type, body_type, stream_type, executor_type>::get_executor() noexcept
+    template <class router_type, class request_type, typename stream_type, typename executor_type, typename logger_type, typename tracer_type>
+    executor_type connection_data_impl<router_type, request_type, stream_type, executor_type, logger_type, tracer_type>::get_executor() noexcept
     {
         return socket.get_executor();
     }
 
     /**
-     *  Accept an incoming connection
+     *  Retrieve the executor the connection runs on
      *
-     *  @param  acceptor    The acceptor to that has an incoming connection waiting
+     *  @return The executor, without its specific type
      */
-    template <class router_type, class body_type, typename stream_type, typename executor_type>
-    template <typename acceptor_type>
-    void connection_data_impl<router_type, body_type, stream_type, executor_type>::accept(acceptor_type& acceptor) noexcept
+    template <class router_type, class request_type, typename stream_type, typename executor_type, typename logger_type, typename tracer_type>
+    boost::asio::any_io_executor connection_data_impl<router_type, request_type, stream_type, executor_type, logger_type, tracer_type>::get_any_executor()
     {
-        // the error code from the operation
-        boost::system::error_code ec;
-
-        // accept the incoming connection
-        acceptor.accept(socket.lowest_layer(), ec);
+        return socket.get_executor();
+    }
 
-        // check whether the socket was accepted successfully
-        if (ec != boost::system::error_code{}) {
-            // cannot continue without an open socket
-            std::cerr << "Error during socket accept: " << ec.message() << std::endl;
-            return;
+    /**
+     *  Start handling the accepted connection
+     */
+    template <class router_type, class request_type, typename stream_type, typename executor_type, typename logger_type, typename tracer_type>
+    void connection_data_impl<router_type, request_type, stream_type, executor_type, logger_type, tracer_type>::start() noexcept
+    {
+        // the connection can now be drained, unless
+        // the server started draining already
+        if (slot.get_drain_list().add(*this)) {
+            // then the connection is not used
+            return abort();
         }
 
         // do we have a stream with support for asynchronous handshakes?
         if constexpr (is_async_tls_stream_v<stream_type>) {
+            // the client must finish the handshake in time
+            set_deadline(options.handshake_timeout);
+
             // initiate the SSL handshake
             socket.async_handshake(boost::asio::ssl::stream_base::server, handshake_operation{ this->shared_from_this() });
         } else {
@@ -53,53 +58,414 @@ namespace tamed {
     /**
      *  Read request data
      */
-    template <class router_type, class body_type, typename stream_type, typename executor_type>
-    void connection_data_impl<router_type, body_type, stream_type, executor_type>::read_request() noexcept
+    template <class router_type, class request_type, typename stream_type, typename executor_type, typename logger_type, typename tracer_type>
+    void connection_data_impl<router_type, request_type, stream_type, executor_type, logger_type, tracer_type>::read_request() noexcept
+    {
+        // we are now waiting for a request, the parser
+        // takes over the storage of the previous request
+        reading     = true;
+        received    = 0;
+        parser.emplace(std::move(request));
+
+        // the client must send the header in time
+        wait_for_client();
+
+        // is the request already buffered, because it was pipelined?
+        if (buffer.size() != 0) {
+            // then it starts right away
+            started = clock_type::now();
+            tracer().reading(&request_timeline::first_byte, started);
+            return read_header();
+        }
+
+        // wait for the first bytes, so we know when the request started,
+        // the header is then parsed from the buffer without another read
+        socket.async_read_some(buffer.prepare(boost::beast::read_size(buffer, read_size)), read_operation{ this->shared_from_this() });
+    }
+
+    /**
+     *  Handle the first bytes of a request arriving,
+     *  and continue with reading the header
+     *
+     *  @param  transferred The number of bytes that were read
+     */
+    template <class router_type, class request_type, typename stream_type, typename executor_type, typename logger_type, typename tracer_type>
+    void connection_data_impl<router_type, request_type, stream_type, executor_type, logger_type, tracer_type>::request_started(std::size_t transferred) noexcept
+    {
+        // the request starts with the data we read
+        started = clock_type::now();
+        tracer().reading(&request_timeline::first_byte, started);
+        buffer.commit(transferred);
+
+        // the connection is no longer idle, so the
+        // client must now send the header in time
+        wait_for_client();
+
+        // parse the header, and read the rest of it
+        read_header();
+    }
+
+    /**
+     *  Read the header of the request
+     */
+    template <class router_type, class request_type, typename stream_type, typename executor_type, typename logger_type, typename tracer_type>
+    void connection_data_impl<router_type, request_type, stream_type, executor_type, logger_type, tracer_type>::read_header() noexcept
     {
-        // read from the socket into the request
-        boost::beast::http::async_read(socket, buffer, this->request, read_operation{ this->shared_from_this() });
+        // read the header into the request
+        boost::beast::http::async_read_header(socket, buffer, *parser, read_operation{ this->shared_from_this() });
+    }
+
+    /**
+     *  Read the body of the request, after
+     *  the header has been read
+     */
+    template <class router_type, class request_type, typename stream_type, typename executor_type, typename logger_type, typename tracer_type>
+    void connection_data_impl<router_type, request_type, stream_type, executor_type, logger_type, tracer_type>::read_body() noexcept
+    {
+        // the client must send the body in time
+        wait_for_client();
+
+        // read the rest of the request
+        boost::beast::http::async_read(socket, buffer, *parser, read_operation{ this->shared_from_this() });
+    }
+
+    /**
+     *  Continue reading, if there is room
+     *  for another request in flight
+     */
+    template <class router_type, class request_type, typename stream_type, typename executor_type, typename logger_type, typename tracer_type>
+    void connection_data_impl<router_type, request_type, stream_type, executor_type, logger_type, tracer_type>::read_ahead() noexcept
+    {
+        // we cannot read when a read is already pending, the client
+        // asked us to close, or the pipeline is at its maximum depth
+        if (!reading && !close && !responses.full()) {
+            // read the next request
+            read_request();
+        }
+    }
+
+    /**
+     *  Has the client started sending a request that we
+     *  are still reading, so it must be answered as well?
+     *
+     *  @return Whether a request has partly arrived
+     */
+    template <class router_type, class request_type, typename stream_type, typename executor_type, typename logger_type, typename tracer_type>
+    bool connection_data_impl<router_type, request_type, stream_type, executor_type, logger_type, tracer_type>::receiving() const noexcept
+    {
+        // data in the buffer is parsed for the request being read
+        return reading && (buffer.size() != 0 || parser->got_some());
     }
 
     /**
      *  Route the request to registered
      *  callbacks
      */
-    template <class router_type, class body_type, typename stream_type, typename executor_type>
-    void connection_data_impl<router_type, body_type, stream_type, executor_type>::route_request() noexcept
+    template <class router_type, class request_type, typename stream_type, typename executor_type, typename logger_type, typename tracer_type>
+    void connection_data_impl<router_type, request_type, stream_type, executor_type, logger_type, tracer_type>::route_request() noexcept
     {
-        // do we need to close the connection after writing
-        close = request.need_eof();
+        // take the request from the parser
+        request = parser->release();
+        parser.reset();
+
+        // do we need to close the connection after writing, the
+        // connection may already be closing because of draining
+        close = close || request.need_eof();
+
+        // reserve the response slot for the request
+        auto sequence = responses.reserve();
+
+        // responses to HEAD requests are written without their body
+        auto head = request.method() == boost::beast::http::verb::head;
+
+        // start the trace for the request, before the
+        // handler can answer it
+        auto& current = trace(sequence);
+        current = { started, router_type::method_index(request.method()), request_statistics::npos, received, 0, 0 };
+        tracer().start(sequence, request.method());
 
-        try {
-            // extract the target the request goes to
-            std::string_view target{ request.target().data(), request.target().size() };
+        // route the request to its handler, requests without a handler
+        // are answered without throwing, so junk requests are cheap
+        tracer().handling(sequence, &request_timeline::handler_entered);
+        auto result = router.route(connection{ this->shared_from_this(), sequence, head }, std::move(request), current.route);
+        tracer().handling(sequence, &request_timeline::handler_returned);
 
-            // handle the processed request
-            router[request.method()].route(target, connection{ this->shared_from_this() }, std::move(request));
-        } catch (const std::out_of_range&) {
-            // the connection to send over and the response to send
-            connection                                                      connection  { this->shared_from_this()                  };
-            boost::beast::http::response<boost::beast::http::string_body>   response    { boost::beast::http::status::not_found, 11 };
+        // count the outcome of routing
+        slot.get_routing_statistics().record(result);
+
+        // prepare for the next request
+        reset_request();
+
+        // read the next request while this one is in flight
+        read_ahead();
+
+        // we do not wait for the client while the request is handled
+        wait_for_client();
+    }
 
-            // no handler was installed for this path
-            response.body().assign("The requested resource was not found on this server");
-            connection.send(std::move(response));
+    /**
+     *  Clear the request for reading the next
+     *  one, while keeping its storage
+     */
+    template <class router_type, class request_type, typename stream_type, typename executor_type, typename logger_type, typename tracer_type>
+    void connection_data_impl<router_type, request_type, stream_type, executor_type, logger_type, tracer_type>::reset_request() noexcept
+    {
+        // the type of body we are storing
+        using body_value_type = typename request_type::body_type::value_type;
+
+        // remove all the fields, when the fields use a
+        // recycling allocator the memory is kept around
+        request.clear();
+
+        // can the body be cleared without losing its storage
+        if constexpr (has_reusable_storage_v<body_value_type>) {
+            // did the body grow beyond what we want to keep
+            if (request.body().capacity() > options.request_capacity_limit) {
+                // release the storage, assigning an empty string would keep
+                // the buffer, so we swap it into a temporary instead
+                using std::swap;
+                body_value_type released{};
+                swap(request.body(), released);
+            } else {
+                // remove the data, but keep the capacity
+                request.body().clear();
+            }
+        } else {
+            // the body must be replaced
+            request.body() = body_value_type{};
+        }
+    }
+
+    /**
+     *  Record that the response for a request was handed
+     *  over, before it is stored and serialized
+     *
+     *  @param  sequence    The sequence number of the request
+     */
+    template <class router_type, class request_type, typename stream_type, typename executor_type, typename logger_type, typename tracer_type>
+    void connection_data_impl<router_type, request_type, stream_type, executor_type, logger_type, tracer_type>::response_ready(std::size_t sequence) noexcept
+    {
+        tracer().handling(sequence, &request_timeline::response_ready);
+    }
+
+    /**
+     *  Write the next response, if it is ready
+     *  and no other response is being written
+     */
+    template <class router_type, class request_type, typename stream_type, typename executor_type, typename logger_type, typename tracer_type>
+    void connection_data_impl<router_type, request_type, stream_type, executor_type, logger_type, tracer_type>::write_response() noexcept
+    {
+        // responses are written one after the other
+        if (writing) {
+            return;
+        }
+
+        // is the data encrypted by the kernel?
+        if constexpr (is_kernel_tls_stream_v<stream_type>) {
+            // then we can write to the socket directly
+            if (socket.kernel_send()) {
+                return write_to(socket.next_layer());
+            }
+        }
+
+        // write through the stream
+        write_to(socket);
+    }
+
+    /**
+     *  Write the responses that are ready
+     *
+     *  @param  target  The stream or socket to write to
+     */
+    template <class router_type, class request_type, typename stream_type, typename executor_type, typename logger_type, typename tracer_type>
+    template <typename target_type>
+    void connection_data_impl<router_type, request_type, stream_type, executor_type, logger_type, tracer_type>::write_to(target_type& target) noexcept
+    {
+        // are we closing after the requests in flight, and is no request
+        // arriving that we still answer? then the response to the last
+        // request tells the client, the earlier ones keep it alive
+        if (close && !receiving()) {
+            responses.close_last();
+        }
+
+        // can we write to the socket directly?
+        if constexpr (is_native_socket_v<target_type>) {
+            // is the next data in a file?
+            if (auto region = responses.gather_file(); region.size != 0) {
+                // let the kernel send the file data
+                writing = true;
+                set_deadline(options.write_timeout);
+                slot.get_write_statistics().record(false);
+                tracer().writing(responses.sequence(), 1);
+                return async_send_file(target, region, write_operation{ this->shared_from_this() });
+            }
+        }
+
+        // the error code from retrieving the data
+        boost::system::error_code ec;
+
+        // collect the responses that are ready, so that
+        // they can be sent with a single write
+        output.clear();
+        auto capped = responses.gather(output, options.write_coalesce_limit, ec);
+
+        // check if we managed to get the data
+        if (ec != boost::system::error_code{}) {
+            // log the error and abort
+            logger_type::log(log_level::error, "Error occurred during response serialization: ", ec);
+            return abort();
+        }
+
+        // is the response to the oldest request ready?
+        if (!output.empty()) {
+            // start sending the responses over the stream
+            writing = true;
+            set_deadline(options.write_timeout);
+            slot.get_write_statistics().record(capped);
+            tracer().writing(responses.sequence(), responses.batches());
+            async_write_gathered(target, output, write_operation{ this->shared_from_this() });
+        }
+    }
+
+    /**
+     *  Handle the completion of a write
+     *
+     *  @param  transferred The number of bytes that were written
+     */
+    template <class router_type, class request_type, typename stream_type, typename executor_type, typename logger_type, typename tracer_type>
+    void connection_data_impl<router_type, request_type, stream_type, executor_type, logger_type, tracer_type>::response_written(std::size_t transferred) noexcept
+    {
+        // the time the responses were written
+        auto now = clock_type::now();
+
+        // remove the responses that were completely written, and
+        // count the requests that were answered with them
+        writing = false;
+        responses.consume(transferred, [this, now](std::size_t sequence, std::size_t size, bool done) {
+            // add the data to the response
+            auto& current = trace(sequence);
+            current.sent += size;
+
+            // was the response written completely?
+            if (done) {
+                // then the request has been answered
+                slot.get_request_statistics().record(current.method, current.route, current.status, current.received, current.sent, now - current.started);
+                tracer().finish(sequence, now, current.route, current.status);
+            }
+        });
+
+        // further requests are kept alive
+        idle = true;
+
+        // write the next response, and read the next
+        // request now that there is room in the pipeline
+        write_response();
+        read_ahead();
+
+        // were the last responses written before closing, and
+        // is no request arriving that we still have to answer?
+        if (close && !writing && responses.empty() && !receiving()) {
+            // then stop waiting for more requests
+            return abort();
+        }
+
+        // without a write, we may be waiting for the client
+        wait_for_client();
+    }
+
+    /**
+     *  Finish the requests in flight, and close the
+     *  connection, which closes an idle connection
+     *  immediately
+     */
+    template <class router_type, class request_type, typename stream_type, typename executor_type, typename logger_type, typename tracer_type>
+    void connection_data_impl<router_type, request_type, stream_type, executor_type, logger_type, tracer_type>::drain() noexcept
+    {
+        // no more requests are read, and the last
+        // response asks the client to close
+        close = true;
+
+        // are requests in flight, or has the client started sending one?
+        if (writing || !responses.empty() || buffer.size() != 0 || (parser && parser->got_some())) {
+            // then we close after they are answered
+            return;
+        }
+
+        // the connection is idle, so we close now
+        abort();
+    }
+
+    /**
+     *  Abort the connection after an error
+     */
+    template <class router_type, class request_type, typename stream_type, typename executor_type, typename logger_type, typename tracer_type>
+    void connection_data_impl<router_type, request_type, stream_type, executor_type, logger_type, tracer_type>::abort() noexcept
+    {
+        // the error code from closing, which we ignore
+        boost::system::error_code ec;
+
+        // no more requests will be handled, close the socket
+        // so that any operations still pending are cancelled
+        close = true;
+        boost::beast::get_lowest_layer(socket).close(ec);
+    }
+
+    /**
+     *  Set the deadline for the client, if
+     *  we are waiting for it to send data
+     */
+    template <class router_type, class request_type, typename stream_type, typename executor_type, typename logger_type, typename tracer_type>
+    void connection_data_impl<router_type, request_type, stream_type, executor_type, logger_type, tracer_type>::wait_for_client() noexcept
+    {
+        // a write has its own deadline
+        if (writing) {
+            return;
+        }
+
+        // while requests are handled, the client
+        // is waiting for us instead
+        if (!reading || !responses.empty()) {
+            return slot.get_timer_wheel().disarm(deadline);
+        }
+
+        // is the body of a request being read?
+        if (parser && parser->is_header_done()) {
+            return set_deadline(options.body_timeout);
+        }
+
+        // an idle connection may wait for the next request, but
+        // once it starts, the client must send the header in time
+        set_deadline(idle && buffer.size() == 0 ? options.idle_timeout : options.header_timeout);
+    }
+
+    /**
+     *  Set the deadline for the connection
+     *
+     *  @param  timeout The time until the connection is aborted, zero to disable
+     */
+    template <class router_type, class request_type, typename stream_type, typename executor_type, typename logger_type, typename tracer_type>
+    void connection_data_impl<router_type, request_type, stream_type, executor_type, logger_type, tracer_type>::set_deadline(std::chrono::milliseconds timeout) noexcept
+    {
+        // is the timeout disabled?
+        if (timeout.count() == 0) {
+            return slot.get_timer_wheel().disarm(deadline);
         }
 
-        // reset the request
-        request = request_type{};
+        // arm the timer, replacing the previous deadline
+        slot.get_timer_wheel().arm(deadline, timeout);
     }
 
     /**
-     *  Write response data
+     *  Handle the deadline of a connection passing
      *
-     *  @param  response    The response message to write
+     *  @param  context The connection that timed out
      */
-    template <class router_type, class body_type, typename stream_type, typename executor_type>
-    void connection_data_impl<router_type, body_type, stream_type, executor_type>::write_response(data_source& response) noexcept
+    template <class router_type, class request_type, typename stream_type, typename executor_type, typename logger_type, typename tracer_type>
+    void connection_data_impl<router_type, request_type, stream_type, executor_type, logger_type, tracer_type>::expired(void* context) noexcept
     {
-        // start sending the response over the stream
-        async_send_data(socket, response, write_operation{ this->shared_from_this() });
+        // the client took too long, pending
+        // operations are cancelled by closing
+        static_cast<connection_data_impl*>(context)->abort();
     }
 
 }
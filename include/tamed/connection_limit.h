@@ -0,0 +1,253 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+
+namespace tamed {
+
+    /**
+     *  A limit on the number of live connections
+     *
+     *  Acceptors take a place before accepting a connection,
+     *  and the connection gives it back when it closes. An
+     *  acceptor that finds the limit reached leaves new
+     *  connections in the backlog, and registers to be woken
+     *  up once a connection closes.
+     *
+     *  Places are taken on the thread running the acceptor and
+     *  returned on the thread running the connection, so the
+     *  limit is synchronized. The mutex is only used when an
+     *  acceptor has to wait, which should be rare.
+     */
+    class connection_limit
+    {
+        public:
+            /**
+             *  The callback to resume a waiting acceptor
+             */
+            using waiter_type = std::function<void()>;
+
+            /**
+             *  Constructor
+             */
+            connection_limit() noexcept = default;
+
+            /**
+             *  Acceptors refer to the limit,
+             *  so it cannot be moved
+             */
+            connection_limit(const connection_limit&) = delete;
+            connection_limit(connection_limit&&) = delete;
+
+            /**
+             *  Take a place for a new connection
+             *
+             *  @param  limit   The maximum number of connections, zero for no limit
+             *  @return Whether there was room for the connection
+             */
+            bool acquire(std::size_t limit) noexcept
+            {
+                // the number of connections we have now
+                auto count = _count.load(std::memory_order_relaxed);
+
+                // increase the number, as long as we stay within the limit
+                while (limit == 0 || count < limit) {
+                    // try to claim the place
+                    if (_count.compare_exchange_weak(count, count + 1)) {
+                        return true;
+                    }
+                }
+
+                // the limit was reached
+                return false;
+            }
+
+            /**
+             *  Take a place for a new connection, or register
+             *  to be woken up when a place becomes available
+             *
+             *  @param  limit   The maximum number of connections, zero for no limit
+             *  @param  waiter  The callback to invoke when a connection closes
+             *  @return Whether there was room for the connection
+             */
+            bool acquire(std::size_t limit, waiter_type&& waiter)
+            {
+                // is there room for the connection?
+                if (acquire(limit)) {
+                    return true;
+                }
+
+                // lock the waiters
+                std::lock_guard lock{ _mutex };
+
+                // register the waiter, before checking again, so a
+                // connection that closed in between does not go unnoticed
+                _waiters.push_back(std::move(waiter));
+                _waiting.store(true);
+
+                // did a connection close in the meantime?
+                if (acquire(limit)) {
+                    // then we do not have to wait
+                    _waiters.pop_back();
+                    _waiting.store(!_waiters.empty());
+                    return true;
+                }
+
+                // we have to wait for a connection to close
+                return false;
+            }
+
+            /**
+             *  Return the place of a closed connection
+             */
+            void release()
+            {
+                // the connection is gone, was it the last one?
+                if (_count.fetch_sub(1) == 1) {
+                    // then the limit is empty
+                    emptied();
+                }
+
+                // is anyone waiting for a place?
+                if (!_waiting.load()) {
+                    return;
+                }
+
+                // the waiters to wake up
+                std::vector<waiter_type> waiters;
+
+                // take the waiters from the list
+                {
+                    // lock the waiters
+                    std::lock_guard lock{ _mutex };
+
+                    // take all the waiters
+                    waiters.swap(_waiters);
+                    _waiting.store(false);
+                }
+
+                // wake up the waiters, they will check
+                // for room again before accepting
+                for (auto& waiter : waiters) {
+                    // resume the waiter
+                    waiter();
+                }
+            }
+
+            /**
+             *  Register a callback for when all connections
+             *  have closed, replacing an earlier callback
+             *
+             *  @param  callback    The callback to invoke, immediately if there are no connections
+             */
+            void on_empty(waiter_type&& callback)
+            {
+                // check and store under the lock, so we cannot miss
+                // the last connection closing in the meantime
+                {
+                    // lock the callback
+                    std::lock_guard lock{ _mutex };
+
+                    // are there connections left?
+                    if (_count.load() != 0) {
+                        // wait for them to close
+                        _empty = std::move(callback);
+                        return;
+                    }
+                }
+
+                // all connections are closed already
+                callback();
+            }
+
+            /**
+             *  Retrieve the number of live connections
+             *
+             *  @return The number of places taken
+             */
+            std::size_t size() const noexcept
+            {
+                return _count.load(std::memory_order_relaxed);
+            }
+        private:
+            /**
+             *  Invoke the callback for the last connection closing
+             */
+            void emptied()
+            {
+                // the callback to invoke
+                waiter_type callback;
+
+                // take the callback, it is only invoked once
+                {
+                    // lock the callback
+                    std::lock_guard lock{ _mutex };
+
+                    // take the callback
+                    callback.swap(_empty);
+                }
+
+                // invoke the callback, if there is one
+                if (callback) {
+                    callback();
+                }
+            }
+
+            std::atomic<std::size_t>    _count{ 0 };        // the number of live connections
+            std::atomic<bool>           _waiting{ false };  // are there waiters registered
+            std::mutex                  _mutex;             // the lock for the waiters
+            std::vector<waiter_type>    _waiters;           // the callbacks to resume waiting acceptors
+            waiter_type                 _empty;             // the callback for when all connections have closed
+    };
+
+    /**
+     *  The places a connection holds in the limits, which
+     *  are returned when the connection closes
+     */
+    class connection_permit
+    {
+        public:
+            /**
+             *  Constructor
+             *
+             *  @param  listener    The limit for the listener that accepted the connection
+             *  @param  global      The limit for all connections of the server
+             */
+            connection_permit(std::shared_ptr<connection_limit> listener, std::shared_ptr<connection_limit> global) noexcept :
+                _listener{ std::move(listener) },
+                _global{ std::move(global) }
+            {}
+
+            /**
+             *  The places can only be returned once
+             */
+            connection_permit(const connection_permit&) = delete;
+            connection_permit(connection_permit&&) noexcept = default;
+
+            /**
+             *  Destructor
+             */
+            ~connection_permit()
+            {
+                // return the place for the server
+                if (_global != nullptr) {
+                    _global->release();
+                }
+
+                // and the place for the listener
+                if (_listener != nullptr) {
+                    _listener->release();
+                }
+            }
+        private:
+            std::shared_ptr<connection_limit>   _listener;  // the limit for the listener
+            std::shared_ptr<connection_limit>   _global;    // the limit for the server
+    };
+
+}
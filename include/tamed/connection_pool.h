@@ -0,0 +1,308 @@
+#pragma once
+
+#include <boost/beast/core/flat_buffer.hpp>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <vector>
+#include "allocation_statistics.h"
+
+
+namespace tamed {
+
+    /**
+     *  A pool of recycled connection storage for
+     *  a single executor.
+     *
+     *  The pool keeps the memory of closed connections,
+     *  as well as their read buffers, so new connections
+     *  can be created without going through malloc.
+     *
+     *  Storage is taken on the thread that accepts the
+     *  connection and returned on the thread running it,
+     *  so access to the free lists is synchronized.
+     */
+    class connection_pool
+    {
+        public:
+            /**
+             *  Constructor
+             *
+             *  @param  size            The maximum number of idle entries to keep
+             *  @param  buffer_limit    The maximum capacity of a buffer to keep
+             *  @param  statistics      The statistics to count recycled storage in, if any
+             *  @throws std::bad_alloc
+             */
+            connection_pool(std::size_t size, std::size_t buffer_limit, allocation_statistics* statistics = nullptr) :
+                _size{ size },
+                _buffer_limit{ buffer_limit },
+                _statistics{ statistics }
+            {
+                // reserve the free lists up front, so that
+                // returning storage never has to allocate
+                _chunks.reserve(_size);
+                _buffers.reserve(_size);
+            }
+
+            /**
+             *  Copying and moving is not allowed, the
+             *  allocators refer back to the pool
+             */
+            connection_pool(const connection_pool&) = delete;
+            connection_pool(connection_pool&&) = delete;
+
+            /**
+             *  Destructor
+             */
+            ~connection_pool()
+            {
+                // free all the memory we are holding on to
+                for (auto* chunk : _chunks) {
+                    // this memory is no longer used
+                    ::operator delete(chunk);
+                }
+            }
+
+            /**
+             *  Allocate memory for a connection
+             *
+             *  @param  size    The number of bytes to allocate
+             *  @return Pointer to the allocated memory
+             *  @throws std::bad_alloc
+             */
+            void* allocate(std::size_t size)
+            {
+                // check whether we can recycle a chunk
+                {
+                    // lock the free list
+                    std::lock_guard lock{ _mutex };
+
+                    // chunks can only be recycled if the size matches
+                    if (size == _chunk_size && !_chunks.empty()) {
+                        // take the last chunk from the list
+                        auto* result = _chunks.back();
+                        _chunks.pop_back();
+                        record_connection(true);
+                        return result;
+                    }
+                }
+
+                // allocate new memory
+                record_connection(false);
+                return ::operator new(size);
+            }
+
+            /**
+             *  Return the memory of a connection
+             *
+             *  @param  pointer The memory to deallocate
+             *  @param  size    The number of bytes that were allocated
+             */
+            void deallocate(void* pointer, std::size_t size) noexcept
+            {
+                // check whether we can keep the chunk
+                {
+                    // lock the free list
+                    std::lock_guard lock{ _mutex };
+
+                    // the first chunk decides on the size to recycle
+                    if (_chunk_size == 0) {
+                        // all connections for the pool have the same type
+                        _chunk_size = size;
+                    }
+
+                    // can we keep the memory for another connection
+                    if (size == _chunk_size && _chunks.size() < _size) {
+                        // store the chunk, the list has room for it
+                        _chunks.push_back(pointer);
+                        return;
+                    }
+                }
+
+                // too many idle chunks, release the memory
+                ::operator delete(pointer);
+            }
+
+            /**
+             *  Take a read buffer
+             *
+             *  @return A recycled buffer, or an empty buffer if none are available
+             */
+            boost::beast::flat_buffer acquire_buffer() noexcept
+            {
+                // lock the free list
+                std::lock_guard lock{ _mutex };
+
+                // do we have a buffer to recycle
+                if (_buffers.empty()) {
+                    // start with a fresh buffer
+                    record_buffer(false);
+                    return boost::beast::flat_buffer{};
+                }
+
+                // take the last buffer from the list
+                auto result = std::move(_buffers.back());
+                _buffers.pop_back();
+                record_buffer(true);
+                return result;
+            }
+
+            /**
+             *  Return a read buffer
+             *
+             *  @param  buffer  The buffer that is no longer used
+             */
+            void release_buffer(boost::beast::flat_buffer&& buffer) noexcept
+            {
+                // a buffer without capacity is not worth keeping,
+                // and a buffer that grew too large would hold on
+                // to too much memory for an idle connection
+                if (buffer.capacity() == 0 || buffer.capacity() > _buffer_limit) {
+                    return;
+                }
+
+                // discard any unread data
+                buffer.clear();
+
+                // lock the free list
+                std::lock_guard lock{ _mutex };
+
+                // can we keep the buffer
+                if (_buffers.size() < _size) {
+                    // store the buffer for the next connection, the list has room for it
+                    _buffers.push_back(std::move(buffer));
+                }
+            }
+        private:
+            /**
+             *  Count the storage taken for a connection
+             *
+             *  @param  recycled    Whether the storage came from the pool
+             */
+            void record_connection(bool recycled) noexcept
+            {
+                // are we keeping statistics?
+                if (_statistics != nullptr) {
+                    _statistics->record_connection(recycled);
+                }
+            }
+
+            /**
+             *  Count the read buffer taken for a connection
+             *
+             *  @param  recycled    Whether the buffer came from the pool
+             */
+            void record_buffer(bool recycled) noexcept
+            {
+                // are we keeping statistics?
+                if (_statistics != nullptr) {
+                    _statistics->record_buffer(recycled);
+                }
+            }
+
+            std::mutex                              _mutex;             // the mutex protecting the free lists
+            std::size_t                             _size;              // the maximum number of idle entries
+            std::size_t                             _buffer_limit;      // the maximum capacity of a recycled buffer
+            std::size_t                             _chunk_size{ 0 };   // the size of the recycled chunks
+            std::vector<void*>                      _chunks;            // the recycled connection memory
+            std::vector<boost::beast::flat_buffer>  _buffers;           // the recycled read buffers
+            allocation_statistics*                  _statistics;        // the statistics on recycled storage
+    };
+
+    /**
+     *  Allocator to allocate connections
+     *  from a connection pool
+     */
+    template <typename T>
+    class pool_allocator
+    {
+        public:
+            using value_type = T;
+
+            /**
+             *  The memory comes from operator new,
+             *  which only guarantees this alignment
+             */
+            static_assert(alignof(T) <= __STDCPP_DEFAULT_NEW_ALIGNMENT__);
+
+            /**
+             *  Constructor
+             *
+             *  @param  pool    The pool to allocate from
+             */
+            pool_allocator(std::shared_ptr<connection_pool> pool) noexcept :
+                _pool{ std::move(pool) }
+            {}
+
+            /**
+             *  Constructor
+             *
+             *  @param  that    The allocator to rebind
+             */
+            template <typename U>
+            pool_allocator(const pool_allocator<U>& that) noexcept :
+                _pool{ that.pool() }
+            {}
+
+            /**
+             *  Allocate memory for objects
+             *
+             *  @param  count   The number of objects to allocate
+             *  @return Pointer to the allocated memory
+             *  @throws std::bad_alloc
+             */
+            T* allocate(std::size_t count)
+            {
+                return static_cast<T*>(_pool->allocate(sizeof(T) * count));
+            }
+
+            /**
+             *  Deallocate memory
+             *
+             *  @param  pointer The memory to deallocate
+             *  @param  count   The number of objects that were allocated
+             */
+            void deallocate(T* pointer, std::size_t count) noexcept
+            {
+                _pool->deallocate(pointer, sizeof(T) * count);
+            }
+
+            /**
+             *  Retrieve the pool to allocate from
+             *
+             *  @return The connection pool
+             */
+            const std::shared_ptr<connection_pool>& pool() const noexcept
+            {
+                return _pool;
+            }
+
+            /**
+             *  Compare allocators
+             *
+             *  @param  that    The allocator to compare with
+             *  @return Whether memory from one can be deallocated by the other
+             */
+            template <typename U>
+            bool operator==(const pool_allocator<U>& that) const noexcept
+            {
+                return _pool == that.pool();
+            }
+
+            /**
+             *  Compare allocators
+             *
+             *  @param  that    The allocator to compare with
+             *  @return Whether memory from one cannot be deallocated by the other
+             */
+            template <typename U>
+            bool operator!=(const pool_allocator<U>& that) const noexcept
+            {
+                return _pool != that.pool();
+            }
+        private:
+            std::shared_ptr<connection_pool>    _pool;  // the pool to allocate from
+    };
+
+}
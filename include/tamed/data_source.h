@@ -1,8 +1,9 @@
 #pragma once
 
 #include <cstddef>
-#include <boost/asio/buffer.hpp>
-#include <boost/container/static_vector.hpp>
+#include <boost/system/error_code.hpp>
+#include "gather_buffers.h"
+#include "send_file.h"
 
 
 namespace tamed {
@@ -14,9 +15,9 @@ namespace tamed {
     {
         public:
             /**
-             *  The container we use for data buffers/
+             *  The container we use for data buffers
              */
-            using buffers_type = boost::container::static_vector<boost::asio::const_buffer, 8>;
+            using buffers_type = gather_buffers;
 
 
             /**
@@ -31,13 +32,53 @@ namespace tamed {
              */
             virtual bool is_done() noexcept = 0;
 
+            /**
+             *  Is the data from the last call to next() all
+             *  that remains? When it is, the data source is
+             *  done as soon as those buffers are consumed, and
+             *  data from another source can be sent after it
+             *  in the same write.
+             *
+             *  @return Whether the last buffers complete the data
+             */
+            virtual bool is_final_batch() noexcept
+            {
+                // we cannot tell in general
+                return false;
+            }
+
             /**
              *  Retrieve bytes to be sent
              *
+             *  @param  buffers The array to add the buffers to be sent to
              *  @param  ec      The error code from getting the data
-             *  @return An array of buffers to be sent
              */
-            virtual buffers_type next(boost::system::error_code& ec) noexcept = 0;
+            virtual void next(buffers_type& buffers, boost::system::error_code& ec) noexcept = 0;
+
+            /**
+             *  Ask the client to close the connection after
+             *  this response. This only has an effect while
+             *  none of the data was retrieved yet.
+             */
+            virtual void close() noexcept
+            {
+                // the data cannot be changed in general
+            }
+
+            /**
+             *  Retrieve a part of a file that can be sent
+             *  directly, instead of through next(). Once
+             *  a region is returned, the data of the source
+             *  continues from the file.
+             *
+             *  @return The part of the file, or a region without
+             *          descriptor when the next data is not in a file
+             */
+            virtual file_region next_file() noexcept
+            {
+                // not backed by a file
+                return {};
+            }
 
             /**
              *  Consume bytes
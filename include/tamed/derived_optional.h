@@ -1,6 +1,9 @@
 #pragma once
 
 #include <type_traits>
+#include <optional>
+#include <cstring>
+#include <new>
 #include <utility>
 
 
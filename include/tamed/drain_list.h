@@ -0,0 +1,232 @@
+#pragma once
+
+#include <mutex>
+
+
+namespace tamed {
+
+    /**
+     *  The list of acceptors and connections running on an
+     *  executor, which are stopped when the server drains
+     *
+     *  Entries are added and drained on the executor of the
+     *  list, but the last reference to an entry may be dropped
+     *  on any thread, so the list is protected by a lock.
+     */
+    class drain_list
+    {
+        public:
+            /**
+             *  An acceptor or connection that can be drained
+             *
+             *  The entry removes itself from the list when it
+             *  is destructed.
+             */
+            class entry
+            {
+                public:
+                    /**
+                     *  Stop taking new work, and close once
+                     *  the work in progress is finished
+                     */
+                    virtual void drain() noexcept = 0;
+
+                    /**
+                     *  Close immediately
+                     */
+                    virtual void abort() noexcept = 0;
+                protected:
+                    /**
+                     *  Constructor
+                     */
+                    entry() noexcept = default;
+
+                    /**
+                     *  The list refers to the entry,
+                     *  so it cannot be moved
+                     */
+                    entry(const entry&) = delete;
+                    entry(entry&&) = delete;
+
+                    /**
+                     *  Destructor
+                     */
+                    ~entry()
+                    {
+                        // remove the entry, in case the derived class did not
+                        leave();
+                    }
+
+                    /**
+                     *  Remove the entry from the list it is in
+                     *
+                     *  The derived class must call this first thing in its
+                     *  destructor, the list could otherwise drain the entry
+                     *  on another thread while it is being destroyed.
+                     */
+                    void leave() noexcept
+                    {
+                        // are we in a list at all?
+                        if (_list != nullptr) {
+                            _list->remove(*this);
+                        }
+                    }
+                private:
+                    friend class drain_list;
+
+                    entry*      _previous{ nullptr };   // the previous entry in the list
+                    entry*      _next{ nullptr };       // the next entry in the list
+                    drain_list* _list{ nullptr };       // the list the entry is in
+            };
+
+            /**
+             *  Constructor
+             */
+            drain_list() noexcept = default;
+
+            /**
+             *  The entries refer to the list,
+             *  so it cannot be moved
+             */
+            drain_list(const drain_list&) = delete;
+            drain_list(drain_list&&) = delete;
+
+            /**
+             *  Destructor
+             *
+             *  Entries may outlive the list, when their pending
+             *  operations are destroyed after the server, so they
+             *  are told that they are no longer in a list
+             */
+            ~drain_list()
+            {
+                // lock the entries
+                std::lock_guard lock{ _mutex };
+
+                // detach all the entries
+                while (_first != nullptr) {
+                    // remove the first entry
+                    unlink(*_first);
+                }
+            }
+
+            /**
+             *  Add an entry to the list
+             *
+             *  @param  item    The entry to add
+             *  @return Whether the list is draining, in which case the entry should drain itself
+             */
+            bool add(entry& item) noexcept
+            {
+                // lock the entries
+                std::lock_guard lock{ _mutex };
+
+                // add the entry at the front
+                item._previous  = nullptr;
+                item._next      = _first;
+                item._list      = this;
+
+                // link the first entry back to the new one
+                if (_first != nullptr) {
+                    _first->_previous = &item;
+                }
+
+                // the entry is now the first in the list
+                _first = &item;
+                return _draining;
+            }
+
+            /**
+             *  Remove an entry from the list
+             *
+             *  @param  item    The entry to remove
+             */
+            void remove(entry& item) noexcept
+            {
+                // lock the entries
+                std::lock_guard lock{ _mutex };
+
+                // the entry may have been detached while we waited
+                if (item._list == this) {
+                    unlink(item);
+                }
+            }
+
+            /**
+             *  Drain all the entries, entries that are
+             *  added later are expected to drain as well
+             */
+            void drain() noexcept
+            {
+                // lock the entries, so they are not destroyed meanwhile
+                std::lock_guard lock{ _mutex };
+
+                // the list is now draining
+                _draining = true;
+
+                // drain all the entries, they do not remove
+                // themselves from the list while draining
+                for (auto* item = _first; item != nullptr; item = item->_next) {
+                    // drain the entry
+                    item->drain();
+                }
+            }
+
+            /**
+             *  Abort all the entries
+             */
+            void abort() noexcept
+            {
+                // lock the entries, so they are not destroyed meanwhile
+                std::lock_guard lock{ _mutex };
+
+                // abort all the entries, they do not remove
+                // themselves from the list while aborting
+                for (auto* item = _first; item != nullptr; item = item->_next) {
+                    // abort the entry
+                    item->abort();
+                }
+            }
+
+            /**
+             *  Is the list draining?
+             *
+             *  @return Whether drain() was called
+             */
+            bool draining() const noexcept
+            {
+                return _draining;
+            }
+        private:
+            /**
+             *  Remove an entry from the list
+             *
+             *  @param  item    The entry to remove
+             *  @precondition   The lock must be held
+             */
+            void unlink(entry& item) noexcept
+            {
+                // connect the neighbours to each other
+                if (item._previous != nullptr) {
+                    item._previous->_next = item._next;
+                } else {
+                    _first = item._next;
+                }
+
+                // and the other way around
+                if (item._next != nullptr) {
+                    item._next->_previous = item._previous;
+                }
+
+                // the entry is no longer in the list
+                item._previous  = nullptr;
+                item._next      = nullptr;
+                item._list      = nullptr;
+            }
+
+            std::mutex  _mutex;                 // the lock protecting the entries
+            entry*      _first{ nullptr };      // the first entry in the list
+            bool        _draining{ false };     // are the entries draining
+    };
+
+}
@@ -1,6 +1,8 @@
 #pragma once
 
 #include <stdexcept>
+#include <algorithm>
+#include <type_traits>
 #include <array>
 
 
@@ -16,6 +18,11 @@ namespace tamed {
             using key_type      = Key;
             using mapped_type   = T;
 
+            /**
+             *  The index returned for keys that are not in the map
+             */
+            constexpr const static std::size_t npos = sizeof...(Values);
+
             /**
              *  Access specified element
              *
@@ -49,7 +56,7 @@ namespace tamed {
              */
             const mapped_type& at(key_type key) const
             {
-                return _values[find_index(key)];
+                return _values.at(index(key));
             }
 
             /**
@@ -61,7 +68,7 @@ namespace tamed {
              */
             mapped_type& at(key_type key)
             {
-                return _values[find_index(key)];
+                return _values.at(index(key));
             }
 
             /**
@@ -97,7 +104,49 @@ namespace tamed {
              */
             mapped_type& operator[](key_type key)
             {
-                return _values[find_index(key)];
+                return _values.at(index(key));
+            }
+
+            /**
+             *  Find the element for a key
+             *
+             *  @param  key The key to look up
+             *  @return Pointer to the mapped type, or a nullptr if the key is not in the map
+             */
+            const mapped_type* find(key_type key) const noexcept
+            {
+                // look up the index, and check for the sentinel
+                auto position = index(key);
+                return position == npos ? nullptr : &_values[position];
+            }
+
+            /**
+             *  Find the element for a key
+             *
+             *  @param  key The key to look up
+             *  @return Pointer to the mapped type, or a nullptr if the key is not in the map
+             */
+            mapped_type* find(key_type key) noexcept
+            {
+                // look up the index, and check for the sentinel
+                auto position = index(key);
+                return position == npos ? nullptr : &_values[position];
+            }
+
+            /**
+             *  Find the index for a key
+             *
+             *  @param  key The key to look up
+             *  @return Index of the key, or npos if the key is not in the map
+             */
+            static std::size_t index(key_type key) noexcept
+            {
+                // the index for every key value, generated at compile time
+                constexpr static auto indices = make_indices();
+
+                // keys outside the table are moved to the final
+                // entry, which is never used by any of the values
+                return indices[std::min(value_of(key), indices.size() - 1)];
             }
 
             /**
@@ -112,31 +161,53 @@ namespace tamed {
             }
         private:
             /**
-             *  Match the given value against all
-             *  of the valid options.
+             *  The underlying value of a key
              *
-             *  @tparam I       The current option being tried
-             *  @param  value   The value being matched
-             *  @return Index of the matched value
-             *  @throws std::out_of_range
+             *  @param  key The key to convert
+             *  @return The value of the key
+             */
+            constexpr static std::size_t value_of(key_type key) noexcept
+            {
+                return static_cast<std::make_unsigned_t<std::underlying_type_t<key_type>>>(key);
+            }
+
+            /**
+             *  The largest underlying value of the keys
+             *
+             *  @return The largest value, or zero for a map without keys
+             */
+            constexpr static std::size_t largest_value() noexcept
+            {
+                // start at zero, so an empty map has a value as well
+                std::size_t result{ 0 };
+
+                // keep the largest of the values
+                ((result = std::max(result, value_of(Values))), ...);
+                return result;
+            }
+
+            /**
+             *  Build the table mapping the value of every key
+             *  to its index, the table extends one entry past
+             *  the largest key, all unused entries hold npos
+             *
+             *  @return The table with the index for every value
              */
-            template <std::size_t I = 0>
-            constexpr static std::size_t find_index(key_type value)
+            constexpr static auto make_indices() noexcept
             {
-                // is the index in a valid range?
-                if constexpr (I >= size()) {
-                    // the index is out of range
-                    throw std::out_of_range{ "The value is out of range" };
-                } else {
-                    // did we find a matching value?
-                    if (std::get<I>(std::make_tuple(Values...)) == value) {
-                        // matching value found
-                        return I;
-                    } else {
-                        // try the next index
-                        return find_index<I + 1>(value);
-                    }
+                // the table to fill, and the index of the next key
+                std::array<std::size_t, largest_value() + 2> result{};
+                std::size_t position{ 0 };
+
+                // no key maps to any of the entries yet
+                for (auto& entry : result) {
+                    entry = npos;
                 }
+
+                // store the index for every key
+                ((result[value_of(Values)] = position++), ...);
+                static_cast<void>(position);
+                return result;
             }
 
             std::array<mapped_type, size()> _values;
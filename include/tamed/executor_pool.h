@@ -0,0 +1,385 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <vector>
+#include "connection_limit.h"
+#include "drain_list.h"
+#include "allocation_statistics.h"
+#include "handshake_statistics.h"
+#include "routing_statistics.h"
+#include "request_statistics.h"
+#include "timer_wheel.h"
+#include "write_statistics.h"
+
+
+namespace tamed {
+
+    /**
+     *  The policy for choosing the executor
+     *  to run a new connection on
+     */
+    enum class dispatch_policy
+    {
+        round_robin,    // cycle through the executors in order
+        least_loaded    // choose the executor with the fewest live connections
+    };
+
+    /**
+     *  The number of live connections on an executor
+     *
+     *  Connections share ownership of the count, since
+     *  they can outlive the server when the io_context
+     *  destroys their pending handlers after it.
+     */
+    struct alignas(64) connection_count
+    {
+        std::atomic<std::size_t>    value{ 0 };     // the number of live connections, on its own cache line
+    };
+
+    /**
+     *  The place a connection holds in the count of
+     *  its executor, which is returned when it closes
+     */
+    class connection_registration
+    {
+        public:
+            /**
+             *  Constructor
+             *
+             *  @param  count   The count of the executor the connection runs on
+             */
+            connection_registration(std::shared_ptr<connection_count> count) noexcept :
+                _count{ std::move(count) }
+            {
+                // the connection now runs on the executor
+                _count->value.fetch_add(1, std::memory_order_relaxed);
+            }
+
+            /**
+             *  The place can only be returned once
+             */
+            connection_registration(const connection_registration&) = delete;
+            connection_registration(connection_registration&&) noexcept = default;
+
+            /**
+             *  Destructor
+             */
+            ~connection_registration()
+            {
+                // the connection no longer runs on the executor
+                if (_count != nullptr) {
+                    _count->value.fetch_sub(1, std::memory_order_relaxed);
+                }
+            }
+        private:
+            std::shared_ptr<connection_count>   _count;     // the count of the executor
+    };
+
+    /**
+     *  A pool of executors that connections
+     *  can be distributed over
+     */
+    template <typename executor_type>
+    class executor_pool
+    {
+        public:
+            /**
+             *  The state kept for every executor
+             */
+            class slot
+            {
+                public:
+                    /**
+                     *  Constructor
+                     *
+                     *  @param  executor    The executor for the slot
+                     *  @param  index       The index of the slot in the pool
+                     */
+                    slot(executor_type executor, std::size_t index) :
+                        _executor{ executor },
+                        _index{ index },
+                        _timers{ executor }
+                    {}
+
+                    /**
+                     *  Retrieve the executor
+                     *
+                     *  @return The executor for the slot
+                     */
+                    executor_type get_executor() const noexcept
+                    {
+                        return _executor;
+                    }
+
+                    /**
+                     *  Retrieve the index of the slot
+                     *
+                     *  @return The index of the slot in the pool
+                     */
+                    std::size_t index() const noexcept
+                    {
+                        return _index;
+                    }
+
+                    /**
+                     *  Retrieve the number of live connections
+                     *
+                     *  @return The number of connections running on the executor
+                     */
+                    std::size_t connections() const noexcept
+                    {
+                        return _connections->value.load(std::memory_order_relaxed);
+                    }
+
+                    /**
+                     *  Register a new connection
+                     *
+                     *  @return The registration, which unregisters the connection when destroyed
+                     */
+                    connection_registration add_connection() noexcept
+                    {
+                        return connection_registration{ _connections };
+                    }
+
+                    /**
+                     *  Retrieve the routing statistics
+                     *
+                     *  @return The statistics on the requests routed on the executor
+                     */
+                    routing_statistics& get_routing_statistics() noexcept
+                    {
+                        return _routing;
+                    }
+
+                    /**
+                     *  Retrieve the routing statistics
+                     *
+                     *  @return The statistics on the requests routed on the executor
+                     */
+                    const routing_statistics& get_routing_statistics() const noexcept
+                    {
+                        return _routing;
+                    }
+
+                    /**
+                     *  Retrieve the request statistics
+                     *
+                     *  @return The statistics on the requests answered on the executor
+                     */
+                    request_statistics& get_request_statistics() noexcept
+                    {
+                        return _requests;
+                    }
+
+                    /**
+                     *  Retrieve the request statistics
+                     *
+                     *  @return The statistics on the requests answered on the executor
+                     */
+                    const request_statistics& get_request_statistics() const noexcept
+                    {
+                        return _requests;
+                    }
+
+                    /**
+                     *  Retrieve the handshake statistics
+                     *
+                     *  @return The statistics on the TLS handshakes on the executor
+                     */
+                    handshake_statistics& get_handshake_statistics() noexcept
+                    {
+                        return _handshakes;
+                    }
+
+                    /**
+                     *  Retrieve the handshake statistics
+                     *
+                     *  @return The statistics on the TLS handshakes on the executor
+                     */
+                    const handshake_statistics& get_handshake_statistics() const noexcept
+                    {
+                        return _handshakes;
+                    }
+
+                    /**
+                     *  Retrieve the allocation statistics
+                     *
+                     *  @return The statistics on the storage for connections on the executor
+                     */
+                    allocation_statistics& get_allocation_statistics() noexcept
+                    {
+                        return _allocations;
+                    }
+
+                    /**
+                     *  Retrieve the allocation statistics
+                     *
+                     *  @return The statistics on the storage for connections on the executor
+                     */
+                    const allocation_statistics& get_allocation_statistics() const noexcept
+                    {
+                        return _allocations;
+                    }
+
+                    /**
+                     *  Retrieve the write statistics
+                     *
+                     *  @return The statistics on the writes of the connections on the executor
+                     */
+                    write_statistics& get_write_statistics() noexcept
+                    {
+                        return _writes;
+                    }
+
+                    /**
+                     *  Retrieve the write statistics
+                     *
+                     *  @return The statistics on the writes of the connections on the executor
+                     */
+                    const write_statistics& get_write_statistics() const noexcept
+                    {
+                        return _writes;
+                    }
+
+                    /**
+                     *  Retrieve the timers
+                     *
+                     *  @return The timer wheel for the connections on the executor
+                     */
+                    timer_wheel& get_timer_wheel() noexcept
+                    {
+                        return _timers;
+                    }
+
+                    /**
+                     *  Retrieve the acceptors and connections
+                     *
+                     *  @return The list to drain the acceptors and connections on the executor
+                     */
+                    drain_list& get_drain_list() noexcept
+                    {
+                        return _drain;
+                    }
+                private:
+                    executor_type                           _executor;          // the executor to run on
+                    std::size_t                             _index;             // the index in the pool
+                    std::shared_ptr<connection_count>       _connections{ std::make_shared<connection_count>() };  // the number of live connections, shared with the connections
+                    alignas(64) write_statistics            _writes;            // the writes on the executor, on their own cache line
+                    routing_statistics                      _routing;           // the outcome of routing on the executor
+                    request_statistics                      _requests;          // the requests answered on the executor
+                    handshake_statistics                    _handshakes;        // the TLS handshakes on the executor
+                    alignas(64) allocation_statistics       _allocations;       // the storage for new connections, written by the acceptors
+                    timer_wheel                             _timers;            // the timeouts of the connections on the executor
+                    drain_list                              _drain;             // the acceptors and connections on the executor
+            };
+
+            /**
+             *  Constructor
+             *
+             *  @param  executors   The executors to distribute over
+             */
+            executor_pool(const std::vector<executor_type>& executors)
+            {
+                // create a slot for every executor
+                for (const auto& executor : executors) {
+                    // add the slot
+                    _slots.emplace_back(executor, _slots.size());
+                }
+            }
+
+            /**
+             *  Retrieve the number of executors
+             *
+             *  @return The number of slots in the pool
+             */
+            std::size_t size() const noexcept
+            {
+                return _slots.size();
+            }
+
+            /**
+             *  Is the pool empty?
+             *
+             *  @return Whether there are no executors
+             */
+            bool empty() const noexcept
+            {
+                return _slots.empty();
+            }
+
+            /**
+             *  Access the slot at the given index
+             *
+             *  @param  index   The index of the slot
+             *  @return The slot at the index
+             *  @precondition   The index must be smaller than size()
+             */
+            slot& operator[](std::size_t index) noexcept
+            {
+                return _slots[index];
+            }
+
+            const slot& operator[](std::size_t index) const noexcept
+            {
+                return _slots[index];
+            }
+
+            /**
+             *  Retrieve the limit on the connections
+             *
+             *  @return The limit shared by all listeners running connections
+             *          on the pool, connections share ownership of the limit
+             */
+            const std::shared_ptr<connection_limit>& get_connection_limit() const noexcept
+            {
+                return _limit;
+            }
+
+            /**
+             *  Choose the slot to run a new connection on
+             *
+             *  @param  policy  The policy to choose by
+             *  @return The chosen slot
+             */
+            slot& next(dispatch_policy policy) noexcept
+            {
+                // a single executor leaves no choice
+                if (_slots.size() == 1) {
+                    return _slots.front();
+                }
+
+                // check which policy to apply
+                switch (policy) {
+                    case dispatch_policy::least_loaded:
+                    {
+                        // start with the first slot
+                        slot* result = &_slots.front();
+
+                        // find the slot with the fewest connections
+                        for (auto& candidate : _slots) {
+                            // is this one less busy?
+                            if (candidate.connections() < result->connections()) {
+                                // use this slot instead
+                                result = &candidate;
+                            }
+                        }
+
+                        // return the least loaded slot
+                        return *result;
+                    }
+                    case dispatch_policy::round_robin:
+                    default:
+                        // cycle to the next slot
+                        return _slots[_next.fetch_add(1, std::memory_order_relaxed) % _slots.size()];
+                }
+            }
+        private:
+            std::deque<slot>                    _slots;         // the slot for every executor
+            std::atomic<std::size_t>            _next{ 0 };     // the next slot for round-robin dispatch
+            std::shared_ptr<connection_limit>   _limit{ std::make_shared<connection_limit>() };    // the limit on the connections over all executors
+    };
+
+}
@@ -0,0 +1,157 @@
+#pragma once
+
+#include <algorithm>
+#include <climits>
+#include <cstddef>
+#include <vector>
+#include <boost/asio/buffer.hpp>
+#include <boost/beast/core/span.hpp>
+#include <sys/uio.h>
+#include "recycling_allocator.h"
+
+
+namespace tamed {
+
+    /**
+     *  An array of buffers to be sent with a single
+     *  scatter-gather write, holding up to a maximum
+     *  number of buffers that is chosen at runtime
+     *
+     *  The buffers are kept in the form the system call
+     *  expects as well, so a write on a plain socket can
+     *  use them without converting them first.
+     */
+    class gather_buffers
+    {
+        public:
+            /**
+             *  The type of buffer we hold
+             */
+            using value_type        = boost::asio::const_buffer;
+            using const_iterator    = const value_type*;
+
+            /**
+             *  A lightweight buffer sequence referring
+             *  to the buffers, cheap to copy into an
+             *  asynchronous operation
+             */
+            using view_type         = boost::beast::span<const value_type>;
+
+            /**
+             *  The maximum number of buffers the
+             *  system accepts for a single write
+             */
+            #ifdef IOV_MAX
+                constexpr const static std::size_t max_width = IOV_MAX;
+            #else
+                constexpr const static std::size_t max_width = 1024;
+            #endif
+
+            /**
+             *  Constructor
+             *
+             *  @param  width   The maximum number of buffers, limited to max_width
+             */
+            gather_buffers(std::size_t width) :
+                _vectors(std::clamp<std::size_t>(width, 1, max_width))
+            {
+                // allocate the storage up front
+                _buffers.reserve(_vectors.size());
+            }
+
+            /**
+             *  Retrieve the number of buffers
+             *
+             *  @return The number of buffers added
+             */
+            std::size_t size() const noexcept
+            {
+                return _buffers.size();
+            }
+
+            /**
+             *  Retrieve the maximum number of buffers
+             *
+             *  @return The number of buffers that can be added
+             */
+            std::size_t capacity() const noexcept
+            {
+                return _vectors.size();
+            }
+
+            /**
+             *  Are there no buffers?
+             *
+             *  @return Whether no buffers were added
+             */
+            bool empty() const noexcept
+            {
+                return _buffers.empty();
+            }
+
+            /**
+             *  Remove all the buffers
+             */
+            void clear() noexcept
+            {
+                _buffers.clear();
+            }
+
+            /**
+             *  Add a buffer
+             *
+             *  @param  data    The data to send
+             *  @param  size    The number of bytes to send
+             *  @precondition   The number of buffers must be below capacity
+             */
+            void emplace_back(const void* data, std::size_t size) noexcept
+            {
+                // the system call does not modify the data
+                _vectors[_buffers.size()] = { const_cast<void*>(data), size };
+                _buffers.emplace_back(data, size);
+            }
+
+            /**
+             *  Retrieve a buffer
+             *
+             *  @param  index   The index of the buffer
+             *  @return The buffer at the given index
+             */
+            const value_type& operator[](std::size_t index) const noexcept
+            {
+                return _buffers[index];
+            }
+
+            /**
+             *  Iterate over the buffers
+             *
+             *  @return Iterator to the first buffer, or past the last one
+             */
+            const_iterator begin() const noexcept { return _buffers.data(); }
+            const_iterator end() const noexcept { return _buffers.data() + _buffers.size(); }
+
+            /**
+             *  Retrieve the buffers as a buffer sequence
+             *
+             *  @return A view on the buffers that were added
+             */
+            view_type view() const noexcept
+            {
+                return { _buffers.data(), _buffers.size() };
+            }
+
+            /**
+             *  Retrieve the buffers for a system call
+             *
+             *  @return The first of size() vectors describing the buffers
+             */
+            const iovec* vectors() const noexcept
+            {
+                return _vectors.data();
+            }
+        private:
+            std::vector<value_type, recycling_allocator<value_type>>    _buffers;   // the buffers to send
+            std::vector<iovec, recycling_allocator<iovec>>              _vectors;   // the buffers to send for the system call, one for every buffer that fits
+    };
+
+}
@@ -0,0 +1,157 @@
+#pragma once
+
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <cerrno>
+#include <type_traits>
+#include <boost/asio/post.hpp>
+#include <boost/asio/socket_base.hpp>
+#include <boost/beast/core/bind_handler.hpp>
+#include "gather_buffers.h"
+#include "stream_traits.h"
+
+
+namespace tamed {
+
+    /**
+     *  Asynchronous operation to write gathered
+     *  buffers directly to a native socket, with
+     *  as many buffers per system call as the
+     *  system allows
+     */
+    template <class socket_type, class handler_type>
+    class gather_write_operation
+    {
+        public:
+            /**
+             *  Constructor
+             *
+             *  @param  socket  The socket to write to
+             *  @param  buffers The buffers to write
+             *  @param  handler The completion handler to invoke
+             */
+            gather_write_operation(socket_type& socket, const gather_buffers& buffers, handler_type&& handler) noexcept :
+                _socket{ socket },
+                _buffers{ buffers },
+                _handler{ std::move(handler) }
+            {}
+
+            /**
+             *  Start the write, without waiting for
+             *  the socket if it can be written to
+             */
+            void start() noexcept
+            {
+                // the error code and number of bytes written
+                boost::system::error_code   ec;
+                std::size_t                 transferred{ 0 };
+
+                // try to write without waiting
+                if (!write(ec, transferred)) {
+                    // wait until the socket can be written to
+                    return _socket.async_wait(boost::asio::socket_base::wait_write, std::move(*this));
+                }
+
+                // we may not invoke the handler from within the initiating
+                // function, so the completion goes through the executor
+                boost::asio::post(_socket.get_executor(), boost::beast::bind_front_handler(std::move(_handler), ec, transferred));
+            }
+
+            /**
+             *  Callback handler for the socket becoming writable
+             *
+             *  @param  ec  The error code from the operation
+             */
+            void operator()(boost::system::error_code ec) noexcept
+            {
+                // the number of bytes written
+                std::size_t transferred{ 0 };
+
+                // did waiting for the socket fail?
+                if (ec != boost::system::error_code{}) {
+                    // report the error
+                    return _handler(ec, transferred);
+                }
+
+                // try to write the data
+                if (!write(ec, transferred)) {
+                    // the socket is not writable after all
+                    return _socket.async_wait(boost::asio::socket_base::wait_write, std::move(*this));
+                }
+
+                // the write has finished
+                _handler(ec, transferred);
+            }
+        private:
+            /**
+             *  Write the buffers to the socket
+             *
+             *  @param  ec          The error code from the write
+             *  @param  transferred The number of bytes written
+             *  @return Whether the write finished, or needs to wait for the socket
+             */
+            bool write(boost::system::error_code& ec, std::size_t& transferred) noexcept
+            {
+                // the message to send
+                msghdr message{};
+
+                // send all the buffers in one go, the system
+                // call does not modify the vectors
+                message.msg_iov     = const_cast<iovec*>(_buffers.vectors());
+                message.msg_iovlen  = _buffers.size();
+
+                while (true) {
+                    // write without blocking, and without raising a signal
+                    // when the peer has already closed the connection
+                    auto result = ::sendmsg(_socket.native_handle(), &message, MSG_DONTWAIT | MSG_NOSIGNAL);
+
+                    // did the write succeed?
+                    if (result >= 0) {
+                        transferred = static_cast<std::size_t>(result);
+                        return true;
+                    }
+
+                    // the write was interrupted, try again
+                    if (errno == EINTR) {
+                        continue;
+                    }
+
+                    // the socket buffer is full, wait for room
+                    if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                        return false;
+                    }
+
+                    // an error occurred
+                    ec.assign(errno, boost::system::system_category());
+                    return true;
+                }
+            }
+
+            socket_type&            _socket;    // the socket to write to
+            const gather_buffers&   _buffers;   // the buffers to write
+            handler_type            _handler;   // the completion handler to invoke
+    };
+
+    /**
+     *  Write gathered buffers to a stream asynchronously,
+     *  the handler receives the number of bytes written,
+     *  which may be less than the size of the buffers
+     *
+     *  @param  stream  The stream to write to
+     *  @param  buffers The buffers to write, which must stay valid until completion
+     *  @param  handler The completion handler
+     */
+    template <class stream_type, class handler_type>
+    void async_write_gathered(stream_type& stream, const gather_buffers& buffers, handler_type&& handler)
+    {
+        // can we write to the socket directly?
+        if constexpr (is_native_socket_v<stream_type>) {
+            // write with all the buffers in a single system call
+            gather_write_operation<stream_type, std::decay_t<handler_type>>{ stream, buffers, std::forward<handler_type>(handler) }.start();
+        } else {
+            // the stream transforms the data, so let it do the writing
+            stream.async_write_some(buffers.view(), std::forward<handler_type>(handler));
+        }
+    }
+
+}
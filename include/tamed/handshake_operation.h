@@ -8,14 +8,14 @@ namespace tamed {
     /**
      *  Read an incoming request
      */
-    template <class router_type, class body_type, typename stream_type, typename executor_type>
+    template <class router_type, class request_type, typename stream_type, typename executor_type, typename logger_type, typename tracer_type>
     class handshake_operation
     {
         public:
             /**
              *  The connection data type
              */
-            using data_type = connection_data_impl<router_type, body_type, stream_type, executor_type>;
+            using data_type = connection_data_impl<router_type, request_type, stream_type, executor_type, logger_type, tracer_type>;
 
             /**
              *  Constructor
@@ -37,20 +37,24 @@ namespace tamed {
             }
 
             /**
-             *  Handle the completion of reading the request
+             *  Handle the completion of the handshake
              *
              *  @param  ec      The error code from the operation
              */
-            void operator()(const boost::system::error_code& ec, std::size_t) noexcept
+            void operator()(const boost::system::error_code& ec) noexcept
             {
+                // count the handshake
+                _data->slot.get_handshake_statistics().record(!ec);
+
                 // did an error occur?
                 if (ec != boost::system::error_code{}) {
                     // log the error and abort
-                    std::cerr << "Error occurred during TLS handshake: " << ec.message() << std::endl;
+                    logger_type::log(log_level::warning, "Error occurred during TLS handshake: ", ec);
                     return;
                 }
 
-                // route the request
+                // the connection is secured, read the request
+                _data->tracer().reading(&request_timeline::handshake);
                 _data->read_request();
             }
         private:
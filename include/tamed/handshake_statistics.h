@@ -0,0 +1,83 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+
+namespace tamed {
+
+    /**
+     *  Statistics on the TLS handshakes performed
+     *  by the connections of an executor
+     */
+    class handshake_statistics
+    {
+        public:
+            /**
+             *  Constructor
+             */
+            handshake_statistics() noexcept = default;
+
+            /**
+             *  Copy constructor
+             *
+             *  @param  that    The statistics to copy
+             */
+            handshake_statistics(const handshake_statistics& that) noexcept
+            {
+                // add all the counters
+                *this += that;
+            }
+
+            /**
+             *  Record a handshake
+             *
+             *  @param  completed   Whether the handshake succeeded
+             */
+            void record(bool completed) noexcept
+            {
+                // update the counter, they are only written
+                // from the executor running the connections
+                (completed ? _completed : _failed).fetch_add(1, std::memory_order_relaxed);
+            }
+
+            /**
+             *  Add the counters from other statistics
+             *
+             *  @param  that    The statistics to add
+             *  @return Same object for chaining
+             */
+            handshake_statistics& operator+=(const handshake_statistics& that) noexcept
+            {
+                // add the counters
+                _completed.fetch_add(that.completed(), std::memory_order_relaxed);
+                _failed.fetch_add(that.failed(), std::memory_order_relaxed);
+                return *this;
+            }
+
+            /**
+             *  Retrieve the number of successful handshakes
+             *
+             *  @return The number of handshakes that completed
+             */
+            std::uint64_t completed() const noexcept
+            {
+                return _completed.load(std::memory_order_relaxed);
+            }
+
+            /**
+             *  Retrieve the number of failed handshakes, including
+             *  the handshakes cut short by a timeout
+             *
+             *  @return The number of handshakes that failed
+             */
+            std::uint64_t failed() const noexcept
+            {
+                return _failed.load(std::memory_order_relaxed);
+            }
+        private:
+            std::atomic<std::uint64_t>  _completed  { 0 };  // the number of successful handshakes
+            std::atomic<std::uint64_t>  _failed     { 0 };  // the number of failed handshakes
+    };
+
+}
@@ -0,0 +1,443 @@
+#pragma once
+
+#include <openssl/err.h>
+#include <openssl/ssl.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <type_traits>
+#include <vector>
+#include <boost/asio/buffer.hpp>
+#include <boost/asio/compose.hpp>
+#include <boost/asio/error.hpp>
+#include <boost/asio/post.hpp>
+#include <boost/asio/socket_base.hpp>
+#include <boost/asio/ssl/context.hpp>
+#include <boost/asio/ssl/error.hpp>
+#include <boost/asio/ssl/stream_base.hpp>
+
+
+namespace tamed {
+
+    /**
+     *  Tag to select kernel TLS offload
+     *  for the connections of a listener
+     */
+    struct kernel_tls_t
+    {
+        explicit constexpr kernel_tls_t() = default;
+    };
+
+    /**
+     *  The tag value, to pass to the listen functions
+     */
+    constexpr kernel_tls_t kernel_tls{};
+
+    /**
+     *  A TLS stream that lets OpenSSL work on the socket
+     *  directly, so that the record keys can be handed
+     *  to the kernel once the handshake is done.
+     *
+     *  When the kernel takes over encryption, data can be
+     *  written to the socket with plain system calls, and
+     *  files can be sent without copying them through user
+     *  space. When the kernel or the negotiated cipher does
+     *  not support it, OpenSSL keeps encrypting in user space
+     *  and the stream behaves like any other TLS stream.
+     */
+    template <typename socket_type>
+    class kernel_tls_stream
+    {
+        public:
+            /**
+             *  The types of the underlying socket
+             */
+            using next_layer_type   = socket_type;
+            using executor_type     = typename socket_type::executor_type;
+
+            /**
+             *  Constructor
+             *
+             *  @param  socket      The connected socket to wrap
+             *  @param  context     The TLS context for transport encryption
+             */
+            template <typename connected_type>
+            kernel_tls_stream(connected_type&& socket, boost::asio::ssl::context& context, kernel_tls_t) :
+                _socket{ std::forward<connected_type>(socket) },
+                _ssl{ SSL_new(context.native_handle()) }
+            {
+                // the error code from switching modes, which we ignore,
+                // as it will surface again when performing the handshake
+                boost::system::error_code ec;
+
+                // without a session we fail during the handshake
+                if (_ssl == nullptr) {
+                    return;
+                }
+
+                // openssl works on the socket itself, and must not block
+                _socket.non_blocking(true, ec);
+
+                // allow writes to complete partially, and to be retried
+                // with the data in a different place than before
+                SSL_set_mode(_ssl, SSL_MODE_ENABLE_PARTIAL_WRITE | SSL_MODE_ACCEPT_MOVING_WRITE_BUFFER);
+
+                #ifdef SSL_OP_ENABLE_KTLS
+                    // hand the keys to the kernel when it supports the cipher
+                    SSL_set_options(_ssl, SSL_OP_ENABLE_KTLS);
+                #endif
+
+                // the bio is shared for reading and writing, it does
+                // not own the descriptor, which stays with the socket
+                auto* bio = BIO_new_socket(_socket.native_handle(), BIO_NOCLOSE);
+
+                // attach it to the session, which takes ownership
+                if (bio != nullptr) {
+                    SSL_set_bio(_ssl, bio, bio);
+                }
+            }
+
+            /**
+             *  Copying is not allowed, the session
+             *  is owned by a single stream
+             */
+            kernel_tls_stream(const kernel_tls_stream&) = delete;
+
+            /**
+             *  Destructor
+             */
+            ~kernel_tls_stream()
+            {
+                // release the session and its bio
+                SSL_free(_ssl);
+            }
+
+            /**
+             *  Retrieve the executor
+             *
+             *  @return The executor of the socket
+             */
+            executor_type get_executor() noexcept
+            {
+                return _socket.get_executor();
+            }
+
+            /**
+             *  Retrieve the underlying socket
+             *
+             *  @return The socket the stream works on
+             */
+            next_layer_type& next_layer() noexcept
+            {
+                return _socket;
+            }
+
+            /**
+             *  Retrieve the underlying session
+             *
+             *  @return The openssl session for the connection
+             */
+            SSL* native_handle() noexcept
+            {
+                return _ssl;
+            }
+
+            /**
+             *  Is data written to the socket encrypted by the kernel?
+             *
+             *  @return Whether plain writes on the socket are allowed
+             */
+            bool kernel_send() const noexcept
+            {
+                return _kernel_send;
+            }
+
+            /**
+             *  Perform the handshake asynchronously
+             *
+             *  @param  type    The side of the handshake to perform
+             *  @param  handler The completion handler
+             */
+            template <typename handler_type>
+            decltype(auto) async_handshake(boost::asio::ssl::stream_base::handshake_type type, handler_type&& handler)
+            {
+                // the action for the handshake
+                auto action = [this, type](std::size_t&) {
+                    // choose the side on the first attempt
+                    if (SSL_in_before(_ssl)) {
+                        // accept or connect
+                        if (type == boost::asio::ssl::stream_base::server) {
+                            SSL_set_accept_state(_ssl);
+                        } else {
+                            SSL_set_connect_state(_ssl);
+                        }
+                    }
+
+                    // continue the handshake
+                    auto result = SSL_do_handshake(_ssl);
+
+                    // is the handshake done?
+                    if (result == 1) {
+                        // the keys are in the kernel if the bio uses it for writing
+                        #ifdef BIO_get_ktls_send
+                            _kernel_send = BIO_get_ktls_send(SSL_get_wbio(_ssl));
+                        #endif
+                    }
+
+                    // return the result of the handshake
+                    return result;
+                };
+
+                // run the handshake until it is done
+                return boost::asio::async_compose<handler_type, void(boost::system::error_code)>(
+                    operation<decltype(action), void(boost::system::error_code)>{ *this, std::move(action) },
+                    handler, _socket
+                );
+            }
+
+            /**
+             *  Shut down the session asynchronously
+             *
+             *  @param  handler The completion handler
+             */
+            template <typename handler_type>
+            decltype(auto) async_shutdown(handler_type&& handler)
+            {
+                // the action for the shutdown
+                auto action = [this](std::size_t&) {
+                    // send our closing notification, we do
+                    // not wait for the one from the peer
+                    auto result = SSL_shutdown(_ssl);
+                    return result == 0 ? 1 : result;
+                };
+
+                // run the shutdown until it is done
+                return boost::asio::async_compose<handler_type, void(boost::system::error_code)>(
+                    operation<decltype(action), void(boost::system::error_code)>{ *this, std::move(action) },
+                    handler, _socket
+                );
+            }
+
+            /**
+             *  Read data asynchronously
+             *
+             *  @param  buffers The buffers to read into
+             *  @param  handler The completion handler
+             */
+            template <typename buffers_type, typename handler_type>
+            decltype(auto) async_read_some(const buffers_type& buffers, handler_type&& handler)
+            {
+                // the first buffer to read into
+                boost::asio::mutable_buffer target;
+
+                // find the first buffer with room for data
+                for (auto iter = boost::asio::buffer_sequence_begin(buffers); iter != boost::asio::buffer_sequence_end(buffers); ++iter) {
+                    // is there room in the buffer?
+                    if (boost::asio::mutable_buffer buffer{ *iter }; buffer.size() != 0) {
+                        // read into this buffer
+                        target = buffer;
+                        break;
+                    }
+                }
+
+                // the action for the read
+                auto action = [this, target](std::size_t& transferred) {
+                    // decrypt data into the buffer
+                    return SSL_read_ex(_ssl, target.data(), target.size(), &transferred);
+                };
+
+                // run the read until there is data
+                return boost::asio::async_compose<handler_type, void(boost::system::error_code, std::size_t)>(
+                    operation<decltype(action), void(boost::system::error_code, std::size_t)>{ *this, std::move(action) },
+                    handler, _socket
+                );
+            }
+
+            /**
+             *  Write data asynchronously
+             *
+             *  @param  buffers The buffers to write
+             *  @param  handler The completion handler
+             */
+            template <typename buffers_type, typename handler_type>
+            decltype(auto) async_write_some(const buffers_type& buffers, handler_type&& handler)
+            {
+                // the data to write
+                boost::asio::const_buffer source;
+
+                // small buffers are combined, every write makes
+                // a record, so a record for every buffer would
+                // waste bandwidth and processing time
+                if (std::next(boost::asio::buffer_sequence_begin(buffers)) == boost::asio::buffer_sequence_end(buffers)) {
+                    // a single buffer is written directly
+                    source = *boost::asio::buffer_sequence_begin(buffers);
+                } else {
+                    // the number of bytes to combine
+                    auto size = std::min(boost::asio::buffer_size(buffers), record_size);
+
+                    // copy the data into a single buffer
+                    _combined.resize(size);
+                    boost::asio::buffer_copy(boost::asio::buffer(_combined), buffers);
+                    source = boost::asio::buffer(_combined);
+                }
+
+                // the action for the write
+                auto action = [this, source](std::size_t& transferred) {
+                    // encrypt and write the data
+                    return SSL_write_ex(_ssl, source.data(), source.size(), &transferred);
+                };
+
+                // run the write until data was written
+                return boost::asio::async_compose<handler_type, void(boost::system::error_code, std::size_t)>(
+                    operation<decltype(action), void(boost::system::error_code, std::size_t)>{ *this, std::move(action) },
+                    handler, _socket
+                );
+            }
+        private:
+            /**
+             *  The maximum amount of data in a single record
+             */
+            constexpr const static std::size_t record_size = 16 * 1024;
+
+            /**
+             *  Asynchronous operation that runs an openssl call,
+             *  waiting for the socket whenever the call needs it
+             */
+            template <typename action_type, typename signature_type>
+            class operation
+            {
+                public:
+                    /**
+                     *  Constructor
+                     *
+                     *  @param  stream  The stream to operate on
+                     *  @param  action  The openssl call to make
+                     */
+                    operation(kernel_tls_stream& stream, action_type&& action) :
+                        _stream{ stream },
+                        _action{ std::move(action) }
+                    {}
+
+                    /**
+                     *  Run the operation
+                     *
+                     *  @param  self    The composed operation to continue with
+                     *  @param  ec      The error code from waiting for the socket
+                     */
+                    template <typename self_type>
+                    void operator()(self_type& self, boost::system::error_code ec = {})
+                    {
+                        // did we finish before, and were posted to complete?
+                        if (_finished) {
+                            return complete(self, _ec);
+                        }
+
+                        // did waiting for the socket fail?
+                        if (ec != boost::system::error_code{}) {
+                            return complete(self, ec);
+                        }
+
+                        // without a session nothing can be done
+                        if (_stream._ssl == nullptr) {
+                            return finish(self, boost::asio::error::no_memory);
+                        }
+
+                        // clear errors from earlier calls, so we
+                        // do not report them for this call
+                        ERR_clear_error();
+                        errno = 0;
+
+                        // perform the call
+                        auto result = _action(_transferred);
+
+                        // did the call succeed?
+                        if (result > 0) {
+                            return finish(self, ec);
+                        }
+
+                        // find out what went wrong
+                        switch (SSL_get_error(_stream._ssl, result)) {
+                            case SSL_ERROR_WANT_READ:
+                                // wait for data to come in
+                                _waited = true;
+                                return _stream._socket.async_wait(boost::asio::socket_base::wait_read, std::move(self));
+                            case SSL_ERROR_WANT_WRITE:
+                                // wait for room to send data
+                                _waited = true;
+                                return _stream._socket.async_wait(boost::asio::socket_base::wait_write, std::move(self));
+                            case SSL_ERROR_ZERO_RETURN:
+                                // the peer closed the session
+                                return finish(self, boost::asio::error::eof);
+                            case SSL_ERROR_SYSCALL:
+                                // an error from the socket, or the peer closed
+                                // the connection without closing the session
+                                if (errno != 0 && ERR_peek_error() == 0) {
+                                    return finish(self, { errno, boost::system::system_category() });
+                                }
+                                return finish(self, boost::asio::ssl::error::stream_truncated);
+                            default:
+                                // the peer closing the connection without
+                                // closing the session is reported separately
+                                if (ERR_GET_REASON(ERR_peek_error()) == SSL_R_UNEXPECTED_EOF_WHILE_READING) {
+                                    return finish(self, boost::asio::ssl::error::stream_truncated);
+                                }
+
+                                // an error inside openssl
+                                return finish(self, { static_cast<int>(ERR_get_error()), boost::asio::error::get_ssl_category() });
+                        }
+                    }
+                private:
+                    /**
+                     *  Finish the operation
+                     *
+                     *  @param  self    The composed operation to complete
+                     *  @param  ec      The error code to report
+                     */
+                    template <typename self_type>
+                    void finish(self_type& self, boost::system::error_code ec)
+                    {
+                        // did we wait before? then we are running
+                        // from the executor and may complete
+                        if (_waited) {
+                            return complete(self, ec);
+                        }
+
+                        // we may not invoke the handler from within the
+                        // initiating function, so we go through the executor
+                        _finished   = true;
+                        _ec         = ec;
+                        boost::asio::post(_stream.get_executor(), std::move(self));
+                    }
+
+                    /**
+                     *  Invoke the completion handler
+                     *
+                     *  @param  self    The composed operation to complete
+                     *  @param  ec      The error code to report
+                     */
+                    template <typename self_type>
+                    void complete(self_type& self, boost::system::error_code ec)
+                    {
+                        // does the handler receive the number of bytes?
+                        if constexpr (std::is_same_v<signature_type, void(boost::system::error_code)>) {
+                            self.complete(ec);
+                        } else {
+                            self.complete(ec, _transferred);
+                        }
+                    }
+
+                    kernel_tls_stream&          _stream;                // the stream to operate on
+                    action_type                 _action;                // the openssl call to make
+                    boost::system::error_code   _ec;                    // the error code to report after posting
+                    std::size_t                 _transferred{ 0 };      // the number of bytes transferred
+                    bool                        _waited{ false };       // did we wait for the socket
+                    bool                        _finished{ false };     // did the call finish before posting
+            };
+
+            socket_type         _socket;                // the socket to work on
+            SSL*                _ssl;                   // the openssl session
+            std::vector<char>   _combined;              // storage for combining small buffers
+            bool                _kernel_send{ false };  // is data encrypted by the kernel
+    };
+
+}
@@ -2,9 +2,21 @@
 
 #include <boost/asio/basic_socket_acceptor.hpp>
 #include <boost/asio/basic_stream_socket.hpp>
+#include <boost/asio/dispatch.hpp>
+#include <boost/asio/post.hpp>
+#include <boost/beast/core/bind_handler.hpp>
 #include <router/table.h>
+#include <exception>
 #include <utility>
+#include <vector>
 #include <tuple>
+#include "accept_statistics.h"
+#include "connection_limit.h"
+#include "drain_list.h"
+#include "executor_pool.h"
+#include "logger.h"
+#include "socket_options.h"
+#include "settings.h"
 #include "stream_traits.h"
 #include "connection.h"
 
@@ -15,26 +27,40 @@ namespace tamed {
      *  Class for initiating an asynchronous
      *  listen operation.
      */
-    template <typename body_type, typename protocol_type, typename executor_type, typename router_type, typename... arguments>
+    template <typename request_type, typename protocol_type, typename executor_type, typename router_type, typename logger_type, typename tracer_type, typename... arguments>
     class listen_operation
     {
         public:
-            using request_body_type = body_type;
             using acceptor_type     = boost::asio::basic_socket_acceptor<protocol_type, executor_type>;
             using endpoint_type     = typename acceptor_type::endpoint_type;
             using socket_type       = boost::asio::basic_stream_socket<protocol_type, executor_type>;
-            using stream_type       = typename async_stream_traits<endpoint_type, arguments...>::stream_type;
+            using stream_type       = typename async_stream_traits<endpoint_type, std::decay_t<arguments>...>::stream_type;
+            using pool_type         = executor_pool<executor_type>;
+            using slot_type         = typename pool_type::slot;
 
             /**
              *  Constructor
              *
+             *  When a shard is given, the acceptor and all its connections
+             *  run on the executor of the shard, and the acceptor shares
+             *  its endpoint with the acceptors of the other shards.
+             *  Otherwise the acceptor runs on the first executor from the
+             *  pool, and distributes the connections over all executors.
+             *
              *  @param  router      The routing map to route the requests
-             *  @param  executor    The executor for creating the acceptor and socket
+             *  @param  pool        The executors to run connections on
+             *  @param  shard       The executor slot to stay on, or a nullptr to distribute
+             *  @param  options     The settings to tune accepting connections
+             *  @param  statistics  The statistics to update with accepted batches
              *  @param  parameters  Additional parameters for constructing the stream
              */
-            listen_operation(router_type& router, executor_type executor, arguments&&... parameters) :
+            listen_operation(router_type& router, pool_type& pool, slot_type* shard, const settings& options, accept_statistics& statistics, arguments&&... parameters) :
                 _router{ router },
-                _acceptor{ std::make_shared<acceptor_type>(executor) },
+                _pool{ pool },
+                _shard{ shard },
+                _settings{ options },
+                _statistics{ statistics },
+                _state{ std::make_shared<shared_state>(pool, shard, options) },
                 _parameters{ std::forward<arguments>(parameters)... }
             {}
 
@@ -45,7 +71,7 @@ namespace tamed {
              */
             executor_type get_executor() noexcept
             {
-                return _acceptor.get_executor();
+                return _state->acceptor.get_executor();
             }
 
             /**
@@ -58,23 +84,56 @@ namespace tamed {
             {
                 // handle system errors
                 try {
-                    // open the acceptor, bind to the endpoint and start listening
-                    _acceptor->open(endpoint.protocol());
-                    _acceptor->set_option(boost::asio::socket_base::reuse_address{ true });
-                    _acceptor->bind(endpoint);
-                    _acceptor->listen(boost::asio::socket_base::max_listen_connections);
+                    // open the acceptor and set the socket options
+                    _state->acceptor.open(endpoint.protocol());
+                    _state->acceptor.set_option(boost::asio::socket_base::reuse_address{ true });
+
+                    // are we sharing the endpoint with other acceptors?
+                    if (_shard != nullptr) {
+                        // let the kernel balance connections between the acceptors
+                        _state->acceptor.set_option(reuse_port{ true });
+                    }
+
+                    // bind to the endpoint and start listening
+                    _state->acceptor.bind(endpoint);
+                    _state->acceptor.listen(boost::asio::socket_base::max_listen_connections);
+
+                    // accepting must not block when the backlog is empty
+                    _state->acceptor.non_blocking(true);
                 } catch (const boost::system::system_error &error) {
                     // return the error code from the exception
                     return error.code();
                 }
 
+                // the acceptor is drained on the executor it runs on
+                boost::asio::dispatch(get_executor(), [state = _state, &slot = _shard ? *_shard : _pool[0]]() {
+                    // register the acceptor, and close it
+                    // if the server is draining already
+                    if (slot.get_drain_list().add(*state)) {
+                        state->drain();
+                    }
+                });
+
                 // start listening for connections
-                _acceptor->async_wait(boost::asio::socket_base::wait_read, *this);
+                _state->acceptor.async_wait(boost::asio::socket_base::wait_read, *this);
 
                 // no errors occured
                 return {};
             }
 
+            /**
+             *  Stop listening, the acceptor is closed
+             *  on the executor it runs on
+             */
+            void close() noexcept
+            {
+                // close the acceptor, which cancels the pending wait
+                boost::asio::dispatch(get_executor(), [state = _state]() {
+                    // stop accepting connections
+                    state->drain();
+                });
+            }
+
             /**
              *  Invoke the handler
              *
@@ -85,30 +144,249 @@ namespace tamed {
                 // check if the operation was aborted or resulted in an error
                 if (ec == boost::asio::error::operation_aborted) {
                     // log that the listening is now aborted
-                    std::cerr << "Listen operation aborted" << std::endl;
+                    logger_type::log(log_level::info, "Listen operation aborted");
                 } else if (ec) {
                     // log the error that occured
-                    std::cerr << "Listening failed: " << ec.message() << std::endl;
+                    logger_type::log(log_level::error, "Listening failed: ", ec);
+                } else if (!_state->acceptor.is_open()) {
+                    // the acceptor was closed while accepting was paused
+                    return;
                 } else {
-                    // the connection data type to create
-                    using data_type = connection_data_impl<router_type, body_type, stream_type, executor_type>;
+                    // the number of connections accepted during this wakeup
+                    std::size_t accepted{ 0 };
+
+                    // drain the backlog, up to the configured batch size
+                    while (accepted < _settings.accept_batch) {
+                        // whether there is room for another connection
+                        bool admitted;
+
+                        // waiting for room registers a callback, which allocates
+                        try {
+                            admitted = admit();
+                        } catch (const std::exception&) {
+                            // we cannot be resumed, so try again once
+                            // the acceptor is readable, which is right away
+                            logger_type::log(log_level::error, "Cannot wait for room for new connections");
+                            break;
+                        }
+
+                        // is there room for another connection?
+                        if (!admitted) {
+                            // record the batch size, and leave the remaining
+                            // connections in the backlog until we are resumed
+                            _statistics.record(accepted);
+                            _statistics.record_pause();
+                            return;
+                        }
+
+                        // accept a connection from the backlog
+                        if (!accept()) {
+                            break;
+                        }
 
-                    // create the connection data
-                    auto impl = std::apply(std::make_shared<data_type, router_type&, executor_type, arguments...>, std::tuple_cat(
-                        std::forward_as_tuple(_router, _acceptor->get_executor()),
-                        _parameters
-                    ));
+                        // another connection was accepted
+                        ++accepted;
+                    }
 
-                    // accept the incoming connection
-                    impl->accept(*_acceptor);
+                    // record the batch size for tuning
+                    _statistics.record(accepted);
 
                     // continue listening for new connections
-                    _acceptor->async_wait(boost::asio::socket_base::wait_read, *this);
+                    _state->acceptor.async_wait(boost::asio::socket_base::wait_read, *this);
                 }
             }
         private:
+            /**
+             *  The state shared between all copies
+             *  of the operation
+             */
+            struct shared_state : public drain_list::entry
+            {
+                /**
+                 *  Constructor
+                 *
+                 *  @param  pool        The executors to run connections on
+                 *  @param  shard       The executor slot to stay on, or a nullptr to distribute
+                 *  @param  options     The settings for recycling connections
+                 */
+                shared_state(pool_type& pool, slot_type* shard, const settings& options) :
+                    acceptor{ shard ? shard->get_executor() : pool[0].get_executor() },
+                    limit{ std::make_shared<connection_limit>() }
+                {
+                    // create a connection pool for every executor we run connections on
+                    for (std::size_t index{ 0 }; index < (shard ? 1 : pool.size()); ++index) {
+                        // the slot the connections from the pool run on
+                        auto& slot = shard ? *shard : pool[index];
+
+                        // create the pool with the configured limits
+                        pools.push_back(std::make_shared<connection_pool>(options.pool_size, options.pool_buffer_limit, &slot.get_allocation_statistics()));
+                    }
+                }
+
+                /**
+                 *  Destructor
+                 */
+                ~shared_state()
+                {
+                    // the server must not drain us while we are destroyed
+                    leave();
+                }
+
+                /**
+                 *  Stop accepting connections
+                 */
+                void drain() noexcept override
+                {
+                    // the error code from closing, which we ignore
+                    boost::system::error_code ec;
+
+                    // the pending wait is cancelled by closing
+                    acceptor.close(ec);
+                }
+
+                /**
+                 *  Stop accepting connections
+                 */
+                void abort() noexcept override
+                {
+                    // there is nothing in progress to finish
+                    drain();
+                }
+
+                acceptor_type                                   acceptor;   // acceptor for incoming connections
+                std::vector<std::shared_ptr<connection_pool>>   pools;      // recycled connection storage for every executor
+                std::shared_ptr<connection_limit>               limit;      // the limit on the connections from the acceptor
+            };
+
+            /**
+             *  Take a place for a new connection in the limits
+             *  of the listener and the server
+             *
+             *  When either limit is reached, the listener is resumed
+             *  after one of the connections holding it closes.
+             *
+             *  @return Whether there is room for another connection
+             *  @throws std::bad_alloc  When the callback to resume cannot be registered,
+             *                          no place is taken in either limit then
+             */
+            bool admit()
+            {
+                // the limits to take a place in
+                auto& listener  = *_state->limit;
+                auto& global    = *_pool.get_connection_limit();
+
+                // is there room for another connection on the listener?
+                if (!listener.acquire(_settings.max_listener_connections) && !listener.acquire(_settings.max_listener_connections, resumer())) {
+                    return false;
+                }
+
+                // whether there is room for another connection on the server
+                bool admitted;
+
+                // registering to be resumed may fail
+                try {
+                    admitted = global.acquire(_settings.max_connections) || global.acquire(_settings.max_connections, resumer());
+                } catch (...) {
+                    // give back the place on the listener
+                    listener.release();
+                    throw;
+                }
+
+                // is there room for another connection on the server?
+                if (!admitted) {
+                    // give back the place on the listener
+                    listener.release();
+                    return false;
+                }
+
+                // we have room for the connection
+                return true;
+            }
+
+            /**
+             *  Create the callback to resume accepting
+             *  after a connection has closed
+             *
+             *  @return The callback, which may be invoked from any thread
+             */
+            connection_limit::waiter_type resumer() const
+            {
+                // continue on the executor of the acceptor
+                return [operation = *this]() {
+                    // handle the backlog as if the acceptor became readable
+                    boost::asio::post(operation._state->acceptor.get_executor(), boost::beast::bind_front_handler(operation, boost::system::error_code{}));
+                };
+            }
+
+            /**
+             *  Accept a single incoming connection
+             *
+             *  @return Whether a connection was accepted
+             *  @precondition   The places for the connection were taken by admit()
+             */
+            bool accept() noexcept
+            {
+                // the connection data type to create
+                using data_type = connection_data_impl<router_type, request_type, stream_type, executor_type, logger_type, tracer_type>;
+
+                // the executor slot to run the connection on
+                slot_type& slot = _shard ? *_shard : _pool.next(_settings.dispatch);
+
+                // the error code from the operation and the socket to accept into
+                boost::system::error_code   ec;
+                socket_type                 socket{ slot.get_executor() };
+
+                // the places taken by admit(), which are given
+                // back if we fail to accept a connection
+                connection_permit permit{ _state->limit, _pool.get_connection_limit() };
+
+                // accept the incoming connection
+                _state->acceptor.accept(socket, ec);
+
+                // check whether the socket was accepted successfully
+                if (ec == boost::asio::error::would_block) {
+                    // the backlog is drained
+                    return false;
+                } else if (ec) {
+                    // cannot continue without an open socket
+                    logger_type::log(log_level::error, "Error during socket accept: ", ec);
+                    return false;
+                }
+
+                // the pool to recycle connection storage for the executor
+                auto& pool = _shard ? _state->pools.front() : _state->pools[slot.index()];
+
+                // the connection data to create around the accepted socket
+                std::shared_ptr<data_type> impl;
+
+                // creating the connection allocates its storage
+                try {
+                    // construct the stream with the additional parameters
+                    impl = std::apply([this, &slot, &pool, &permit, &socket](auto&... parameters) {
+                        return std::allocate_shared<data_type>(pool_allocator<data_type>{ pool }, _router, slot, pool, _settings, std::move(permit), std::move(socket), parameters...);
+                    }, _parameters);
+                } catch (const std::exception&) {
+                    // reject this connection, the socket is closed and the places
+                    // are given back, and the batch ends until the next wakeup
+                    logger_type::log(log_level::error, "Cannot create connection for accepted socket");
+                    return false;
+                }
+
+                // start handling the connection on its own executor, this
+                // runs immediately if the acceptor shares the executor
+                boost::asio::dispatch(slot.get_executor(), [impl = std::move(impl)]() {
+                    // start reading or handshaking
+                    impl->start();
+                });
+                return true;
+            }
+
             router_type&                    _router;        // the router map to route requests
-            std::shared_ptr<acceptor_type>  _acceptor;      // acceptor for incoming connections
+            pool_type&                      _pool;          // the executors to run connections on
+            slot_type*                      _shard;         // the executor slot to stay on, if sharded
+            const settings&                 _settings;      // the settings to tune accepting
+            accept_statistics&              _statistics;    // statistics on accepted batches
+            std::shared_ptr<shared_state>   _state;         // state shared by all copies of the operation
             std::tuple<arguments...>        _parameters;    // additional parameters for connections
     };
 
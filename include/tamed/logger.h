@@ -0,0 +1,400 @@
+#pragma once
+
+#include <boost/system/error_code.hpp>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <ctime>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+namespace tamed {
+
+    /**
+     *  The severity of a log message
+     */
+    enum class log_level
+    {
+        debug,      // details for debugging
+        info,       // normal events, like clients disconnecting
+        warning,    // problems caused by a client
+        error       // problems in the server itself
+    };
+
+    /**
+     *  Logger that discards all messages
+     *
+     *  Configure the server with this logger to remove
+     *  logging completely, the calls compile to nothing.
+     *
+     *  Loggers are used through a static log() function,
+     *  custom loggers only have to provide the same function.
+     */
+    struct null_logger
+    {
+        /**
+         *  Log a message
+         *
+         *  @param  level   The severity of the message
+         *  @param  message The message, which must stay valid forever, like a literal
+         *  @param  ec      The error code to add to the message
+         */
+        static void log(log_level, const char*, const boost::system::error_code& = {}) noexcept {}
+    };
+
+    /**
+     *  Logger that writes messages to standard error
+     *  from a background thread
+     *
+     *  Logging a message only stores it in a buffer for the
+     *  calling thread, without formatting. The flusher thread
+     *  sleeps until a message is stored, and then formats the
+     *  messages and writes them in batches. Only the first
+     *  message after a batch takes a lock, to wake the flusher.
+     *  Messages that do not fit in the buffer, or that exceed
+     *  the rate limit, are counted and dropped.
+     *
+     *  @tparam threshold   The lowest level that is logged
+     *  @tparam rate        The maximum number of messages per second, for every thread
+     *  @tparam capacity    The number of messages buffered for every thread, a power of two
+     */
+    template <log_level threshold = log_level::warning, std::size_t rate = 100, std::size_t capacity = 256>
+    class async_logger
+    {
+        public:
+            /**
+             *  Log a message
+             *
+             *  @param  level   The severity of the message
+             *  @param  message The message, which must stay valid forever, like a literal
+             *  @param  ec      The error code to add to the message
+             */
+            static void log(log_level level, const char* message, const boost::system::error_code& ec = {}) noexcept
+            {
+                // is the message severe enough?
+                if (level < threshold) {
+                    return;
+                }
+
+                // the buffer for the current thread, registered
+                // with the flusher the first time it is used
+                thread_local std::shared_ptr<ring> buffer;
+
+                // registering allocates, and may start the flusher
+                if (buffer == nullptr) {
+                    // without a buffer, the message is dropped
+                    try {
+                        buffer = flusher::instance().attach();
+                    } catch (...) {
+                        return;
+                    }
+                }
+
+                // store the message, and wake the flusher to write
+                // it, or to report that it was dropped
+                buffer->push(level, message, ec);
+                flusher::instance().notify();
+            }
+        private:
+            static_assert((capacity & (capacity - 1)) == 0, "The capacity must be a power of two");
+
+            /**
+             *  A message waiting to be written
+             */
+            struct record
+            {
+                std::chrono::system_clock::time_point   time;       // the time the message was logged
+                log_level                               level;      // the severity of the message
+                const char*                             message;    // the message text
+                int                                     value;      // the value of the error code
+                const boost::system::error_category*    category;   // the category of the error code, if any
+            };
+
+            /**
+             *  The messages logged by a single thread, written
+             *  by that thread and read by the flusher
+             */
+            class ring
+            {
+                public:
+                    /**
+                     *  Store a message
+                     *
+                     *  @param  level   The severity of the message
+                     *  @param  message The message text
+                     *  @param  ec      The error code to add to the message
+                     */
+                    void push(log_level level, const char* message, const boost::system::error_code& ec) noexcept
+                    {
+                        // the time of the message, and the second it falls in
+                        auto now    = std::chrono::system_clock::now();
+                        auto second = std::chrono::duration_cast<std::chrono::seconds>(now.time_since_epoch()).count();
+
+                        // are we in a new second?
+                        if (second != _second) {
+                            // then the rate starts over
+                            _second = second;
+                            _count  = 0;
+                        }
+
+                        // the positions to write and read
+                        auto head = _head.load(std::memory_order_relaxed);
+                        auto tail = _tail.load(std::memory_order_acquire);
+
+                        // do we exceed the rate, or is the buffer full?
+                        if (++_count > rate || head - tail == capacity) {
+                            // then the message is dropped
+                            _dropped.fetch_add(1, std::memory_order_relaxed);
+                            return;
+                        }
+
+                        // store the message, and publish it to the flusher
+                        _records[head % capacity] = { now, level, message, ec.value(), ec ? &ec.category() : nullptr };
+                        _head.store(head + 1, std::memory_order_release);
+                    }
+
+                    /**
+                     *  Are there no messages waiting?
+                     *
+                     *  @return Whether all stored messages were taken
+                     */
+                    bool empty() const noexcept
+                    {
+                        return _tail.load(std::memory_order_relaxed) == _head.load(std::memory_order_acquire);
+                    }
+
+                    /**
+                     *  Take the messages that were stored
+                     *
+                     *  @param  output  The string to format the messages into
+                     *  @return The number of messages dropped since the last call
+                     */
+                    std::uint64_t pop(std::string& output)
+                    {
+                        // the positions to read and write
+                        auto tail = _tail.load(std::memory_order_relaxed);
+                        auto head = _head.load(std::memory_order_acquire);
+
+                        // format all the messages
+                        for (; tail != head; ++tail) {
+                            // add the message to the output
+                            format(_records[tail % capacity], output);
+                        }
+
+                        // the messages can be overwritten now
+                        _tail.store(tail, std::memory_order_release);
+
+                        // report the dropped messages
+                        return _dropped.exchange(0, std::memory_order_relaxed);
+                    }
+                private:
+                    std::array<record, capacity>    _records;           // the stored messages
+                    std::atomic<std::size_t>        _head{ 0 };         // the position of the next message to store
+                    std::atomic<std::size_t>        _tail{ 0 };         // the position of the next message to take
+                    std::atomic<std::uint64_t>      _dropped{ 0 };      // the number of messages dropped
+                    std::int64_t                    _second{ 0 };       // the second in which the messages are counted
+                    std::size_t                     _count{ 0 };        // the number of messages in this second
+            };
+
+            /**
+             *  The background thread writing the
+             *  messages from all threads
+             */
+            class flusher
+            {
+                public:
+                    /**
+                     *  Retrieve the flusher, which is started
+                     *  when the first message is logged
+                     *
+                     *  @return The flusher for this logger type
+                     */
+                    static flusher& instance()
+                    {
+                        static flusher result;
+                        return result;
+                    }
+
+                    /**
+                     *  Destructor
+                     */
+                    ~flusher()
+                    {
+                        // tell the thread to stop
+                        {
+                            // lock the state
+                            std::lock_guard lock{ _mutex };
+                            _stopped = true;
+                        }
+
+                        // wake up the thread, and wait for
+                        // it to write the last messages
+                        _condition.notify_one();
+                        _thread.join();
+                    }
+
+                    /**
+                     *  Create a buffer for the calling thread
+                     *
+                     *  @return The buffer to store messages in
+                     */
+                    std::shared_ptr<ring> attach()
+                    {
+                        // create the buffer, it is shared with the flusher,
+                        // so the messages survive the thread exiting
+                        auto result = std::make_shared<ring>();
+
+                        // register the buffer
+                        std::lock_guard lock{ _mutex };
+                        _rings.push_back(result);
+                        return result;
+                    }
+
+                    /**
+                     *  Wake the thread, after a message was logged
+                     */
+                    void notify() noexcept
+                    {
+                        // the message must be stored before we look at the flag,
+                        // or the thread could take the flag and miss the message
+                        std::atomic_thread_fence(std::memory_order_seq_cst);
+
+                        // is the thread already woken for earlier messages? the
+                        // load avoids writing the flag shared by all threads
+                        if (_pending.load(std::memory_order_seq_cst) || _pending.exchange(true, std::memory_order_seq_cst)) {
+                            return;
+                        }
+
+                        // the thread checks for messages while holding the
+                        // lock, so taking it ensures the signal is not lost
+                        std::lock_guard lock{ _mutex };
+                        _condition.notify_one();
+                    }
+                private:
+                    /**
+                     *  Constructor
+                     */
+                    flusher() :
+                        _thread{ [this]() { run(); } }
+                    {}
+
+                    /**
+                     *  Write the messages until stopped
+                     */
+                    void run()
+                    {
+                        // the formatted messages, and the buffers
+                        // to read, kept between batches
+                        std::string                         output;
+                        std::vector<std::shared_ptr<ring>>  buffers;
+
+                        // lock the state
+                        std::unique_lock lock{ _mutex };
+
+                        // keep flushing until we are stopped
+                        while (true) {
+                            // sleep until messages are stored, or we are stopped
+                            _condition.wait(lock, [this]() { return _stopped || _pending.load(std::memory_order_relaxed); });
+
+                            // the flusher is told to stop once the program
+                            // exits, so write all messages one last time
+                            auto stopped = _stopped;
+
+                            // messages stored from now on wake us again, taking
+                            // the flag makes the stored messages visible to us
+                            _pending.exchange(false, std::memory_order_seq_cst);
+
+                            // read the buffers without holding the lock,
+                            // so threads can wake us and register meanwhile
+                            buffers.assign(_rings.begin(), _rings.end());
+                            lock.unlock();
+
+                            // the messages that could not be stored
+                            std::uint64_t dropped{ 0 };
+
+                            // collect the messages from all threads
+                            for (auto& buffer : buffers) {
+                                // format the messages from this thread
+                                dropped += buffer->pop(output);
+                            }
+
+                            // were messages dropped?
+                            if (dropped != 0) {
+                                // let the reader know
+                                output.append("tamed: ").append(std::to_string(dropped)).append(" log messages dropped\n");
+                            }
+
+                            // write the messages
+                            if (!output.empty()) {
+                                std::fwrite(output.data(), 1, output.size(), stderr);
+                                std::fflush(stderr);
+                                output.clear();
+                            }
+
+                            // we no longer share the buffers
+                            buffers.clear();
+                            lock.lock();
+
+                            // remove the buffers of threads that have exited
+                            _rings.erase(std::remove_if(_rings.begin(), _rings.end(), [](const auto& buffer) {
+                                // the flusher holds the last reference, and
+                                // the messages were all written
+                                return buffer.use_count() == 1 && buffer->empty();
+                            }), _rings.end());
+
+                            // was this the final round?
+                            if (stopped) {
+                                return;
+                            }
+                        }
+                    }
+
+                    std::mutex                          _mutex;                 // the lock for the state
+                    std::condition_variable             _condition;             // the signal that messages were stored, or to stop
+                    std::atomic<bool>                   _pending{ false };      // were messages stored since the last round
+                    std::vector<std::shared_ptr<ring>>  _rings;                 // the buffers of all threads
+                    bool                                _stopped{ false };      // should the thread stop
+                    std::thread                         _thread;                // the thread writing the messages
+            };
+
+            /**
+             *  Format a message
+             *
+             *  @param  entry   The message to format
+             *  @param  output  The string to add the message to
+             */
+            static void format(const record& entry, std::string& output)
+            {
+                // the names of the levels
+                constexpr const char* names[] = { "debug", "info", "warning", "error" };
+
+                // the time of the message, in UTC
+                auto        time = std::chrono::system_clock::to_time_t(entry.time);
+                std::tm     parts{};
+                gmtime_r(&time, &parts);
+
+                // format the time and the level
+                char prefix[64];
+                std::strftime(prefix, sizeof prefix, "%Y-%m-%dT%H:%M:%SZ ", &parts);
+                output.append(prefix).append(names[static_cast<std::size_t>(entry.level)]).append(": ").append(entry.message);
+
+                // add the description of the error
+                if (entry.category != nullptr) {
+                    output.append(entry.category->message(entry.value));
+                }
+
+                // finish the line
+                output.push_back('\n');
+            }
+    };
+
+}
@@ -3,6 +3,7 @@
 #include <boost/beast/http/serializer.hpp>
 #include <boost/beast/http/message.hpp>
 
+#include "body_traits.h"
 #include "data_source.h"
 
 
@@ -20,13 +21,47 @@ namespace tamed {
              *  Constructor
              *
              *  @param  message The message we are serializing
+             *  @param  head    Whether to leave out the body
              */
-            message_data_source(boost::beast::http::response<body_type>&& message) :
+            message_data_source(boost::beast::http::response<body_type>&& message, bool head) :
                 _message{ std::move(message) },
-                _serializer{ _message }
+                _serializer{ _message },
+                _head{ head }
             {
-                // prepare the payload for sending
-                _message.prepare_payload();
+                // prepare the payload for sending, so the header has the
+                // length even if the body is left out, unless the handler
+                // skipped the body and set the length for a HEAD request
+                if (!_head || !_message.has_content_length()) {
+                    _message.prepare_payload();
+                }
+
+                // should the body be left out?
+                if (_head) {
+                    // the serializer should stop after the header
+                    _serializer.split(true);
+                    return;
+                }
+
+                // is the body stored in a file?
+                if constexpr (is_file_body_v<body_type>) {
+                    // a chunked body needs framing around the data
+                    if (!_message.chunked() && _message.body().size() != 0) {
+                        // the error code from finding the position
+                        boost::system::error_code ec;
+
+                        // the body starts at the current position of the file
+                        auto& file      = _message.body().file();
+                        auto  offset    = file.pos(ec);
+
+                        // could we find the data in the file?
+                        if (ec == boost::system::error_code{}) {
+                            // the body may be sent from the file directly, so
+                            // the serializer should stop after the header
+                            _region = { file.native_handle(), offset, static_cast<std::size_t>(_message.body().size()) };
+                            _serializer.split(true);
+                        }
+                    }
+                }
             }
 
             /**
@@ -36,39 +71,101 @@ namespace tamed {
              */
             bool is_done() noexcept override
             {
+                // is only the header being sent?
+                if (_head) {
+                    // check whether the header was sent
+                    return _serializer.is_header_done();
+                }
+
+                // is the body being sent from the file?
+                if (_direct) {
+                    // check whether the file data was sent
+                    return _region.size == 0;
+                }
+
                 // check whether the serializer is done
                 return _serializer.is_done();
             }
 
+            /**
+             *  Is the data from the last call to next() all
+             *  that remains?
+             *
+             *  @return Whether the last buffers complete the message
+             */
+            bool is_final_batch() noexcept override
+            {
+                return _final;
+            }
+
             /**
              *  Retrieve bytes to be sent
              *
+             *  @param  buffers The array to add the buffers to be sent to
              *  @param  ec      The error code from getting the data
-             *  @return An array of buffers to be sent
              */
-            buffers_type next(boost::system::error_code& ec) noexcept override
+            void next(buffers_type& buffers, boost::system::error_code& ec) noexcept override
             {
-                // the buffers to fill
-                buffers_type result;
+                // the header can no longer be changed
+                _started = true;
+
+                // a body that is not produced in a single piece,
+                // or that is chunked, needs more calls to next()
+                _final = _head || (is_single_batch_body_v<body_type> && !_message.chunked());
 
                 // visit the serializer to get the data
-                _serializer.next(ec, [&result](boost::system::error_code&, const auto& buffer_sequence) {
+                _serializer.next(ec, [this, &buffers](boost::system::error_code&, const auto& buffer_sequence) {
                     // process all buffers
                     for (const auto& buffer : buffer_sequence) {
-                        // has the result reached capacity? then we cannot
+                        // have the buffers reached capacity? then we cannot
                         // add more buffers. they will have to be retrieved
                         // later after consuming some of the existing data
-                        if (result.size() == result.capacity()) {
+                        if (buffers.size() == buffers.capacity()) {
+                            _final = false;
                             break;
                         }
 
                         // add the buffer to the result
-                        result.emplace_back(buffer.data(), buffer.size());
+                        buffers.emplace_back(buffer.data(), buffer.size());
                     }
                 });
+            }
+
+            /**
+             *  Ask the client to close the connection
+             *  after this response, if the header was
+             *  not serialized yet
+             */
+            void close() noexcept override
+            {
+                // the serializer reads the fields on the first call to next()
+                if (_started) {
+                    return;
+                }
+
+                // changing the fields may allocate, without the header
+                // the connection is still closed after the response
+                try {
+                    _message.keep_alive(false);
+                } catch (...) {}
+            }
 
-                // return the filled buffer list
-                return result;
+            /**
+             *  Retrieve the part of a file to send directly
+             *
+             *  @return The file data that remains, only available
+             *          for file bodies after the header was consumed
+             */
+            file_region next_file() noexcept override
+            {
+                // the header must be sent first
+                if (_region.descriptor < 0 || !_serializer.is_header_done()) {
+                    return {};
+                }
+
+                // from now on the data comes from the file
+                _direct = true;
+                return _region;
             }
 
             /**
@@ -78,6 +175,14 @@ namespace tamed {
              */
             void consume(std::size_t size) noexcept override
             {
+                // was the data sent from the file?
+                if (_direct) {
+                    // move past the data in the file
+                    _region.offset  += size;
+                    _region.size    -= size;
+                    return;
+                }
+
                 // the serializer does not appreciate
                 // being asked to consume 0 bytes
                 if (size != 0) {
@@ -86,8 +191,13 @@ namespace tamed {
                 }
             }
         private:
-            boost::beast::http::response<body_type>             _message;       // the message we are serializing
-            boost::beast::http::serializer<false, body_type>    _serializer;    // the serializer for the message
+            boost::beast::http::response<body_type>             _message;           // the message we are serializing
+            boost::beast::http::serializer<false, body_type>    _serializer;        // the serializer for the message
+            file_region                                         _region;            // the body data inside the file, if any
+            bool                                                _head;              // is the body left out
+            bool                                                _final{ false };    // do the last buffers complete the message
+            bool                                                _started{ false };  // was the serialization started
+            bool                                                _direct{ false };   // is the body sent from the file
     };
 
 }
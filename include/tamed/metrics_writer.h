@@ -0,0 +1,220 @@
+#pragma once
+
+#include <charconv>
+#include <cstdint>
+#include <initializer_list>
+#include <string>
+#include <string_view>
+#include <utility>
+#include "request_statistics.h"
+
+
+namespace tamed {
+
+    /**
+     *  Writes metrics in the Prometheus text format
+     *
+     *  Numbers are formatted in place, and labels are
+     *  escaped while they are appended, so writing the
+     *  metrics only allocates when the output has to
+     *  grow. Reserve the size of the previous output to
+     *  avoid that as well.
+     *
+     *  The output may be any string type, so its storage
+     *  can come from a custom allocator.
+     */
+    template <typename string_type = std::string>
+    class metrics_writer
+    {
+        public:
+            /**
+             *  A label of a sample, with its name and value
+             */
+            using label = std::pair<std::string_view, std::string_view>;
+
+            /**
+             *  Constructor
+             *
+             *  @param  output  The string to append the metrics to
+             */
+            metrics_writer(string_type& output) noexcept :
+                _output{ output }
+            {}
+
+            /**
+             *  Start a family of metrics, all samples for
+             *  the family must follow before the next one
+             *
+             *  @param  name    The name of the metric
+             *  @param  type    The type of the metric, like counter or gauge
+             *  @param  help    The description of the metric
+             */
+            void family(std::string_view name, std::string_view type, std::string_view help)
+            {
+                // describe the metric, and give its type
+                _output.append("# HELP ").append(name).append(" ").append(help).append("\n");
+                _output.append("# TYPE ").append(name).append(" ").append(type).append("\n");
+            }
+
+            /**
+             *  Write a sample
+             *
+             *  @param  name    The name of the sample
+             *  @param  labels  The labels of the sample
+             *  @param  value   The value of the sample
+             */
+            void sample(std::string_view name, std::initializer_list<label> labels, std::uint64_t value)
+            {
+                // the name and the labels, followed by the value
+                _output.append(name);
+                append(labels, {});
+                _output.push_back(' ');
+                append(value);
+                _output.push_back('\n');
+            }
+
+            /**
+             *  Write the samples for a latency histogram
+             *
+             *  The buckets are written for every power of two
+             *  microseconds, in seconds, as Prometheus expects.
+             *
+             *  @param  name        The name of the histogram
+             *  @param  labels      The labels of the samples
+             *  @param  histogram   The histogram to write
+             */
+            void histogram(std::string_view name, std::initializer_list<label> labels, const latency_histogram& histogram)
+            {
+                // the number of requests up to the current bucket
+                std::uint64_t count{ 0 };
+
+                // write the buckets, the last bucket has no upper
+                // limit, so it is only written as the total
+                for (std::size_t index{ 0 }; index + 1 < latency_histogram::bucket_count; ++index) {
+                    // add the requests in this bucket
+                    count += histogram.bucket(index);
+
+                    // only write the buckets at a power of two
+                    if ((index + 1) % latency_histogram::sub_bucket_count != 0) {
+                        continue;
+                    }
+
+                    // the upper limit, in seconds
+                    char limit[32];
+                    auto [end, ec] = std::to_chars(std::begin(limit), std::end(limit), latency_histogram::upper_bound(index).count() / 1e6);
+
+                    // write the cumulative count
+                    _output.append(name).append("_bucket");
+                    append(labels, { "le", std::string_view{ limit, static_cast<std::size_t>(end - limit) } });
+                    _output.push_back(' ');
+                    append(count);
+                    _output.push_back('\n');
+                }
+
+                // add the requests in the last bucket
+                count += histogram.bucket(latency_histogram::bucket_count - 1);
+
+                // write the bucket with all requests
+                _output.append(name).append("_bucket");
+                append(labels, { "le", "+Inf" });
+                _output.push_back(' ');
+                append(count);
+                _output.push_back('\n');
+
+                // write the sum of the latencies, in seconds
+                _output.append(name).append("_sum");
+                append(labels, {});
+                _output.push_back(' ');
+                append(histogram.sum().count() / 1e6);
+                _output.push_back('\n');
+
+                // and the number of requests
+                _output.append(name).append("_count");
+                append(labels, {});
+                _output.push_back(' ');
+                append(count);
+                _output.push_back('\n');
+            }
+        private:
+            /**
+             *  Append the labels of a sample
+             *
+             *  @param  labels  The labels to append
+             *  @param  extra   An additional label, like the bucket of a histogram, if it has a name
+             */
+            void append(std::initializer_list<label> labels, label extra)
+            {
+                // are there any labels at all?
+                if (labels.size() == 0 && extra.first.empty()) {
+                    return;
+                }
+
+                // start the list of labels
+                _output.push_back('{');
+
+                // the separator to write before the next label
+                std::string_view separator{};
+
+                // write all the labels
+                for (const auto& [name, value] : labels) {
+                    // write the label and move on
+                    append(separator, name, value);
+                    separator = ",";
+                }
+
+                // write the additional label
+                if (!extra.first.empty()) {
+                    append(separator, extra.first, extra.second);
+                }
+
+                // finish the list
+                _output.push_back('}');
+            }
+
+            /**
+             *  Append a single label
+             *
+             *  @param  separator   The separator to write before the label
+             *  @param  name        The name of the label
+             *  @param  value       The value to escape
+             */
+            void append(std::string_view separator, std::string_view name, std::string_view value)
+            {
+                // write the name of the label
+                _output.append(separator).append(name).append("=\"");
+
+                // write the value, escaping the special characters
+                for (auto character : value) {
+                    // check whether the character must be escaped
+                    switch (character) {
+                        case '\\':  _output.append("\\\\");         break;
+                        case '"':   _output.append("\\\"");         break;
+                        case '\n':  _output.append("\\n");          break;
+                        default:    _output.push_back(character);   break;
+                    }
+                }
+
+                // finish the value
+                _output.push_back('"');
+            }
+
+            /**
+             *  Append a number
+             *
+             *  @param  value   The value to append
+             */
+            template <typename number_type>
+            void append(number_type value)
+            {
+                // format the number on the stack
+                char buffer[32];
+                auto [end, ec] = std::to_chars(std::begin(buffer), std::end(buffer), value);
+
+                // add the formatted number
+                _output.append(buffer, end);
+            }
+
+            string_type&    _output;    // the string to append the metrics to
+    };
+
+}
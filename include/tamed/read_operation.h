@@ -1,6 +1,7 @@
 #pragma once
 
 #include "connection_data.h"
+#include "recycling_allocator.h"
 
 
 namespace tamed {
@@ -8,14 +9,20 @@ namespace tamed {
     /**
      *  Read an incoming request
      */
-    template <class router_type, class body_type, typename stream_type, typename executor_type>
+    template <class router_type, class request_type, typename stream_type, typename executor_type, typename logger_type, typename tracer_type>
     class read_operation
     {
         public:
             /**
              *  The connection data type
              */
-            using data_type = connection_data_impl<router_type, body_type, stream_type, executor_type>;
+            using data_type = connection_data_impl<router_type, request_type, stream_type, executor_type, logger_type, tracer_type>;
+
+            /**
+             *  The allocator for memory used by the operation, like the
+             *  parser state, which is recycled between requests
+             */
+            using allocator_type = recycling_allocator<void>;
 
             /**
              *  Constructor
@@ -36,21 +43,52 @@ namespace tamed {
                 return _data->get_executor();
             }
 
+            /**
+             *  Retrieve the allocator
+             *
+             *  @return The allocator for memory used by the operation
+             */
+            allocator_type get_allocator() const noexcept
+            {
+                return {};
+            }
+
             /**
              *  Handle the completion of reading the request
              *
-             *  @param  ec      The error code from the operation
+             *  @param  ec          The error code from the operation
+             *  @param  transferred The number of bytes that were read
              */
-            void operator()(const boost::system::error_code& ec, std::size_t) noexcept
+            void operator()(const boost::system::error_code& ec, std::size_t transferred) noexcept
             {
                 // did an error occur?
                 if (ec != boost::system::error_code{}) {
-                    // log the error and abort
-                    std::cerr << "Error occurred during request reading: " << ec.message() << std::endl;
-                    return;
+                    // log the error, responses that are still in
+                    // flight are written, but no more requests are read
+                    logger_type::log(log_level::info, "Error occurred during request reading: ", ec);
+                    _data->reading  = false;
+                    _data->close    = true;
+                    return _data->wait_for_client();
+                }
+
+                // were we waiting for the request to start?
+                if (!_data->parser->got_some()) {
+                    // the data is in the buffer, parse the header
+                    return _data->request_started(transferred);
+                }
+
+                // count the bytes that were parsed for the request
+                _data->received += transferred;
+
+                // did we only read the header so far?
+                if (!_data->parser->is_done()) {
+                    // continue with the body
+                    _data->tracer().reading(&request_timeline::header_parsed);
+                    return _data->read_body();
                 }
 
-                // route the request
+                // the read is no longer pending, route the request
+                _data->reading = false;
                 _data->route_request();
             }
         private:
@@ -0,0 +1,270 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <new>
+
+
+namespace tamed {
+
+    /**
+     *  Per-thread cache of recycled memory blocks,
+     *  grouped in power-of-two size classes
+     */
+    class recycling_cache
+    {
+        public:
+            /**
+             *  The smallest and largest block sizes we recycle,
+             *  larger allocations go straight to operator new
+             */
+            constexpr const static std::size_t minimum_size = 16;
+            constexpr const static std::size_t maximum_size = 8192;
+
+            /**
+             *  Retrieve the cache for the current thread
+             *
+             *  Objects destroyed after the cache while the thread
+             *  exits can no longer use it, and get a nullptr.
+             *
+             *  @return The cache to allocate from, or a nullptr if it was destroyed
+             */
+            static recycling_cache* instance() noexcept
+            {
+                // the cache must not be touched once it is gone
+                if (_destroyed) {
+                    return nullptr;
+                }
+
+                // every thread gets its own cache
+                thread_local recycling_cache cache;
+                return &cache;
+            }
+
+            /**
+             *  Set the maximum number of bytes that every
+             *  thread keeps cached in its free lists
+             *
+             *  @param  limit   The high-water mark for cached bytes
+             */
+            static void set_limit(std::size_t limit) noexcept
+            {
+                _limit.store(limit, std::memory_order_relaxed);
+            }
+
+            /**
+             *  Destructor
+             */
+            ~recycling_cache()
+            {
+                // free all the blocks in every size class
+                for (auto* head : _heads) {
+                    // walk the free list
+                    while (head != nullptr) {
+                        // release the block after moving on
+                        auto* next = head->next;
+                        ::operator delete(head);
+                        head = next;
+                    }
+                }
+
+                // blocks are no longer recycled on this thread
+                _destroyed = true;
+            }
+
+            /**
+             *  Allocate a block of memory
+             *
+             *  @param  size    The number of bytes to allocate
+             *  @return Pointer to the allocated memory
+             *  @throws std::bad_alloc
+             */
+            void* allocate(std::size_t size)
+            {
+                // large blocks are not recycled
+                if (size > maximum_size) {
+                    return ::operator new(size);
+                }
+
+                // find the size class for the block
+                auto index = size_class(size);
+
+                // do we have a recycled block available
+                if (auto* block = _heads[index]; block != nullptr) {
+                    // remove it from the free list
+                    _heads[index] = block->next;
+                    _cached -= minimum_size << index;
+                    return block;
+                }
+
+                // allocate a block for the full size class,
+                // so it can be recycled for any size in it
+                return ::operator new(minimum_size << index);
+            }
+
+            /**
+             *  Deallocate a block of memory
+             *
+             *  @param  pointer The memory to deallocate
+             *  @param  size    The number of bytes that were allocated
+             */
+            void deallocate(void* pointer, std::size_t size) noexcept
+            {
+                // large blocks are not recycled
+                if (size > maximum_size) {
+                    return ::operator delete(pointer);
+                }
+
+                // find the size class for the block
+                auto index  = size_class(size);
+                auto bytes  = minimum_size << index;
+
+                // would the cache grow beyond the limit
+                if (_cached + bytes > _limit.load(std::memory_order_relaxed)) {
+                    return ::operator delete(pointer);
+                }
+
+                // add the block to the free list
+                _heads[index] = new (pointer) node{ _heads[index] };
+                _cached += bytes;
+            }
+        private:
+            /**
+             *  Node in the free list, stored
+             *  inside the recycled block
+             */
+            struct node
+            {
+                node*   next;   // the next free block
+            };
+
+            /**
+             *  The number of size classes
+             */
+            constexpr const static std::size_t class_count = 10;
+
+            /**
+             *  Find the size class for a block
+             *
+             *  @param  size    The number of bytes requested
+             *  @return The index of the size class
+             */
+            static std::size_t size_class(std::size_t size) noexcept
+            {
+                // start with the smallest class
+                std::size_t index{ 0 };
+
+                // find the first class that is large enough
+                while ((minimum_size << index) < size) {
+                    ++index;
+                }
+
+                // return the found class
+                return index;
+            }
+
+            /**
+             *  Constructor
+             */
+            recycling_cache() noexcept = default;
+
+            inline static std::atomic<std::size_t>  _limit  { 1024 * 1024 };    // the maximum number of cached bytes per thread
+            inline static thread_local bool         _destroyed{ false };        // was the cache of this thread destroyed
+            std::array<node*, class_count>          _heads  {};                 // the free list for every size class
+            std::size_t                             _cached { 0 };              // the number of bytes in the free lists
+    };
+
+    /**
+     *  Stateless allocator that recycles memory through
+     *  a cache on the thread doing the allocation.
+     *
+     *  Memory may be deallocated on a different thread,
+     *  it is then recycled by that thread instead. Once
+     *  the cache of an exiting thread is destroyed, the
+     *  memory goes straight to operator new and delete.
+     */
+    template <typename T>
+    class recycling_allocator
+    {
+        public:
+            using value_type = T;
+
+            /**
+             *  Constructor
+             */
+            recycling_allocator() noexcept = default;
+
+            /**
+             *  Constructor
+             *
+             *  @param  that    The allocator to rebind
+             */
+            template <typename U>
+            recycling_allocator(const recycling_allocator<U>&) noexcept
+            {}
+
+            /**
+             *  Allocate memory for objects
+             *
+             *  @param  count   The number of objects to allocate
+             *  @return Pointer to the allocated memory
+             *  @throws std::bad_alloc
+             */
+            T* allocate(std::size_t count)
+            {
+                // the blocks come from operator new, which only guarantees this alignment
+                static_assert(alignof(T) <= __STDCPP_DEFAULT_NEW_ALIGNMENT__);
+
+                // is the cache still there?
+                if (auto* cache = recycling_cache::instance(); cache != nullptr) {
+                    return static_cast<T*>(cache->allocate(sizeof(T) * count));
+                }
+
+                // the thread is exiting, so the memory is not recycled
+                return static_cast<T*>(::operator new(sizeof(T) * count));
+            }
+
+            /**
+             *  Deallocate memory
+             *
+             *  @param  pointer The memory to deallocate
+             *  @param  count   The number of objects that were allocated
+             */
+            void deallocate(T* pointer, std::size_t count) noexcept
+            {
+                // is the cache still there?
+                if (auto* cache = recycling_cache::instance(); cache != nullptr) {
+                    return cache->deallocate(pointer, sizeof(T) * count);
+                }
+
+                // the thread is exiting, the blocks came from operator new
+                // in a size class, so they are released without a size
+                ::operator delete(pointer);
+            }
+
+            /**
+             *  Compare allocators, all instances share the
+             *  same caches so they are always equal
+             *
+             *  @return Whether memory from one can be deallocated by the other
+             */
+            template <typename U>
+            bool operator==(const recycling_allocator<U>&) const noexcept
+            {
+                return true;
+            }
+
+            /**
+             *  Compare allocators
+             *
+             *  @return Whether memory from one cannot be deallocated by the other
+             */
+            template <typename U>
+            bool operator!=(const recycling_allocator<U>&) const noexcept
+            {
+                return false;
+            }
+    };
+
+}
@@ -0,0 +1,585 @@
+#pragma once
+
+#include <boost/beast/http/verb.hpp>
+#include <router/table.h>
+#include <bitset>
+#include <deque>
+#include <map>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include "routing_statistics.h"
+#include "request_statistics.h"
+#include "connection.h"
+#include "enum_map.h"
+
+
+namespace tamed {
+
+    /**
+     *  Routes requests to the handlers registered for
+     *  their method and path.
+     *
+     *  Routing never throws, requests for a path without a
+     *  handler go to the not-found handler. The methods every
+     *  path is registered for are tracked when handlers are
+     *  added, so that requests with another method get a 405
+     *  response, and OPTIONS requests get the allowed methods,
+     *  from responses that were serialized in advance. HEAD
+     *  requests for a path without a HEAD handler are sent
+     *  to the GET handler, the body of the response is then
+     *  left out when it is written.
+     *
+     *  Every handler that is added becomes a numbered route,
+     *  and routing reports the route that handled the request,
+     *  so that statistics can be kept per route.
+     */
+    template <typename request_type, boost::beast::http::verb... verbs>
+    class request_router
+    {
+        public:
+            using routing_table = router::table<void(connection, request_type&&)>;
+            using map_type      = enum_map<boost::beast::http::verb, routing_table, verbs...>;
+
+            /**
+             *  A handler that was added for a method and path
+             */
+            struct route_entry
+            {
+                boost::beast::http::verb    method;     // the method the handler was added for
+                std::string                 path;       // the path the handler was added for
+                std::size_t                 index;      // the number of the route
+                void*                       instance;   // the instance to invoke a member function on
+
+                /**
+                 *  Mark the route as matched, and invoke the handler
+                 *
+                 *  @tparam callback    The handler to invoke
+                 *  @param  connection  The connection the request came in on
+                 *  @param  request     The request to handle
+                 */
+                template <auto callback>
+                void invoke(connection connection, request_type&& request)
+                {
+                    // let the router know which route handles the request
+                    matched() = index;
+                    request_router::invoke<callback>(instance, std::move(connection), std::move(request));
+                }
+            };
+
+            /**
+             *  Constructor
+             */
+            request_router()
+            {
+                // install the fallback in all tables, so that routing
+                // does not throw when no handler matches the path
+                for (std::size_t index{ 0 }; index < _tables.size(); ++index) {
+                    // route to our own not-found handler
+                    _tables[index].template set_not_found<&request_router::unrouted>(this);
+                }
+
+                // paths that were not registered are not matched
+                _path_table.template set_not_found<&request_router::unknown_path>();
+
+                // the server as a whole supports all configured methods
+                method_set all_methods;
+                all_methods.set();
+
+                // serialize the responses for the server as a whole
+                _method_not_allowed = serialize("405 Method Not Allowed", all_methods);
+                _options            = serialize("200 OK", all_methods);
+            }
+
+            /**
+             *  The handlers are registered with a pointer
+             *  to the router, so it cannot be moved
+             */
+            request_router(const request_router&) = delete;
+            request_router(request_router&&) = delete;
+
+            /**
+             *  Add an endpoint to be handled
+             *
+             *  @tparam callback    The callback to route to
+             *  @param  method      The HTTP method to route
+             *  @param  endpoint    The path to add
+             *  @throws std::out_of_range   When the method is not supported
+             */
+            template <auto callback>
+            std::enable_if_t<!std::is_member_function_pointer_v<decltype(callback)>>
+            add(boost::beast::http::verb method, std::string_view endpoint)
+            {
+                // add the endpoint as a route, without an instance
+                add_route<callback>(method, endpoint, nullptr);
+            }
+
+            /**
+             *  Add an endpoint to be handled
+             *
+             *  @tparam callback    The callback to route to
+             *  @param  method      The HTTP method to route
+             *  @param  endpoint    The path to add
+             *  @param  instance    The instance to invoke the callback on
+             *  @throws std::out_of_range   When the method is not supported
+             */
+            template <auto callback>
+            std::enable_if_t<std::is_member_function_pointer_v<decltype(callback)>>
+            add(boost::beast::http::verb method, std::string_view endpoint, typename router::function_traits<decltype(callback)>::member_type* instance)
+            {
+                // add the endpoint as a route, with the instance to invoke on
+                add_route<callback>(method, endpoint, const_cast<void*>(static_cast<const void*>(instance)));
+            }
+
+            /**
+             *  Set the handler for requests to a path
+             *  without a handler for the method
+             *
+             *  @tparam callback    The callback to route to
+             */
+            template <auto callback>
+            std::enable_if_t<!std::is_member_function_pointer_v<decltype(callback)>>
+            set_not_found()
+            {
+                // store the callback, there is no instance
+                _not_found          = &invoke<callback>;
+                _not_found_instance = nullptr;
+            }
+
+            /**
+             *  Set the handler for requests to a path
+             *  without a handler for the method
+             *
+             *  @tparam callback    The callback to route to
+             *  @param  instance    The instance to invoke the callback on
+             */
+            template <auto callback>
+            std::enable_if_t<std::is_member_function_pointer_v<decltype(callback)>>
+            set_not_found(typename router::function_traits<decltype(callback)>::member_type* instance)
+            {
+                // store the callback and the instance to invoke it on
+                _not_found          = &invoke<callback>;
+                _not_found_instance = const_cast<void*>(static_cast<const void*>(instance));
+            }
+
+            /**
+             *  Retrieve the routes that were added
+             *
+             *  @return The routes, in the order of their numbers
+             */
+            const std::deque<route_entry>& get_routes() const noexcept
+            {
+                return _routes;
+            }
+
+            /**
+             *  Retrieve the index of a method, for
+             *  keeping statistics per method
+             *
+             *  @param  method  The method to look up
+             *  @return The index in the configuration, or the number of methods if not configured
+             */
+            static std::size_t method_index(boost::beast::http::verb method) noexcept
+            {
+                return map_type::index(method);
+            }
+
+            /**
+             *  Route a request to its handler
+             *
+             *  @param  connection  The connection the request came in on
+             *  @param  request     The request to route
+             *  @param  route       The number of the route that handled the request, or request_statistics::npos
+             *  @return The outcome of routing the request
+             */
+            route_result route(connection connection, request_type&& request, std::size_t& route) noexcept
+            {
+                // find the table for the method
+                auto* table = _tables.find(request.method());
+
+                // the fallback changes the outcome when it runs,
+                // and the route marks itself when it is matched
+                outcome() = route_result::routed;
+                matched() = request_statistics::npos;
+
+                // is the method supported at all?
+                if (table == nullptr) {
+                    // there is no handler for the request
+                    unrouted(std::move(connection), std::move(request));
+                    route = matched();
+                    return outcome();
+                }
+
+                // extract the target the request goes to
+                std::string_view target{ request.target().data(), request.target().size() };
+
+                // handle the processed request
+                table->route(target, std::move(connection), std::move(request));
+                route = matched();
+                return outcome();
+            }
+        private:
+            /**
+             *  The methods a path is registered for, with
+             *  a bit for every method in the configuration
+             */
+            using method_set = std::bitset<sizeof...(verbs)>;
+
+            /**
+             *  The methods registered for a path, and the
+             *  responses that were serialized from them
+             */
+            struct path_entry
+            {
+                method_set  methods;            // the methods registered for the path
+                std::string method_not_allowed; // the response to other methods
+                std::string options;            // the response to OPTIONS requests
+
+                /**
+                 *  Mark the entry as matching the path
+                 *
+                 *  @param  match   The entry for the routed path
+                 */
+                void matched(path_entry*& match)
+                {
+                    match = this;
+                }
+            };
+
+            /**
+             *  The table to look up the entry for a path
+             */
+            using path_table = router::table<void(path_entry*&)>;
+
+            /**
+             *  Add a route, and allow its method for the path
+             *
+             *  @tparam callback    The callback to route to
+             *  @param  method      The HTTP method to route
+             *  @param  endpoint    The path to add
+             *  @param  instance    The instance to invoke the callback on, if it is a member
+             *  @throws std::out_of_range   When the method is not supported
+             */
+            template <auto callback>
+            void add_route(boost::beast::http::verb method, std::string_view endpoint, void* instance)
+            {
+                // find the table for the method
+                auto& table = _tables.at(method);
+
+                // create the route, entries in a deque do not
+                // move, so the table can point to them
+                _routes.push_back({ method, std::string{ endpoint }, _routes.size(), instance });
+
+                // add the endpoint to the table, through the
+                // route so that it marks itself when matched
+                try {
+                    table.template add<&route_entry::template invoke<callback>>(endpoint, &_routes.back());
+                } catch (...) {
+                    // the endpoint was not added, so neither is the route
+                    _routes.pop_back();
+                    throw;
+                }
+
+                // and allow the method for the path
+                allow(method, endpoint);
+            }
+
+            /**
+             *  Allow a method for a path, and update
+             *  the responses for the path
+             *
+             *  @param  method      The HTTP method to allow
+             *  @param  endpoint    The path to allow the method for
+             */
+            void allow(boost::beast::http::verb method, std::string_view endpoint)
+            {
+                // find the entry for the path, or create a new one
+                auto [iter, inserted] = _paths.try_emplace(std::string{ endpoint });
+                auto& entry = iter->second;
+
+                // is this the first method for the path?
+                if (inserted) {
+                    // entries in a map do not move, so the table can point to them
+                    _path_table.template add<&path_entry::matched>(endpoint, &entry);
+                }
+
+                // add the method, and serialize the responses, so
+                // routing a request never has to build them
+                entry.methods.set(map_type::index(method));
+                entry.method_not_allowed    = serialize("405 Method Not Allowed", entry.methods);
+                entry.options               = serialize("200 OK", entry.methods);
+            }
+
+            /**
+             *  Serialize a response listing the allowed methods
+             *
+             *  OPTIONS is always allowed, since it
+             *  is answered by the router itself.
+             *
+             *  @param  status  The status line of the response
+             *  @param  methods The methods that are allowed
+             *  @return The serialized response
+             */
+            static std::string serialize(std::string_view status, const method_set& methods)
+            {
+                // the response to build
+                std::string result{ "HTTP/1.1 " };
+                result.append(status).append("\r\nAllow: ");
+
+                // add all the allowed methods from the configuration
+                for (auto method : std::array<boost::beast::http::verb, sizeof...(verbs)>{ verbs... }) {
+                    // skip the methods that are not allowed, and
+                    // OPTIONS, which is added at the end
+                    if (!methods.test(map_type::index(method)) || method == boost::beast::http::verb::options) {
+                        continue;
+                    }
+
+                    // the name of the method
+                    auto name = to_string(method);
+
+                    // add the name and a separator
+                    result.append(name.data(), name.size()).append(", ");
+                }
+
+                // HEAD is answered by the GET handlers
+                if (allows(methods, boost::beast::http::verb::get) && !allows(methods, boost::beast::http::verb::head)) {
+                    // so it is allowed as well
+                    result.append("HEAD, ");
+                }
+
+                // finish the response, it has no body
+                return result.append("OPTIONS\r\nContent-Length: 0\r\n\r\n");
+            }
+
+            /**
+             *  Check whether a method is in a set
+             *
+             *  @param  methods The set of methods to check
+             *  @param  method  The method to look for
+             *  @return Whether the method is in the set
+             */
+            static bool allows(const method_set& methods, boost::beast::http::verb method) noexcept
+            {
+                // methods outside the configuration are never in the set
+                auto position = map_type::index(method);
+                return position != map_type::npos && methods.test(position);
+            }
+
+            /**
+             *  Send a response that was serialized in advance
+             *
+             *  The prepared responses are for HTTP/1.1 requests on a
+             *  connection that is kept alive, which is almost every
+             *  request. Other requests get the same response through
+             *  the serializer, with their version and connection header.
+             *
+             *  @param  connection  The connection to send the response on
+             *  @param  request     The request to answer
+             *  @param  prepared    The serialized response
+             */
+            static void send_prepared(connection& connection, const request_type& request, std::string_view prepared)
+            {
+                // can the response be sent as it is?
+                if (request.version() == 11 && request.keep_alive()) {
+                    return connection.send(prepared);
+                }
+
+                // building the response allocates, and routing
+                // must not throw, so we send it as it is instead
+                try {
+                    send_serialized(connection, request, prepared);
+                } catch (...) {
+                    connection.send(prepared);
+                }
+            }
+
+            /**
+             *  Send a response that was serialized in advance
+             *  through the serializer, for the version of the
+             *  request and whether its connection is kept alive
+             *
+             *  @param  connection  The connection to send the response on
+             *  @param  request     The request to answer
+             *  @param  prepared    The serialized response
+             *  @throws std::bad_alloc
+             */
+            static void send_serialized(connection& connection, const request_type& request, std::string_view prepared)
+            {
+                // the end of the status line and of the fields
+                auto status = prepared.find("\r\n");
+                auto fields = prepared.find("\r\n\r\n");
+
+                // the status code follows the version, as in "HTTP/1.1 404"
+                unsigned code{ 0 };
+                for (auto digit : prepared.substr(9, 3)) {
+                    code = code * 10 + static_cast<unsigned>(digit - '0');
+                }
+
+                // the response with the version of the request
+                boost::beast::http::response<boost::beast::http::string_body> response{ boost::beast::http::int_to_status(code), request.version() };
+
+                // copy the fields, the content length is set again when sending
+                for (auto position = status + 2; position < fields + 2; ) {
+                    // the field on this line
+                    auto end    = prepared.find("\r\n", position);
+                    auto line   = prepared.substr(position, end - position);
+                    auto colon  = line.find(": ");
+
+                    // add the field, and move to the next line
+                    response.set(boost::beast::string_view{ line.data(), colon }, boost::beast::string_view{ line.data() + colon + 2, line.size() - colon - 2 });
+                    position = end + 2;
+                }
+
+                // add the body, and tell the client whether we close
+                response.body().assign(prepared.substr(fields + 4));
+                response.keep_alive(request.keep_alive());
+                connection.send(std::move(response));
+            }
+
+            /**
+             *  Handle a lookup for a path that was not registered
+             *
+             *  @param  match   The entry for the routed path, which is left empty
+             */
+            static void unknown_path(path_entry*&) {}
+
+            /**
+             *  The type of the stored not-found handler
+             */
+            using handler_type = void(*)(void*, connection, request_type&&);
+
+            /**
+             *  Invoke a callback
+             *
+             *  @tparam callback    The callback to invoke
+             *  @param  instance    The instance to invoke a member function on
+             *  @param  connection  The connection the request came in on
+             *  @param  request     The request to handle
+             */
+            template <auto callback>
+            static void invoke(void* instance, connection connection, request_type&& request)
+            {
+                // is the callback a member function?
+                if constexpr (std::is_member_function_pointer_v<decltype(callback)>) {
+                    // the class the callback is a member of
+                    using member_type = typename router::function_traits<decltype(callback)>::member_type;
+
+                    // invoke the callback on the instance
+                    (static_cast<member_type*>(instance)->*callback)(std::move(connection), std::move(request));
+                } else {
+                    // invoke the free function
+                    callback(std::move(connection), std::move(request));
+                }
+            }
+
+            /**
+             *  The outcome of the request being routed
+             *  on this thread, the not-found handler
+             *  marks the request when it runs
+             *
+             *  @return The outcome of the current request
+             */
+            static route_result& outcome() noexcept
+            {
+                static thread_local route_result result{ route_result::routed };
+                return result;
+            }
+
+            /**
+             *  The route that handled the request being
+             *  routed on this thread, the route marks
+             *  itself when it is matched
+             *
+             *  @return The number of the route for the current request
+             */
+            static std::size_t& matched() noexcept
+            {
+                static thread_local std::size_t result{ request_statistics::npos };
+                return result;
+            }
+
+            /**
+             *  Handle a request without a handler for
+             *  the combination of its method and path
+             *
+             *  @param  connection  The connection the request came in on
+             *  @param  request     The request to handle
+             */
+            void unrouted(connection connection, request_type&& request)
+            {
+                // the method of the request and the target it goes to
+                auto                method{ request.method() };
+                std::string_view    target{ request.target().data(), request.target().size() };
+
+                // is the client asking about the server as a whole?
+                if (method == boost::beast::http::verb::options && target == "*") {
+                    // send the methods supported by the server
+                    outcome() = route_result::options;
+                    return send_prepared(connection, request, _options);
+                }
+
+                // look up the methods registered for the path
+                path_entry* entry{ nullptr };
+                _path_table.route(target, entry);
+
+                // was the path registered for other methods?
+                if (entry != nullptr) {
+                    // is there a GET handler to answer a HEAD request?
+                    if (method == boost::beast::http::verb::head && allows(entry->methods, boost::beast::http::verb::get)) {
+                        // the connection leaves out the body of the response
+                        return _tables.find(boost::beast::http::verb::get)->route(target, std::move(connection), std::move(request));
+                    }
+
+                    // is the client asking which methods it may use?
+                    if (method == boost::beast::http::verb::options) {
+                        // send the methods allowed for the path
+                        outcome() = route_result::options;
+                        return send_prepared(connection, request, entry->options);
+                    }
+
+                    // the method is not allowed for this path
+                    outcome() = route_result::method_not_allowed;
+                    return send_prepared(connection, request, entry->method_not_allowed);
+                }
+
+                // is the method not supported anywhere? HEAD
+                // is supported when there are GET handlers
+                if (_tables.find(method) == nullptr && (method != boost::beast::http::verb::head || _tables.find(boost::beast::http::verb::get) == nullptr)) {
+                    // send the methods supported by the server
+                    outcome() = route_result::method_not_allowed;
+                    return send_prepared(connection, request, _method_not_allowed);
+                }
+
+                // the request was not routed to a handler
+                outcome() = route_result::not_found;
+
+                // did the user install a handler?
+                if (_not_found != nullptr) {
+                    // let the handler deal with it
+                    return _not_found(_not_found_instance, std::move(connection), std::move(request));
+                }
+
+                // send the prepared response
+                send_prepared(connection, request, not_found_response);
+            }
+
+            /**
+             *  The response to send when no handler was found
+             */
+            constexpr const static std::string_view not_found_response =
+                "HTTP/1.1 404 Not Found\r\n"
+                "Content-Length: 51\r\n"
+                "\r\n"
+                "The requested resource was not found on this server";
+
+            map_type                                            _tables;                            // the tables to route requests, by method
+            std::deque<route_entry>                             _routes;                            // the handlers that were added, by number
+            std::map<std::string, path_entry, std::less<>>      _paths;                             // the methods registered for every path
+            path_table                                          _path_table;                        // the table to find the entry for a path
+            handler_type                                        _not_found{ nullptr };              // the handler for requests without a handler
+            void*                                               _not_found_instance{ nullptr };     // the instance to invoke the handler on
+            std::string                                         _method_not_allowed;                // the response to unsupported methods
+            std::string                                         _options;                           // the response to OPTIONS for the whole server
+    };
+
+}
@@ -0,0 +1,662 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+#include <limits>
+#include <new>
+
+
+namespace tamed {
+
+    /**
+     *  Add to a counter that has a single writer
+     *
+     *  Readers may load the counter at any time, but only
+     *  one thread writes it, so the value can be updated
+     *  without the locked instruction of fetch_add().
+     *
+     *  @param  counter The counter to add to
+     *  @param  value   The value to add
+     */
+    inline void add_single_writer(std::atomic<std::uint64_t>& counter, std::uint64_t value) noexcept
+    {
+        counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+    }
+
+    /**
+     *  A histogram of request latencies
+     *
+     *  The buckets are spaced logarithmically, like an HDR
+     *  histogram: every power of two is split in eight equal
+     *  buckets, so a value is known within 12.5 percent, from
+     *  a microsecond up to hours, in a fixed amount of memory.
+     */
+    class latency_histogram
+    {
+        public:
+            /**
+             *  The number of linear buckets within every power of two
+             */
+            constexpr const static std::size_t sub_bucket_bits     = 3;
+            constexpr const static std::size_t sub_bucket_count    = std::size_t{ 1 } << sub_bucket_bits;
+
+            /**
+             *  The highest power of two that is tracked, longer
+             *  latencies are counted in the last bucket
+             */
+            constexpr const static std::size_t max_magnitude = 35;
+
+            /**
+             *  The number of buckets in the histogram
+             */
+            constexpr const static std::size_t bucket_count = (max_magnitude - sub_bucket_bits + 2) * sub_bucket_count;
+
+            /**
+             *  Constructor
+             */
+            latency_histogram() noexcept = default;
+
+            /**
+             *  Copy constructor
+             *
+             *  @param  that    The histogram to copy
+             */
+            latency_histogram(const latency_histogram& that) noexcept
+            {
+                // add all the buckets
+                *this += that;
+            }
+
+            /**
+             *  Record the latency of a request
+             *
+             *  @param  latency The time it took to handle the request
+             */
+            void record(std::chrono::nanoseconds latency) noexcept
+            {
+                // the latency in whole microseconds
+                auto value = static_cast<std::uint64_t>(std::max<std::chrono::nanoseconds::rep>(latency.count(), 0) / 1000);
+
+                // update the bucket and the sum, they are only
+                // written from the executor running the connections
+                add_single_writer(_buckets[index(value)], 1);
+                add_single_writer(_sum, value);
+            }
+
+            /**
+             *  Forget all recorded latencies
+             */
+            void clear() noexcept
+            {
+                // empty all the buckets
+                for (auto& bucket : _buckets) {
+                    // reset the requests in this bucket
+                    bucket.store(0, std::memory_order_relaxed);
+                }
+
+                // and the total latency
+                _sum.store(0, std::memory_order_relaxed);
+            }
+
+            /**
+             *  Add the buckets from another histogram
+             *
+             *  @param  that    The histogram to add
+             *  @return Same object for chaining
+             */
+            latency_histogram& operator+=(const latency_histogram& that) noexcept
+            {
+                // add all the buckets
+                for (std::size_t index{ 0 }; index < bucket_count; ++index) {
+                    // add the requests in this bucket
+                    _buckets[index].fetch_add(that.bucket(index), std::memory_order_relaxed);
+                }
+
+                // and the total latency
+                _sum.fetch_add(that._sum.load(std::memory_order_relaxed), std::memory_order_relaxed);
+                return *this;
+            }
+
+            /**
+             *  Retrieve the number of requests in a bucket
+             *
+             *  @param  index   The index of the bucket
+             *  @return The number of requests with a latency in the bucket
+             */
+            std::uint64_t bucket(std::size_t index) const noexcept
+            {
+                return _buckets[index].load(std::memory_order_relaxed);
+            }
+
+            /**
+             *  Retrieve the upper limit of a bucket
+             *
+             *  @param  index   The index of the bucket
+             *  @return The lowest latency that no longer falls in the bucket
+             */
+            static std::chrono::microseconds upper_bound(std::size_t index) noexcept
+            {
+                // the upper limit is where the next bucket starts
+                return std::chrono::microseconds{ lower_bound(index + 1) };
+            }
+
+            /**
+             *  Retrieve the number of recorded requests
+             *
+             *  @return The number of requests in all the buckets
+             */
+            std::uint64_t count() const noexcept
+            {
+                // the number of requests so far
+                std::uint64_t result{ 0 };
+
+                // add up all the buckets
+                for (std::size_t index{ 0 }; index < bucket_count; ++index) {
+                    // add the requests in this bucket
+                    result += bucket(index);
+                }
+
+                return result;
+            }
+
+            /**
+             *  Retrieve the total latency of all requests
+             *
+             *  @return The sum of the recorded latencies
+             */
+            std::chrono::microseconds sum() const noexcept
+            {
+                return std::chrono::microseconds{ _sum.load(std::memory_order_relaxed) };
+            }
+
+            /**
+             *  Retrieve a percentile of the latency
+             *
+             *  @param  fraction    The fraction of requests, e.g. 0.99 for the 99th percentile
+             *  @return The upper limit of the bucket containing the percentile
+             */
+            std::chrono::microseconds percentile(double fraction) const noexcept
+            {
+                // the number of requests that must be at or below the result
+                auto target = static_cast<std::uint64_t>(fraction * static_cast<double>(count()) + 0.5);
+
+                // the number of requests in the buckets so far
+                std::uint64_t seen{ 0 };
+
+                // find the bucket where we reach the target
+                for (std::size_t index{ 0 }; index < bucket_count; ++index) {
+                    // add the requests in this bucket
+                    seen += bucket(index);
+
+                    // did we reach the target?
+                    if (seen >= target && seen != 0) {
+                        return upper_bound(index);
+                    }
+                }
+
+                // there are no requests
+                return std::chrono::microseconds{ 0 };
+            }
+        private:
+            /**
+             *  Find the bucket for a value
+             *
+             *  @param  value   The latency in microseconds
+             *  @return The index of the bucket to count it in
+             */
+            static std::size_t index(std::uint64_t value) noexcept
+            {
+                // small values have a bucket of their own
+                if (value < sub_bucket_count) {
+                    return static_cast<std::size_t>(value);
+                }
+
+                // the power of two the value falls in, and the
+                // linear bucket within that power of two
+                auto magnitude  = static_cast<std::size_t>(63 - __builtin_clzll(value));
+                auto sub_bucket = static_cast<std::size_t>(value >> (magnitude - sub_bucket_bits)) & (sub_bucket_count - 1);
+
+                // values that are too large go into the last bucket
+                if (magnitude > max_magnitude) {
+                    return bucket_count - 1;
+                }
+
+                // combine them into the index
+                return (magnitude - sub_bucket_bits + 1) * sub_bucket_count + sub_bucket;
+            }
+
+            /**
+             *  Find the lowest value in a bucket
+             *
+             *  @param  index   The index of the bucket
+             *  @return The lowest latency in microseconds counted in the bucket
+             */
+            static std::uint64_t lower_bound(std::size_t index) noexcept
+            {
+                // small values have a bucket of their own
+                if (index < sub_bucket_count) {
+                    return index;
+                }
+
+                // split the index in the power of two and the linear bucket
+                auto magnitude  = index / sub_bucket_count + sub_bucket_bits - 1;
+                auto sub_bucket = index % sub_bucket_count;
+
+                // the start of the linear bucket within the power of two
+                return (std::uint64_t{ sub_bucket_count } + sub_bucket) << (magnitude - sub_bucket_bits);
+            }
+
+            std::array<std::atomic<std::uint64_t>, bucket_count>    _buckets{};     // the number of requests in every bucket
+            std::atomic<std::uint64_t>                              _sum{ 0 };      // the total latency, in microseconds
+    };
+
+    /**
+     *  The counters for a group of requests,
+     *  like the requests for a single route
+     */
+    class request_metrics
+    {
+        public:
+            /**
+             *  Constructor
+             */
+            request_metrics() noexcept = default;
+
+            /**
+             *  Copy constructor
+             *
+             *  @param  that    The metrics to copy
+             */
+            request_metrics(const request_metrics& that) noexcept
+            {
+                // add all the counters
+                *this += that;
+            }
+
+            /**
+             *  Record a request that was answered
+             *
+             *  @param  status      The status code of the response
+             *  @param  received    The number of bytes in the request
+             *  @param  sent        The number of bytes in the response
+             *  @param  latency     The time from receiving the request until the response was written
+             */
+            void record(unsigned status, std::size_t received, std::size_t sent, std::chrono::nanoseconds latency) noexcept
+            {
+                // update the counters, they are only written
+                // from the executor running the connections
+                add_single_writer(_requests, 1);
+                add_single_writer(_received, received);
+                add_single_writer(_sent, sent);
+                _latency.record(latency);
+
+                // count the class of the status, if it is valid
+                if (status >= 100 && status < 600) {
+                    add_single_writer(_statuses[status / 100 - 1], 1);
+                }
+            }
+
+            /**
+             *  Forget all recorded requests
+             */
+            void clear() noexcept
+            {
+                // reset the counters
+                _requests.store(0, std::memory_order_relaxed);
+                _received.store(0, std::memory_order_relaxed);
+                _sent.store(0, std::memory_order_relaxed);
+                _latency.clear();
+
+                // and the responses for every class of status
+                for (auto& responses : _statuses) {
+                    // reset the responses in this class
+                    responses.store(0, std::memory_order_relaxed);
+                }
+            }
+
+            /**
+             *  Add the counters from other metrics
+             *
+             *  @param  that    The metrics to add
+             *  @return Same object for chaining
+             */
+            request_metrics& operator+=(const request_metrics& that) noexcept
+            {
+                // add the counters
+                _requests.fetch_add(that.requests(), std::memory_order_relaxed);
+                _received.fetch_add(that.bytes_received(), std::memory_order_relaxed);
+                _sent.fetch_add(that.bytes_sent(), std::memory_order_relaxed);
+                _latency += that._latency;
+
+                // and the responses for every class of status
+                for (std::size_t index{ 0 }; index < _statuses.size(); ++index) {
+                    // add the responses in this class
+                    _statuses[index].fetch_add(that._statuses[index].load(std::memory_order_relaxed), std::memory_order_relaxed);
+                }
+
+                // allow chaining
+                return *this;
+            }
+
+            /**
+             *  Retrieve the number of requests
+             *
+             *  @return The number of requests that were answered
+             */
+            std::uint64_t requests() const noexcept
+            {
+                return _requests.load(std::memory_order_relaxed);
+            }
+
+            /**
+             *  Retrieve the number of responses in a class of status codes
+             *
+             *  @param  status_class    The class to retrieve, from 1 for 1xx to 5 for 5xx
+             *  @return The number of responses with a status in the class
+             */
+            std::uint64_t responses(std::size_t status_class) const noexcept
+            {
+                // is the class valid at all?
+                if (status_class < 1 || status_class > _statuses.size()) {
+                    return 0;
+                }
+
+                return _statuses[status_class - 1].load(std::memory_order_relaxed);
+            }
+
+            /**
+             *  Retrieve the number of bytes received
+             *
+             *  @return The size of the requests, including the headers
+             */
+            std::uint64_t bytes_received() const noexcept
+            {
+                return _received.load(std::memory_order_relaxed);
+            }
+
+            /**
+             *  Retrieve the number of bytes sent
+             *
+             *  @return The size of the responses, including the headers
+             */
+            std::uint64_t bytes_sent() const noexcept
+            {
+                return _sent.load(std::memory_order_relaxed);
+            }
+
+            /**
+             *  Retrieve the latency histogram
+             *
+             *  @return The time from receiving the first byte of the
+             *          requests until their responses were written
+             */
+            const latency_histogram& get_latency() const noexcept
+            {
+                return _latency;
+            }
+        private:
+            std::atomic<std::uint64_t>                  _requests{ 0 };     // the number of requests answered
+            std::array<std::atomic<std::uint64_t>, 5>   _statuses{};        // the number of responses for every class of status
+            std::atomic<std::uint64_t>                  _received{ 0 };     // the number of bytes received
+            std::atomic<std::uint64_t>                  _sent{ 0 };         // the number of bytes sent
+            latency_histogram                           _latency;           // the latency of the requests
+    };
+
+    /**
+     *  Statistics on the requests answered on the
+     *  connections of an executor, for every route
+     *  and for every method
+     *
+     *  Every executor keeps its own statistics, so recording
+     *  a request never touches memory shared with the other
+     *  executors. The statistics are combined when they are
+     *  retrieved from the server. Only the thread running the
+     *  executor records requests, the counters are updated
+     *  without locked instructions.
+     *
+     *  Requests for routes beyond the limit of the table are
+     *  counted together, so they are not silently lost.
+     */
+    class request_statistics
+    {
+        public:
+            /**
+             *  The route for requests that were not routed to a handler
+             */
+            constexpr const static std::size_t npos = std::numeric_limits<std::size_t>::max();
+
+            /**
+             *  Constructor
+             */
+            request_statistics() noexcept = default;
+
+            /**
+             *  Copy constructor
+             *
+             *  @param  that    The statistics to copy
+             */
+            request_statistics(const request_statistics& that)
+            {
+                // add all the counters
+                *this += that;
+            }
+
+            /**
+             *  Record a request that was answered
+             *
+             *  @param  method      The index of the request method in the configuration
+             *  @param  route       The index of the route that handled the request, or npos
+             *  @param  status      The status code of the response
+             *  @param  received    The number of bytes in the request
+             *  @param  sent        The number of bytes in the response
+             *  @param  latency     The time from receiving the request until the response was written
+             */
+            void record(std::size_t method, std::size_t route, unsigned status, std::size_t received, std::size_t sent, std::chrono::nanoseconds latency) noexcept
+            {
+                // count the request for its method
+                if (auto* metrics = _methods.create(method); metrics != nullptr) {
+                    metrics->record(status, received, sent, latency);
+                }
+
+                // and for its route, or for the unrouted requests
+                if (auto* metrics = route == npos ? &_unrouted : _routes.create(route); metrics != nullptr) {
+                    metrics->record(status, received, sent, latency);
+                } else {
+                    // the route cannot be tracked on its own
+                    _overflow.record(status, received, sent, latency);
+                }
+            }
+
+            /**
+             *  Add the counters from other statistics
+             *
+             *  @param  that    The statistics to add
+             *  @return Same object for chaining
+             */
+            request_statistics& operator+=(const request_statistics& that)
+            {
+                // add the counters for every method and route
+                _methods    += that._methods;
+                _routes     += that._routes;
+                _unrouted   += that._unrouted;
+                _overflow   += that._overflow;
+                return *this;
+            }
+
+            /**
+             *  Retrieve the metrics for a method
+             *
+             *  @param  method  The index of the method in the configuration
+             *  @return The metrics, or a nullptr if no requests were recorded
+             */
+            const request_metrics* get_method(std::size_t method) const noexcept
+            {
+                return _methods.find(method);
+            }
+
+            /**
+             *  Retrieve the metrics for a route
+             *
+             *  @param  route   The index of the route, or npos for requests that were not routed
+             *  @return The metrics, or a nullptr if no requests were recorded
+             */
+            const request_metrics* get_route(std::size_t route) const noexcept
+            {
+                // the requests that were not routed are always there
+                if (route == npos) {
+                    return &_unrouted;
+                }
+
+                return _routes.find(route);
+            }
+
+            /**
+             *  Retrieve the metrics for routes that are not tracked
+             *
+             *  @return The metrics for requests with a route beyond the
+             *          limit of the table, or without room to record it
+             */
+            const request_metrics& get_overflow() const noexcept
+            {
+                return _overflow;
+            }
+        private:
+            /**
+             *  Metrics by index, allocated in chunks the first time
+             *  a request is recorded, so that routes can be added
+             *  while the statistics are read
+             */
+            class table
+            {
+                public:
+                    /**
+                     *  The maximum number of entries, requests for routes
+                     *  beyond this limit are counted as overflow instead
+                     */
+                    constexpr const static std::size_t chunk_size   = 16;
+                    constexpr const static std::size_t chunk_count  = 64;
+
+                    /**
+                     *  Constructor
+                     */
+                    table() noexcept = default;
+
+                    /**
+                     *  Tables are combined instead of copied
+                     */
+                    table(const table&) = delete;
+
+                    /**
+                     *  Destructor
+                     */
+                    ~table()
+                    {
+                        // free all the chunks
+                        for (auto& chunk : _chunks) {
+                            // free the chunk, if it was allocated
+                            delete chunk.load(std::memory_order_relaxed);
+                        }
+                    }
+
+                    /**
+                     *  Find the metrics for an index
+                     *
+                     *  @param  index   The index to look up
+                     *  @return The metrics, or a nullptr if no requests were recorded
+                     */
+                    const request_metrics* find(std::size_t index) const noexcept
+                    {
+                        // is the index beyond what we can hold?
+                        if (index / chunk_size >= chunk_count) {
+                            return nullptr;
+                        }
+
+                        // the chunk holding the metrics
+                        auto* chunk = _chunks[index / chunk_size].load(std::memory_order_acquire);
+
+                        // return the metrics, if the chunk was allocated
+                        return chunk == nullptr ? nullptr : &(*chunk)[index % chunk_size];
+                    }
+
+                    /**
+                     *  Find the metrics for an index, allocating
+                     *  them if no requests were recorded yet
+                     *
+                     *  @param  index   The index to look up
+                     *  @return The metrics, or a nullptr if the index is beyond the limit
+                     */
+                    request_metrics* create(std::size_t index) noexcept
+                    {
+                        // is the index beyond what we can hold?
+                        if (index / chunk_size >= chunk_count) {
+                            return nullptr;
+                        }
+
+                        // the chunk holding the metrics
+                        auto& pointer   = _chunks[index / chunk_size];
+                        auto* chunk     = pointer.load(std::memory_order_acquire);
+
+                        // is the chunk not there yet?
+                        if (chunk == nullptr) {
+                            // allocate the chunk, the statistics may be read
+                            // while we do this, so it is published atomically
+                            chunk = new (std::nothrow) chunk_type{};
+                            if (chunk == nullptr) {
+                                return nullptr;
+                            }
+
+                            // publish the chunk
+                            pointer.store(chunk, std::memory_order_release);
+                        }
+
+                        // return the metrics in the chunk
+                        return &(*chunk)[index % chunk_size];
+                    }
+
+                    /**
+                     *  Add the metrics from another table
+                     *
+                     *  @param  that    The table to add
+                     *  @return Same object for chaining
+                     */
+                    table& operator+=(const table& that) noexcept
+                    {
+                        // add all the chunks that were allocated
+                        for (std::size_t index{ 0 }; index < chunk_count; ++index) {
+                            // the chunk to add
+                            auto* chunk = that._chunks[index].load(std::memory_order_acquire);
+
+                            // skip chunks without any requests
+                            if (chunk == nullptr) {
+                                continue;
+                            }
+
+                            // add the metrics one by one
+                            for (std::size_t offset{ 0 }; offset < chunk_size; ++offset) {
+                                // add to our own metrics, creating them if needed
+                                if (auto* metrics = create(index * chunk_size + offset); metrics != nullptr) {
+                                    *metrics += (*chunk)[offset];
+                                }
+                            }
+                        }
+
+                        // allow chaining
+                        return *this;
+                    }
+                private:
+                    using chunk_type = std::array<request_metrics, chunk_size>;
+
+                    std::array<std::atomic<chunk_type*>, chunk_count>   _chunks{};  // the chunks of metrics
+            };
+
+            table           _methods;   // the metrics for every method
+            table           _routes;    // the metrics for every route
+            request_metrics _unrouted;  // the metrics for requests without a handler
+            request_metrics _overflow;  // the metrics for requests with a route that is not tracked
+    };
+
+}
@@ -0,0 +1,273 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <ostream>
+#include <type_traits>
+#include <vector>
+#include <boost/beast/http/verb.hpp>
+#include "recycling_allocator.h"
+
+
+namespace tamed {
+
+    /**
+     *  The moments at which a request passed the stages
+     *  of being read, handled and answered
+     *
+     *  All times come from the monotonic clock. Stages that
+     *  do not apply, like the handshake on a connection
+     *  without TLS, are left at the epoch of the clock.
+     */
+    struct request_timeline
+    {
+        using clock_type = std::chrono::steady_clock;
+        using time_point = clock_type::time_point;
+
+        time_point                  accepted;           // the connection was accepted
+        time_point                  handshake;          // the TLS handshake of the connection completed
+        time_point                  first_byte;         // the first byte of the request was read
+        time_point                  header_parsed;      // the header of the request was parsed
+        time_point                  body_complete;      // the body of the request was read
+        time_point                  handler_entered;    // the request was handed to its handler
+        time_point                  handler_returned;   // the handler returned
+        time_point                  response_ready;     // the response was handed to the connection, before the handler returned if it answered right away
+        time_point                  first_write;        // the first write with data of the response started
+        time_point                  last_write;         // the write that finished the response completed
+        boost::beast::http::verb    method;             // the method of the request
+        std::size_t                 route;              // the number of the route that handled the request
+        unsigned                    status;             // the status code of the response
+    };
+
+    /**
+     *  Tracer that does not trace, which removes
+     *  the timestamps from the connections
+     *
+     *  Tracers are used through a static on_request()
+     *  function, custom tracers only have to provide the
+     *  same function, which is invoked on the executor of
+     *  the connection for every request that was answered.
+     *
+     *  Tracers may also provide a static on_stage(), which
+     *  receives the member of request_timeline for every
+     *  stage at the moment it is reached, for attributing
+     *  work done by the connection to the stages.
+     */
+    struct null_tracer
+    {
+        /**
+         *  Handle the timeline of an answered request
+         *
+         *  @param  timeline    The stages of the request
+         */
+        static void on_request(const request_timeline&) noexcept {}
+    };
+
+    /**
+     *  Fallback struct for a tracer that is only
+     *  told about requests once they are answered
+     */
+    template <typename T, typename = void>
+    struct has_stage_hook : std::false_type {};
+
+    /**
+     *  Structure matching on tracers that want
+     *  to know when every stage is reached
+     */
+    template <typename T>
+    struct has_stage_hook<T, std::void_t<
+        // handle a stage being reached
+        decltype(T::on_stage(std::declval<request_timeline::time_point request_timeline::*>()))
+    >> : std::true_type {};
+
+    template <typename T>
+    constexpr bool has_stage_hook_v = has_stage_hook<T>::value;
+
+    /**
+     *  The timelines of the requests on a connection,
+     *  reported to a tracer once the requests are answered
+     *
+     *  The stages up to reading the body belong to the
+     *  request being read, the later stages to a request
+     *  in flight, by its sequence number.
+     */
+    template <typename tracer_type>
+    class request_tracer
+    {
+        public:
+            using clock_type    = request_timeline::clock_type;
+            using time_point    = request_timeline::time_point;
+            using stage_type    = time_point request_timeline::*;
+
+            /**
+             *  Constructor
+             *
+             *  @param  depth   The maximum number of requests in flight
+             */
+            request_tracer(std::size_t depth) :
+                _timelines(std::max<std::size_t>(depth, 1))
+            {
+                // the connection was just accepted
+                _reading.accepted = clock_type::now();
+                reached(&request_timeline::accepted);
+            }
+
+            /**
+             *  Record a stage of the connection, or of the request being read
+             *
+             *  @param  stage   The stage that was reached
+             */
+            void reading(stage_type stage) noexcept
+            {
+                _reading.*stage = clock_type::now();
+                reached(stage);
+            }
+
+            /**
+             *  Record a stage of the request being read, at a known time
+             *
+             *  @param  stage   The stage that was reached
+             *  @param  time    The time the stage was reached
+             */
+            void reading(stage_type stage, time_point time) noexcept
+            {
+                _reading.*stage = time;
+                reached(stage);
+            }
+
+            /**
+             *  Move the request that was read into flight
+             *
+             *  @param  sequence    The sequence number of the request
+             *  @param  method      The method of the request
+             */
+            void start(std::size_t sequence, boost::beast::http::verb method) noexcept
+            {
+                // the body is complete, the header was parsed along with it if
+                // the header read already brought in the complete request
+                _reading.body_complete = clock_type::now();
+                reached(&request_timeline::body_complete);
+                if (_reading.header_parsed == time_point{}) {
+                    _reading.header_parsed = _reading.body_complete;
+                }
+
+                // the request is now in flight
+                auto& timeline  = timeline_for(sequence);
+                timeline        = _reading;
+                timeline.method = method;
+
+                // the next request starts on the same connection
+                _reading.first_byte     = {};
+                _reading.header_parsed  = {};
+                _reading.body_complete  = {};
+            }
+
+            /**
+             *  Record a stage of a request in flight
+             *
+             *  @param  sequence    The sequence number of the request
+             *  @param  stage       The stage that was reached
+             */
+            void handling(std::size_t sequence, stage_type stage) noexcept
+            {
+                timeline_for(sequence).*stage = clock_type::now();
+                reached(stage);
+            }
+
+            /**
+             *  Record the start of a write, for the responses
+             *  that are written for the first time
+             *
+             *  @param  sequence    The sequence number of the first response in the write
+             *  @param  count       The number of responses in the write
+             */
+            void writing(std::size_t sequence, std::size_t count) noexcept
+            {
+                // the time the write starts
+                auto now = clock_type::now();
+                reached(&request_timeline::first_write);
+
+                // update the responses in the write
+                for (auto end = sequence + count; sequence != end; ++sequence) {
+                    // only the first write of a response counts
+                    if (auto& timeline = timeline_for(sequence); timeline.first_write == time_point{}) {
+                        timeline.first_write = now;
+                    }
+                }
+            }
+
+            /**
+             *  Report a request that was answered to the tracer
+             *
+             *  @param  sequence    The sequence number of the request
+             *  @param  time        The time the response was written
+             *  @param  route       The number of the route that handled the request
+             *  @param  status      The status code of the response
+             */
+            void finish(std::size_t sequence, time_point time, std::size_t route, unsigned status) noexcept
+            {
+                // complete the timeline
+                auto& timeline      = timeline_for(sequence);
+                timeline.last_write = time;
+                timeline.route      = route;
+                timeline.status     = status;
+                reached(&request_timeline::last_write);
+
+                // let the tracer know
+                tracer_type::on_request(timeline);
+            }
+        private:
+            /**
+             *  Let the tracer know a stage was reached,
+             *  if it wants to know
+             *
+             *  @param  stage   The stage that was reached
+             */
+            static void reached(stage_type stage) noexcept
+            {
+                // is the tracer interested?
+                if constexpr (has_stage_hook_v<tracer_type>) {
+                    tracer_type::on_stage(stage);
+                }
+            }
+
+            /**
+             *  Retrieve the timeline for a request in flight
+             *
+             *  @param  sequence    The sequence number of the request
+             *  @return The timeline for the request
+             */
+            request_timeline& timeline_for(std::size_t sequence) noexcept
+            {
+                return _timelines[sequence % _timelines.size()];
+            }
+
+            request_timeline                                                        _reading{};     // the timeline of the request being read
+            std::vector<request_timeline, recycling_allocator<request_timeline>>    _timelines;     // the timelines of the requests in flight
+    };
+
+    /**
+     *  Without a tracer, nothing is stored or recorded
+     */
+    template <>
+    class request_tracer<null_tracer>
+    {
+        public:
+            using time_point    = request_timeline::time_point;
+            using stage_type    = time_point request_timeline::*;
+
+            request_tracer(std::size_t) noexcept {}
+            void reading(stage_type) noexcept {}
+            void reading(stage_type, time_point) noexcept {}
+            void start(std::size_t, boost::beast::http::verb) noexcept {}
+            void handling(std::size_t, stage_type) noexcept {}
+            void writing(std::size_t, std::size_t) noexcept {}
+            void finish(std::size_t, time_point, std::size_t, unsigned) noexcept {}
+    };
+
+    // connections store the tracer as a base class, which
+    // only takes no space as long as it stores nothing
+    static_assert(std::is_empty_v<request_tracer<null_tracer>>, "The null tracer must not store anything");
+
+}
@@ -0,0 +1,334 @@
+#pragma once
+
+#include <boost/beast/http/string_body.hpp>
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+#include "derived_optional.h"
+#include "recycling_allocator.h"
+#include "buffer_data_source.h"
+#include "data_source.h"
+#include "message_data_source.h"
+
+
+namespace tamed {
+
+    /**
+     *  Queue of responses for the requests that are in
+     *  flight on a connection. Every request reserves a
+     *  slot, and the responses are written in the order
+     *  of the requests, no matter in which order the
+     *  handlers produce them.
+     */
+    class response_queue
+    {
+        public:
+            /**
+             *  The storage for a single response, large enough to hold
+             *  the serializer of a string response or a serialized
+             *  response without allocating
+             */
+            using slot_type = derived_optional<data_source, std::max(sizeof(message_data_source<boost::beast::http::string_body>), sizeof(buffer_data_source))>;
+
+            /**
+             *  Constructor
+             *
+             *  @param  depth   The maximum number of requests in flight
+             */
+            response_queue(std::size_t depth) :
+                _slots(std::max<std::size_t>(depth, 1))
+            {
+                // every response in flight can be part of a write
+                _batches.reserve(_slots.size());
+            }
+
+            /**
+             *  Retrieve the number of requests in flight
+             *
+             *  @return The number of requests still waiting for their response to be written
+             */
+            std::size_t size() const noexcept
+            {
+                return _next - _front;
+            }
+
+            /**
+             *  Are there no requests in flight?
+             *
+             *  @return Whether all responses have been written
+             */
+            bool empty() const noexcept
+            {
+                return size() == 0;
+            }
+
+            /**
+             *  Is the maximum number of requests in flight reached?
+             *
+             *  @return Whether no more requests should be read
+             */
+            bool full() const noexcept
+            {
+                return size() == _slots.size();
+            }
+
+            /**
+             *  Retrieve the sequence number of the oldest request
+             *
+             *  @return The sequence number of the request to write a response for
+             */
+            std::size_t sequence() const noexcept
+            {
+                return _front;
+            }
+
+            /**
+             *  Retrieve the number of responses with data
+             *  in the last call to gather() or gather_file()
+             *
+             *  @return The number of responses, starting with the oldest request
+             */
+            std::size_t batches() const noexcept
+            {
+                return _batches.size();
+            }
+
+            /**
+             *  Reserve a slot for the response to a new request
+             *
+             *  @return The sequence number of the request
+             *  @precondition   The queue must not be full
+             */
+            std::size_t reserve() noexcept
+            {
+                return _next++;
+            }
+
+            /**
+             *  Store the response for a request
+             *
+             *  @param  sequence    The sequence number of the request
+             *  @param  parameters  The parameters for creating the response
+             *  @return Whether the response was stored, a request can only be answered once
+             */
+            template <typename instance, typename... arguments>
+            bool emplace(std::size_t sequence, arguments&&... parameters)
+            {
+                // the request must be in flight, and not be answered yet
+                if (!awaiting(sequence)) {
+                    return false;
+                }
+
+                // create the response in the slot
+                _slots[sequence % _slots.size()].template emplace<instance>(std::forward<arguments>(parameters)...);
+                return true;
+            }
+
+            /**
+             *  Is a request still waiting for its response?
+             *
+             *  @param  sequence    The sequence number of the request
+             *  @return Whether the request is in flight, and was not answered yet
+             */
+            bool awaiting(std::size_t sequence) const noexcept
+            {
+                return sequence - _front < size() && !_slots[sequence % _slots.size()].has_value();
+            }
+
+            /**
+             *  Retrieve the response to write next
+             *
+             *  @return The response for the oldest request, or a
+             *          nullptr if that response is not ready yet
+             */
+            data_source* front() noexcept
+            {
+                // the slot for the oldest request
+                auto& slot = _slots[_front % _slots.size()];
+
+                // is there a response ready for the request?
+                if (empty() || !slot.has_value()) {
+                    return nullptr;
+                }
+
+                // return the response to write
+                return &*slot;
+            }
+
+            /**
+             *  Ask the client to close the connection after the
+             *  response to the newest request, if that response
+             *  is ready and none of it was written yet
+             */
+            void close_last() noexcept
+            {
+                // the slot for the newest request
+                auto& slot = _slots[(_next - 1) % _slots.size()];
+
+                // is there a response to change?
+                if (!empty() && slot.has_value()) {
+                    slot->close();
+                }
+            }
+
+            /**
+             *  Collect the data of the responses that are ready,
+             *  so they can be written to the stream together
+             *
+             *  Responses are added in order, starting with the
+             *  oldest request. A response is only followed by the
+             *  next one if all its remaining data was added, and
+             *  no more responses are added once the byte limit
+             *  is reached or the buffers are full.
+             *
+             *  @param  buffers The array to add the buffers to be sent to
+             *  @param  limit   The number of bytes after which no more responses are added
+             *  @param  ec      The error code from getting the data
+             *  @return Whether data was left out because the buffers were full
+             */
+            bool gather(data_source::buffers_type& buffers, std::size_t limit, boost::system::error_code& ec) noexcept
+            {
+                // the number of bytes gathered so far
+                std::size_t total{ 0 };
+
+                // forget about the previous write
+                _batches.clear();
+
+                // add the responses, starting with the oldest
+                for (auto sequence = _front; sequence != _next; ++sequence) {
+                    // the slot with the response
+                    auto& slot = _slots[sequence % _slots.size()];
+
+                    // stop at a response that is not ready yet
+                    if (!slot.has_value()) {
+                        break;
+                    }
+
+                    // the response is ready, but we cannot fit any more data
+                    if (buffers.size() == buffers.capacity()) {
+                        return true;
+                    }
+
+                    // the number of buffers before adding the response
+                    auto first = buffers.size();
+
+                    // add the data for the response
+                    slot->next(buffers, ec);
+
+                    // stop if we failed to get the data, or got nothing
+                    if (ec != boost::system::error_code{} || buffers.size() == first) {
+                        break;
+                    }
+
+                    // the number of bytes added for the response
+                    std::size_t size{ 0 };
+
+                    // add up the size of the new buffers
+                    for (auto index = first; index < buffers.size(); ++index) {
+                        size += buffers[index].size();
+                    }
+
+                    // remember the size, so we know which responses were written
+                    _batches.push_back(size);
+                    total += size;
+
+                    // can we write the next response after this one?
+                    if (!slot->is_final_batch() || total >= limit) {
+                        // the buffers may have been too few for the response
+                        return buffers.size() == buffers.capacity() && !slot->is_final_batch();
+                    }
+                }
+
+                // all the ready responses were added
+                return false;
+            }
+
+            /**
+             *  Retrieve the file data that can be sent
+             *  directly for the oldest request
+             *
+             *  @return The part of the file to send, or an empty
+             *          region when the response must be gathered
+             */
+            file_region gather_file() noexcept
+            {
+                // the response for the oldest request
+                auto* response = front();
+
+                // is the response ready?
+                if (response == nullptr) {
+                    return {};
+                }
+
+                // find the data in the file
+                auto region = response->next_file();
+
+                // the written bytes all belong to the response
+                _batches.clear();
+                _batches.push_back(region.size);
+
+                // return the region to send
+                return region;
+            }
+
+            /**
+             *  Consume the data that was written from the
+             *  buffers collected by the last call to gather(),
+             *  or the file from the last call to gather_file(),
+             *  and remove the responses that are complete
+             *
+             *  The handler is invoked for every response with written
+             *  data, with the sequence number of the request, the
+             *  number of bytes written and whether the response is
+             *  now complete.
+             *
+             *  @param  transferred The number of bytes that were written
+             *  @param  written     The handler to invoke for the written responses
+             */
+            template <typename handler_type>
+            void consume(std::size_t transferred, handler_type&& written) noexcept
+            {
+                // process the responses that were gathered
+                for (auto size : _batches) {
+                    // the response at the front of the queue
+                    auto& response  = *_slots[_front % _slots.size()];
+                    auto  consumed  = std::min(size, transferred);
+
+                    // consume the bytes that belong to this response
+                    response.consume(consumed);
+                    transferred -= consumed;
+
+                    // let the caller know what was written
+                    written(_front, consumed, response.is_done());
+
+                    // stop at a response that has data left to write
+                    if (!response.is_done()) {
+                        break;
+                    }
+
+                    // the response was written completely
+                    pop();
+                }
+
+                // the batches have been processed
+                _batches.clear();
+            }
+
+            /**
+             *  Remove the response to the oldest request,
+             *  after it has been completely written
+             */
+            void pop() noexcept
+            {
+                // destroy the response and move on to the next request
+                _slots[_front % _slots.size()].reset();
+                ++_front;
+            }
+        private:
+            std::vector<slot_type, recycling_allocator<slot_type>>      _slots;         // the storage for every request in flight
+            std::vector<std::size_t, recycling_allocator<std::size_t>>  _batches;       // the number of bytes gathered for each response
+            std::size_t                                                 _front{ 0 };    // the sequence number of the oldest request
+            std::size_t                                                 _next{ 0 };     // the sequence number for the next request
+    };
+
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+
+namespace tamed {
+
+    /**
+     *  The outcome of routing a request
+     */
+    enum class route_result
+    {
+        routed,             // a handler was found for the path and method
+        not_found,          // no handler was found for the path
+        method_not_allowed, // the method is not supported for the path
+        options             // the allowed methods were sent in answer to OPTIONS
+    };
+
+    /**
+     *  Statistics on the outcome of routing the
+     *  requests on the connections of an executor
+     */
+    class routing_statistics
+    {
+        public:
+            /**
+             *  Constructor
+             */
+            routing_statistics() noexcept = default;
+
+            /**
+             *  Copy constructor
+             *
+             *  @param  that    The statistics to copy
+             */
+            routing_statistics(const routing_statistics& that) noexcept
+            {
+                // add all the counters
+                *this += that;
+            }
+
+            /**
+             *  Record the outcome of routing a request
+             *
+             *  @param  result  The outcome to count
+             */
+            void record(route_result result) noexcept
+            {
+                // update the counter, they are only written
+                // from the executor running the connections
+                _counters[static_cast<std::size_t>(result)].fetch_add(1, std::memory_order_relaxed);
+            }
+
+            /**
+             *  Add the counters from other statistics
+             *
+             *  @param  that    The statistics to add
+             *  @return Same object for chaining
+             */
+            routing_statistics& operator+=(const routing_statistics& that) noexcept
+            {
+                // add all the counters
+                for (std::size_t index{ 0 }; index < outcome_count; ++index) {
+                    // add the requests with this outcome
+                    _counters[index].fetch_add(that._counters[index].load(std::memory_order_relaxed), std::memory_order_relaxed);
+                }
+
+                // allow chaining
+                return *this;
+            }
+
+            /**
+             *  Retrieve the number of requests with an outcome
+             *
+             *  @param  result  The outcome to retrieve
+             *  @return The number of requests routed with this outcome
+             */
+            std::uint64_t requests(route_result result) const noexcept
+            {
+                return _counters[static_cast<std::size_t>(result)].load(std::memory_order_relaxed);
+            }
+        private:
+            /**
+             *  The number of different outcomes
+             */
+            constexpr const static std::size_t outcome_count = 4;
+
+            std::array<std::atomic<std::uint64_t>, outcome_count>   _counters{};    // the number of requests for every outcome
+    };
+
+}
@@ -0,0 +1,226 @@
+#pragma once
+
+#include <boost/asio/executor_work_guard.hpp>
+#include <boost/asio/io_context.hpp>
+#include <pthread.h>
+#include <sched.h>
+#include <algorithm>
+#include <optional>
+#include <thread>
+#include <vector>
+#include <deque>
+
+
+namespace tamed {
+
+    /**
+     *  Class running a pool of threads, each with their
+     *  own io_context and optionally pinned to a CPU.
+     *
+     *  The executors for the contexts can be given to the
+     *  server, which will then keep each connection on the
+     *  context that it was created on.
+     */
+    class runner
+    {
+        public:
+            using executor_type = boost::asio::io_context::executor_type;
+
+            /**
+             *  Constructor
+             *
+             *  @param  threads The number of threads and contexts to create
+             *  @param  pin     Whether to pin each thread to its own CPU
+             */
+            runner(std::size_t threads = std::thread::hardware_concurrency(), bool pin = true) :
+                _pin{ pin }
+            {
+                // we need at least a single thread
+                threads = std::max<std::size_t>(threads, 1);
+
+                // create a context for every thread, each of them is only
+                // run from a single thread, which lets asio queue handlers
+                // posted from that thread without taking its lock. Locking
+                // stays enabled, since other threads still post to the
+                // context, e.g. when stopping or draining, so the unsafe
+                // concurrency hints cannot be used here
+                for (std::size_t index{ 0 }; index < threads; ++index) {
+                    // create the context and keep it running until stopped
+                    auto& context = _contexts.emplace_back(1);
+                    _guards.emplace_back(context.get_executor());
+                }
+            }
+
+            /**
+             *  Copying and moving is not allowed, the
+             *  threads refer back to the runner
+             */
+            runner(const runner&) = delete;
+            runner(runner&&) = delete;
+
+            /**
+             *  Destructor
+             */
+            ~runner()
+            {
+                // stop the contexts and wait for the threads
+                stop();
+                join();
+            }
+
+            /**
+             *  Retrieve the number of contexts
+             *
+             *  @return The number of contexts and threads
+             */
+            std::size_t size() const noexcept
+            {
+                return _contexts.size();
+            }
+
+            /**
+             *  Retrieve the executors for all the contexts
+             *
+             *  @return An executor for every context
+             */
+            std::vector<executor_type> get_executors() noexcept
+            {
+                // the executors to return
+                std::vector<executor_type> result;
+
+                // retrieve the executor from every context
+                for (auto& context : _contexts) {
+                    // add the executor
+                    result.push_back(context.get_executor());
+                }
+
+                // return the executors
+                return result;
+            }
+
+            /**
+             *  Start running all the contexts, each on their own
+             *  thread. This function returns immediately.
+             */
+            void start()
+            {
+                // the cpus that the process is allowed to run on
+                std::vector<int> cpus;
+
+                // do we need to pin the threads?
+                if (_pin) {
+                    // retrieve the affinity of the process
+                    cpu_set_t allowed;
+                    CPU_ZERO(&allowed);
+
+                    // only pin if we can read the affinity mask
+                    if (sched_getaffinity(0, sizeof(allowed), &allowed) == 0) {
+                        // collect all the allowed cpus
+                        for (int cpu{ 0 }; cpu < CPU_SETSIZE; ++cpu) {
+                            // is this cpu allowed
+                            if (CPU_ISSET(cpu, &allowed)) {
+                                // add it to the list
+                                cpus.push_back(cpu);
+                            }
+                        }
+                    }
+                }
+
+                // start a thread for every context
+                for (std::size_t index{ 0 }; index < _contexts.size(); ++index) {
+                    // find the cpu to pin to, if any
+                    std::optional<int> cpu;
+
+                    // spread the threads over the allowed cpus
+                    if (!cpus.empty()) {
+                        // wrap around when there are more threads than cpus
+                        cpu = cpus[index % cpus.size()];
+                    }
+
+                    // run the context on the new thread
+                    _threads.emplace_back([this, index, cpu]() {
+                        // pin the thread before running anything on it, so
+                        // that the memory used by the thread is local to the cpu
+                        if (cpu.has_value()) {
+                            // create the set with only the chosen cpu
+                            cpu_set_t set;
+                            CPU_ZERO(&set);
+                            CPU_SET(*cpu, &set);
+
+                            // pinning is an optimization, a failure is not fatal
+                            pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+                        }
+
+                        // run the context until it is stopped
+                        _contexts[index].run();
+                    });
+                }
+            }
+
+            /**
+             *  Run all the contexts, and block until they
+             *  are stopped and all threads have finished
+             */
+            void run()
+            {
+                // start the threads and wait for them
+                start();
+                join();
+            }
+
+            /**
+             *  Stop all the contexts, this may be called
+             *  from any thread. Handlers that are still
+             *  pending will not be invoked.
+             */
+            void stop() noexcept
+            {
+                // stop every context
+                for (auto& context : _contexts) {
+                    // stop the context from running
+                    context.stop();
+                }
+            }
+
+            /**
+             *  Let the contexts finish when they run out of work,
+             *  instead of waiting indefinitely for new connections
+             */
+            void release() noexcept
+            {
+                // drop all the guards keeping the contexts alive
+                for (auto& guard : _guards) {
+                    // the context may now run out of work
+                    guard.reset();
+                }
+            }
+
+            /**
+             *  Wait for all the threads to finish
+             *
+             *  @note   This must not be called from one of the runner threads
+             */
+            void join() noexcept
+            {
+                // wait for every thread
+                for (auto& thread : _threads) {
+                    // is the thread still running?
+                    if (thread.joinable()) {
+                        // wait for it to finish
+                        thread.join();
+                    }
+                }
+
+                // all threads are finished
+                _threads.clear();
+            }
+        private:
+            using guard_type = boost::asio::executor_work_guard<executor_type>;
+
+            bool                                _pin;       // whether to pin threads to cpus
+            std::deque<boost::asio::io_context> _contexts;  // the context for every thread
+            std::deque<guard_type>              _guards;    // guards to keep the contexts running
+            std::vector<std::thread>            _threads;   // the threads running the contexts
+    };
+
+}
@@ -0,0 +1,170 @@
+#pragma once
+
+#include <sys/sendfile.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <boost/asio/error.hpp>
+#include <boost/asio/post.hpp>
+#include <boost/asio/socket_base.hpp>
+#include <boost/beast/core/bind_handler.hpp>
+
+
+namespace tamed {
+
+    /**
+     *  A part of a file to be sent
+     */
+    struct file_region
+    {
+        int             descriptor  { -1 }; // the file to read from, negative if there is no file
+        std::uint64_t   offset      { 0 };  // the position in the file to start from
+        std::size_t     size        { 0 };  // the number of bytes to send
+    };
+
+    /**
+     *  Asynchronous operation to send a part of a file
+     *  to a native socket, without copying the data
+     *  through user space
+     */
+    template <class socket_type, class handler_type>
+    class send_file_operation
+    {
+        public:
+            /**
+             *  Constructor
+             *
+             *  @param  socket  The socket to write to
+             *  @param  region  The part of the file to send
+             *  @param  handler The completion handler to invoke
+             */
+            send_file_operation(socket_type& socket, file_region region, handler_type&& handler) noexcept :
+                _socket{ socket },
+                _region{ region },
+                _handler{ std::move(handler) }
+            {}
+
+            /**
+             *  Start the transfer, without waiting for
+             *  the socket if it can be written to
+             */
+            void start() noexcept
+            {
+                // the error code and number of bytes written
+                boost::system::error_code   ec;
+                std::size_t                 transferred{ 0 };
+
+                // try to write without waiting
+                if (!write(ec, transferred)) {
+                    // wait until the socket can be written to
+                    return _socket.async_wait(boost::asio::socket_base::wait_write, std::move(*this));
+                }
+
+                // we may not invoke the handler from within the initiating
+                // function, so the completion goes through the executor
+                boost::asio::post(_socket.get_executor(), boost::beast::bind_front_handler(std::move(_handler), ec, transferred));
+            }
+
+            /**
+             *  Callback handler for the socket becoming writable
+             *
+             *  @param  ec  The error code from the operation
+             */
+            void operator()(boost::system::error_code ec) noexcept
+            {
+                // the number of bytes written
+                std::size_t transferred{ 0 };
+
+                // did waiting for the socket fail?
+                if (ec != boost::system::error_code{}) {
+                    // report the error
+                    return _handler(ec, transferred);
+                }
+
+                // try to write the data
+                if (!write(ec, transferred)) {
+                    // the socket is not writable after all
+                    return _socket.async_wait(boost::asio::socket_base::wait_write, std::move(*this));
+                }
+
+                // the write has finished
+                _handler(ec, transferred);
+            }
+        private:
+            /**
+             *  Send file data to the socket
+             *
+             *  @param  ec          The error code from the write
+             *  @param  transferred The number of bytes written
+             *  @return Whether the write finished, or needs to wait for the socket
+             */
+            bool write(boost::system::error_code& ec, std::size_t& transferred) noexcept
+            {
+                // the kernel sends at most this many bytes per call
+                constexpr const std::size_t limit = 0x7ffff000;
+
+                // the position to read from, updated by the kernel
+                auto offset = static_cast<off_t>(_region.offset);
+
+                while (true) {
+                    // send from the file, the socket is in non-blocking
+                    // mode since asio has started operations on it
+                    auto result = ::sendfile(_socket.native_handle(), _region.descriptor, &offset, std::min(_region.size, limit));
+
+                    // did the file end before the region? it must have been
+                    // truncated after it was opened, and trying again would
+                    // only send nothing again
+                    if (result == 0 && _region.size != 0) {
+                        ec = boost::asio::error::eof;
+                        return true;
+                    }
+
+                    // did the write succeed?
+                    if (result >= 0) {
+                        transferred = static_cast<std::size_t>(result);
+                        return true;
+                    }
+
+                    // the write was interrupted, try again
+                    if (errno == EINTR) {
+                        continue;
+                    }
+
+                    // the socket buffer is full, wait for room
+                    if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                        return false;
+                    }
+
+                    // an error occurred
+                    ec.assign(errno, boost::system::system_category());
+                    return true;
+                }
+            }
+
+            socket_type&    _socket;    // the socket to write to
+            file_region     _region;    // the part of the file to send
+            handler_type    _handler;   // the completion handler to invoke
+    };
+
+    /**
+     *  Send a part of a file to a native socket
+     *  asynchronously, the handler receives the
+     *  number of bytes written, which may be less
+     *  than the size of the region, or an end of
+     *  file error if the file is shorter than the
+     *  region, after it was truncated
+     *
+     *  @param  socket  The socket to write to
+     *  @param  region  The part of the file to send
+     *  @param  handler The completion handler
+     */
+    template <class socket_type, class handler_type>
+    void async_send_file(socket_type& socket, file_region region, handler_type&& handler)
+    {
+        // create and start the operation
+        send_file_operation<socket_type, std::decay_t<handler_type>>{ socket, region, std::forward<handler_type>(handler) }.start();
+    }
+
+}
@@ -4,9 +4,35 @@
 #include <boost/asio/ip/tcp.hpp>
 #include <boost/asio/ssl/context.hpp>
 #include <boost/asio/local/stream_protocol.hpp>
+#include <boost/asio/any_io_executor.hpp>
+#include <boost/asio/post.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/asio/strand.hpp>
 #include <router/table.h>
-#include "enum_map.h"
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <deque>
+#include "accept_statistics.h"
+#include "allocation_statistics.h"
+#include "buffer_cache.h"
+#include "handshake_statistics.h"
+#include "metrics_writer.h"
+#include "routing_statistics.h"
+#include "request_statistics.h"
+#include "write_statistics.h"
+#include "executor_pool.h"
+#include "request_router.h"
+#include "settings.h"
+#include "runner.h"
 #include "config.h"
+#include "kernel_tls_stream.h"
 
 
 namespace tamed {
@@ -23,15 +49,25 @@ namespace tamed {
      *
      *  This class can be used with a config specialization, to
      *  customize certain behaviours of the server.
+     *
+     *  The server must outlive running its executors. Once it
+     *  is destroyed, the io_context may only be stopped and
+     *  destroyed, which destroys the pending handlers of the
+     *  connections without invoking them.
      */
-    template <typename body_type, typename executor_type, boost::beast::http::verb... verbs>
-    class server<config<body_type, executor_type, verbs...>>
+    template <typename body_type, typename executor_type, typename traits_type, boost::beast::http::verb... verbs>
+    class server<basic_config<body_type, executor_type, traits_type, verbs...>>
     {
         public:
             using request_body_type = body_type;
-            using request_type      = boost::beast::http::request<body_type>;
-            using routing_table     = router::table<void(connection, request_type&&)>;
-            using map_type          = enum_map<boost::beast::http::verb, routing_table, verbs...>;
+            using fields_type       = typename traits_type::fields_type;
+            using logger_type       = typename traits_type::logger_type;
+            using tracer_type       = typename traits_type::tracer_type;
+            using request_type      = boost::beast::http::request<body_type, fields_type>;
+            using router_type       = request_router<request_type, verbs...>;
+            using routing_table     = typename router_type::routing_table;
+            using map_type          = typename router_type::map_type;
+            using metrics_body      = boost::beast::http::basic_string_body<char, std::char_traits<char>, buffer_cache_allocator<char>>;
 
             /**
              *  Constructor
@@ -39,9 +75,28 @@ namespace tamed {
              *  @param  executor    The executor to use
              */
             server(executor_type executor) :
-                _executor{ executor }
+                _executors{ std::vector<executor_type>{ executor } }
             {}
 
+            /**
+             *  Constructor
+             *
+             *  Regular listeners accept on the first executor and
+             *  distribute their connections over all executors,
+             *  sharded listeners accept on every executor.
+             *
+             *  @param  executors   The executors to use
+             *  @throws std::invalid_argument
+             */
+            server(std::vector<executor_type> executors) :
+                _executors{ executors }
+            {
+                // we need at least one executor to work with
+                if (_executors.empty()) {
+                    throw std::invalid_argument{ "At least one executor is required" };
+                }
+            }
+
             /**
              *  Constructor
              *
@@ -52,6 +107,171 @@ namespace tamed {
                 server{ io_context.get_executor() }
             {}
 
+            /**
+             *  Constructor
+             *
+             *  Use the contexts from the runner, combine with
+             *  listen_sharded() to spread the connections over
+             *  all the contexts.
+             *
+             *  @param  runner  The runner with the contexts to use
+             */
+            template <typename X = executor_type, typename = std::enable_if_t<std::is_constructible_v<X, runner::executor_type>>>
+            server(runner& runner) :
+                server{ convert_executors(runner.get_executors()) }
+            {}
+
+            /**
+             *  Retrieve the settings to tune the server
+             *
+             *  @return The modifiable server settings
+             */
+            settings& get_settings() noexcept
+            {
+                return _settings;
+            }
+
+            /**
+             *  Retrieve the accept statistics, combined
+             *  over all the listeners of the server
+             *
+             *  @return The number of connections accepted per wakeup
+             */
+            accept_statistics get_accept_statistics() const noexcept
+            {
+                // the statistics to combine into
+                accept_statistics result;
+
+                // add the statistics from every listener
+                for (const auto& statistics : _accept_statistics) {
+                    // combine with the result
+                    result += statistics;
+                }
+
+                // return the combined statistics
+                return result;
+            }
+
+            /**
+             *  Retrieve the write statistics, combined
+             *  over all the executors of the server
+             *
+             *  @return The number of writes, and how many were cut short
+             */
+            write_statistics get_write_statistics() const noexcept
+            {
+                // the statistics to combine into
+                write_statistics result;
+
+                // add the statistics from every executor
+                for (std::size_t index{ 0 }; index < _executors.size(); ++index) {
+                    // combine with the result
+                    result += _executors[index].get_write_statistics();
+                }
+
+                // return the combined statistics
+                return result;
+            }
+
+            /**
+             *  Retrieve the routing statistics, combined
+             *  over all the executors of the server
+             *
+             *  @return The number of requests for every routing outcome
+             */
+            routing_statistics get_routing_statistics() const noexcept
+            {
+                // the statistics to combine into
+                routing_statistics result;
+
+                // add the statistics from every executor
+                for (std::size_t index{ 0 }; index < _executors.size(); ++index) {
+                    // combine with the result
+                    result += _executors[index].get_routing_statistics();
+                }
+
+                // return the combined statistics
+                return result;
+            }
+
+            /**
+             *  Retrieve the request statistics, combined
+             *  over all the executors of the server
+             *
+             *  The metrics for a route are found by the
+             *  number of the route, see get_routes(), and
+             *  the metrics for a method by the index of
+             *  the method in the configuration.
+             *
+             *  @return The requests, responses, bytes and latencies, per route and per method
+             */
+            request_statistics get_request_statistics() const
+            {
+                // the statistics to combine into
+                request_statistics result;
+
+                // add the statistics from every executor
+                for (std::size_t index{ 0 }; index < _executors.size(); ++index) {
+                    // combine with the result
+                    result += _executors[index].get_request_statistics();
+                }
+
+                // return the combined statistics
+                return result;
+            }
+
+            /**
+             *  Retrieve the handshake statistics, combined
+             *  over all the executors of the server
+             *
+             *  @return The number of TLS handshakes that completed and failed
+             */
+            handshake_statistics get_handshake_statistics() const noexcept
+            {
+                // the statistics to combine into
+                handshake_statistics result;
+
+                // add the statistics from every executor
+                for (std::size_t index{ 0 }; index < _executors.size(); ++index) {
+                    // combine with the result
+                    result += _executors[index].get_handshake_statistics();
+                }
+
+                // return the combined statistics
+                return result;
+            }
+
+            /**
+             *  Retrieve the allocation statistics, combined
+             *  over all the executors of the server
+             *
+             *  @return How often the storage for new connections was recycled
+             */
+            allocation_statistics get_allocation_statistics() const noexcept
+            {
+                // the statistics to combine into
+                allocation_statistics result;
+
+                // add the statistics from every executor
+                for (std::size_t index{ 0 }; index < _executors.size(); ++index) {
+                    // combine with the result
+                    result += _executors[index].get_allocation_statistics();
+                }
+
+                // return the combined statistics
+                return result;
+            }
+
+            /**
+             *  Retrieve the routes that were added
+             *
+             *  @return The routes, in the order of their numbers
+             */
+            const auto& get_routes() const noexcept
+            {
+                return _router.get_routes();
+            }
+
             /**
              *  Add an endpoint to be handled
              *
@@ -64,7 +284,7 @@ namespace tamed {
             add(boost::beast::http::verb method, std::string_view endpoint)
             {
                 // add the endpoint to the table
-                _routers[method].template add<callback>(endpoint);
+                _router.template add<callback>(method, endpoint);
             }
 
             /**
@@ -80,12 +300,16 @@ namespace tamed {
             add(boost::beast::http::verb method, std::string_view endpoint, typename router::function_traits<decltype(callback)>::member_type* instance)
             {
                 // add the endpoint to the table
-                _routers[method].template add<callback>(endpoint, instance);
+                _router.template add<callback>(method, endpoint, instance);
             }
 
             /**
              *  Listen at the given endpoint
              *
+             *  The connections are distributed over all the
+             *  executors, according to the dispatch policy
+             *  from the settings.
+             *
              *  @param  endpoint    The endpoint to listen to
              *  @return The error code from the operation
              */
@@ -94,15 +318,42 @@ namespace tamed {
             {
                 // deduce the protocol type and the listener to create
                 using protocol_type = typename endpoint_type::protocol_type;
-                using listener_type = listen_operation<request_body_type, protocol_type, executor_type, map_type>;
+                using listener_type = listen_operation<request_type, protocol_type, executor_type, router_type, logger_type, tracer_type>;
 
                 // create a listener, initialize it and return the result
                 return listener_type{
-                    _routers,
-                    _executor
+                    _router,
+                    _executors,
+                    nullptr,
+                    _settings,
+                    _accept_statistics.emplace_back()
                 }(endpoint);
             }
 
+            /**
+             *  Listen at the given endpoint with an acceptor
+             *  for every executor. The acceptors are bound with
+             *  SO_REUSEPORT so the kernel balances incoming
+             *  connections between them, and every connection
+             *  stays on the executor that accepted it.
+             *
+             *  @param  endpoint    The endpoint to listen to
+             *  @return The error code from the operation
+             */
+            template <typename endpoint_type>
+            boost::system::error_code listen_sharded(const endpoint_type& endpoint)
+            {
+                // deduce the protocol type and the listener to create
+                using protocol_type = typename endpoint_type::protocol_type;
+                using listener_type = listen_operation<request_type, protocol_type, executor_type, router_type, logger_type, tracer_type>;
+
+                // create a listener for every executor
+                return listen_shards<listener_type>(endpoint, [this](auto& slot) {
+                    // initialize the listener as a shard of the endpoint
+                    return listener_type{ _router, _executors, &slot, _settings, _accept_statistics.emplace_back() };
+                });
+            }
+
             /**
              *  Set a handler for endpoints that are not found
              *
@@ -112,11 +363,8 @@ namespace tamed {
             std::enable_if_t<!std::is_member_function_pointer_v<decltype(callback)>>
             set_not_found()
             {
-                // all routing tables get the handler
-                for (std::size_t index{ 0 }; index < _routers.size(); ++index) {
-                    // install handler on the table
-                    _routers[index].template set_not_found<callback>();
-                }
+                // install the handler on the router
+                _router.template set_not_found<callback>();
             }
 
             /**
@@ -129,11 +377,8 @@ namespace tamed {
             std::enable_if_t<std::is_member_function_pointer_v<decltype(callback)>>
             set_not_found(typename router::function_traits<decltype(callback)>::member_type* instance)
             {
-                // all routing tables get the handler
-                for (std::size_t index{ 0 }; index < _routers.size(); ++index) {
-                    // install handler on the table
-                    _routers[index].template set_not_found<callback>(instance);
-                }
+                // install the handler on the router
+                _router.template set_not_found<callback>(instance);
             }
 
             /**
@@ -148,18 +393,534 @@ namespace tamed {
             {
                 // deduce the protocol type and the listener to create
                 using protocol_type = typename endpoint_type::protocol_type;
-                using listener_type = listen_operation<request_body_type, protocol_type, executor_type, map_type, boost::asio::ssl::context&>;
+                using listener_type = listen_operation<request_type, protocol_type, executor_type, router_type, logger_type, tracer_type, boost::asio::ssl::context&>;
 
                 // create a listener, initialize it and return the result
                 return listener_type{
-                    _routers,
-                    _executor,
+                    _router,
+                    _executors,
+                    nullptr,
+                    _settings,
+                    _accept_statistics.emplace_back(),
                     context
                 }(endpoint);
             }
+
+            /**
+             *  Listen at the given endpoint, and let the kernel
+             *  encrypt the data once the handshake is done. When
+             *  the kernel or the cipher does not support this,
+             *  encryption falls back to user space.
+             *
+             *  @param  endpoint    The endpoint to listen to
+             *  @param  context     The TLS context for transport encryption
+             *  @param  mode        The kernel_tls tag
+             *  @return The error code from the operation
+             */
+            template <typename endpoint_type>
+            boost::system::error_code listen(const endpoint_type& endpoint, boost::asio::ssl::context& context, kernel_tls_t mode)
+            {
+                // deduce the protocol type and the listener to create
+                using protocol_type = typename endpoint_type::protocol_type;
+                using listener_type = listen_operation<request_type, protocol_type, executor_type, router_type, logger_type, tracer_type, boost::asio::ssl::context&, kernel_tls_t>;
+
+                // create a listener, initialize it and return the result
+                return listener_type{
+                    _router,
+                    _executors,
+                    nullptr,
+                    _settings,
+                    _accept_statistics.emplace_back(),
+                    context,
+                    std::move(mode)
+                }(endpoint);
+            }
+
+            /**
+             *  Listen at the given endpoint with an acceptor
+             *  for every executor, using SO_REUSEPORT to
+             *  balance the incoming connections.
+             *
+             *  @param  endpoint    The endpoint to listen to
+             *  @param  context     The TLS context for transport encryption
+             *  @return The error code from the operation
+             */
+            template <typename endpoint_type>
+            boost::system::error_code listen_sharded(const endpoint_type& endpoint, boost::asio::ssl::context& context)
+            {
+                // deduce the protocol type and the listener to create
+                using protocol_type = typename endpoint_type::protocol_type;
+                using listener_type = listen_operation<request_type, protocol_type, executor_type, router_type, logger_type, tracer_type, boost::asio::ssl::context&>;
+
+                // create a listener for every executor
+                return listen_shards<listener_type>(endpoint, [this, &context](auto& slot) {
+                    // initialize the listener as a shard of the endpoint
+                    return listener_type{ _router, _executors, &slot, _settings, _accept_statistics.emplace_back(), context };
+                });
+            }
+
+            /**
+             *  Listen at the given endpoint with an acceptor
+             *  for every executor, using SO_REUSEPORT to
+             *  balance the incoming connections, and let the
+             *  kernel encrypt the data once the handshake is
+             *  done.
+             *
+             *  @param  endpoint    The endpoint to listen to
+             *  @param  context     The TLS context for transport encryption
+             *  @param  mode        The kernel_tls tag
+             *  @return The error code from the operation
+             */
+            template <typename endpoint_type>
+            boost::system::error_code listen_sharded(const endpoint_type& endpoint, boost::asio::ssl::context& context, kernel_tls_t mode)
+            {
+                // deduce the protocol type and the listener to create
+                using protocol_type = typename endpoint_type::protocol_type;
+                using listener_type = listen_operation<request_type, protocol_type, executor_type, router_type, logger_type, tracer_type, boost::asio::ssl::context&, kernel_tls_t>;
+
+                // create a listener for every executor
+                return listen_shards<listener_type>(endpoint, [this, &context, mode](auto& slot) {
+                    // initialize the listener as a shard of the endpoint
+                    return listener_type{ _router, _executors, &slot, _settings, _accept_statistics.emplace_back(), context, kernel_tls_t{ mode } };
+                });
+            }
+
+            /**
+             *  Serve the metrics of the server on a path, in
+             *  the Prometheus text format
+             *
+             *  The metrics are rendered on the given executor, one
+             *  request at a time, and the response is sent from the
+             *  executor of the connection. The executor should not
+             *  run any connections, like a separate thread pool, so
+             *  that a scrape does not delay their requests. There is
+             *  no default, since every executor of the server runs
+             *  connections.
+             *
+             *  @param  endpoint    The path to serve the metrics on
+             *  @param  executor    The executor to render the metrics on, apart from the connections
+             *  @throws std::out_of_range   When GET is not a supported method
+             */
+            template <typename render_executor_type>
+            void expose_metrics(std::string_view endpoint, render_executor_type executor)
+            {
+                // render on a strand, so the requests can share the snapshot and buffer
+                _metrics_strand.emplace(boost::asio::any_io_executor{ executor });
+
+                // add the route like any other handler
+                _router.template add<&server::serve_metrics>(boost::beast::http::verb::get, endpoint, this);
+            }
+
+            /**
+             *  Write the metrics of the server in
+             *  the Prometheus text format
+             *
+             *  @param  output  The string to append the metrics to
+             */
+            template <typename string_type>
+            void render_metrics(string_type& output) const
+            {
+                // the combined metrics of the routes
+                std::vector<request_metrics> snapshot;
+
+                // render using the snapshot
+                render_metrics(output, snapshot);
+            }
+
+            /**
+             *  Drain the server, to shut it down without
+             *  dropping the requests that are in flight
+             *
+             *  The listeners are closed, and idle connections are
+             *  closed right away. Connections with requests in
+             *  flight finish them, with responses that ask the
+             *  client to close, and close afterwards. Connections
+             *  that are still open at the deadline are aborted.
+             *
+             *  The callback is invoked on the first executor, once
+             *  all connections are gone. It must be copyable. A
+             *  handler that holds on to a connection keeps it
+             *  alive, even after it was aborted.
+             *
+             *  @param  deadline    The time at which remaining connections are aborted
+             *  @param  callback    The callback to invoke when all connections have closed
+             */
+            template <typename callback_type>
+            void drain(std::chrono::steady_clock::time_point deadline, callback_type&& callback)
+            {
+                // the timer to abort the connections at the deadline
+                auto timer = std::make_shared<boost::asio::steady_timer>(_executors[0].get_executor(), deadline);
+
+                // the number of executors that have yet to drain
+                auto remaining = std::make_shared<std::atomic<std::size_t>>(_executors.size());
+
+                // abort whatever is left at the deadline
+                timer->async_wait([this](const boost::system::error_code& ec) {
+                    // was the timer cancelled because everything closed?
+                    if (ec == boost::asio::error::operation_aborted) {
+                        return;
+                    }
+
+                    // abort the connections on every executor
+                    for (std::size_t index{ 0 }; index < _executors.size(); ++index) {
+                        // abort on the executor the connections run on
+                        boost::asio::post(_executors[index].get_executor(), [&slot = _executors[index]]() {
+                            // close all connections
+                            slot.get_drain_list().abort();
+                        });
+                    }
+                });
+
+                // drain the acceptors and connections on every executor
+                for (std::size_t index{ 0 }; index < _executors.size(); ++index) {
+                    // drain on the executor they run on
+                    boost::asio::post(_executors[index].get_executor(), [this, &slot = _executors[index], timer, remaining, callback]() {
+                        // stop accepting, and close idle connections
+                        slot.get_drain_list().drain();
+
+                        // only the last executor to drain continues, since
+                        // no new connections are accepted from then on
+                        if (remaining->fetch_sub(1) != 1) {
+                            return;
+                        }
+
+                        // report when the last connection is gone
+                        _executors.get_connection_limit()->on_empty([timer, callback]() {
+                            // continue on the executor of the timer
+                            boost::asio::post(timer->get_executor(), [timer, callback]() mutable {
+                                // the deadline no longer matters
+                                timer->cancel();
+
+                                // let the caller know
+                                callback();
+                            });
+                        });
+                    });
+                }
+            }
         private:
-            executor_type   _executor;  // the executor to use
-            map_type        _routers;   // the tables to route requests
+            /**
+             *  Listen at an endpoint with a listener for every
+             *  executor. When one of the listeners fails, the
+             *  listeners that were already started are closed,
+             *  so the endpoint is either served by all of the
+             *  executors or by none of them.
+             *
+             *  @param  endpoint    The endpoint to listen to
+             *  @param  create      The callback creating the listener for an executor slot
+             *  @return The error code from the operation
+             */
+            template <typename listener_type, typename endpoint_type, typename callback_type>
+            boost::system::error_code listen_shards(const endpoint_type& endpoint, callback_type&& create)
+            {
+                // the listeners started so far
+                std::vector<listener_type> listeners;
+                listeners.reserve(_executors.size());
+
+                // create a listener for every executor
+                for (std::size_t index{ 0 }; index < _executors.size(); ++index) {
+                    // initialize the listener as a shard of the endpoint
+                    if (auto ec = listeners.emplace_back(create(_executors[index]))(endpoint); ec) {
+                        // close the shards that were bound already
+                        for (auto& listener : listeners) {
+                            // stop listening on this shard
+                            listener.close();
+                        }
+
+                        // the endpoint could not be bound
+                        return ec;
+                    }
+                }
+
+                // no errors occured
+                return {};
+            }
+
+            /**
+             *  Write the metrics of the server in
+             *  the Prometheus text format
+             *
+             *  The metrics of every route are combined over the
+             *  executors once, into the snapshot, before they are
+             *  written. The snapshot keeps its storage for reuse.
+             *
+             *  @param  output      The string to append the metrics to
+             *  @param  snapshot    The storage for the combined metrics of the routes
+             */
+            template <typename string_type>
+            void render_metrics(string_type& output, std::vector<request_metrics>& snapshot) const
+            {
+                // the writer to format the metrics
+                metrics_writer writer{ output };
+
+                // combine the metrics of the routes
+                snapshot_routes(snapshot);
+
+                // the number of live connections
+                std::uint64_t open{ 0 };
+
+                // add the connections on every executor
+                for (std::size_t index{ 0 }; index < _executors.size(); ++index) {
+                    // add the connections on this executor
+                    open += _executors[index].connections();
+                }
+
+                // the connections and the acceptors
+                auto accepts = get_accept_statistics();
+                writer.family("tamed_connections_open", "gauge", "The number of open connections");
+                writer.sample("tamed_connections_open", {}, open);
+                writer.family("tamed_connections_accepted_total", "counter", "The number of accepted connections");
+                writer.sample("tamed_connections_accepted_total", {}, accepts.accepted());
+                writer.family("tamed_accept_pauses_total", "counter", "The number of times accepting paused at the connection limit, leaving connections in the backlog");
+                writer.sample("tamed_accept_pauses_total", {}, accepts.pauses());
+
+                // the handshakes
+                auto handshakes = get_handshake_statistics();
+                writer.family("tamed_tls_handshakes_total", "counter", "The number of TLS handshakes");
+                writer.sample("tamed_tls_handshakes_total", { { "result", "completed" } }, handshakes.completed());
+                writer.sample("tamed_tls_handshakes_total", { { "result", "failed" } }, handshakes.failed());
+
+                // the outcome of routing
+                auto routing = get_routing_statistics();
+                writer.family("tamed_routing_total", "counter", "The number of requests by routing outcome");
+                writer.sample("tamed_routing_total", { { "outcome", "routed" } }, routing.requests(route_result::routed));
+                writer.sample("tamed_routing_total", { { "outcome", "not_found" } }, routing.requests(route_result::not_found));
+                writer.sample("tamed_routing_total", { { "outcome", "method_not_allowed" } }, routing.requests(route_result::method_not_allowed));
+                writer.sample("tamed_routing_total", { { "outcome", "options" } }, routing.requests(route_result::options));
+
+                // the requests for every route, requests
+                // without a handler have an empty path
+                writer.family("tamed_requests_total", "counter", "The number of answered requests by route");
+                for_each_route(snapshot, [&writer](std::string_view method, std::string_view path, const request_metrics& metrics) {
+                    writer.sample("tamed_requests_total", { { "method", method }, { "path", path } }, metrics.requests());
+                });
+
+                // the requests for routes beyond the limit of the statistics
+                std::uint64_t overflow{ 0 };
+
+                // add the requests on every executor
+                for (std::size_t index{ 0 }; index < _executors.size(); ++index) {
+                    // add the requests that were not tracked on this executor
+                    overflow += _executors[index].get_request_statistics().get_overflow().requests();
+                }
+
+                writer.family("tamed_requests_untracked_total", "counter", "The number of answered requests for routes that are not tracked by the statistics");
+                writer.sample("tamed_requests_untracked_total", {}, overflow);
+
+                // the responses by class of status
+                writer.family("tamed_responses_total", "counter", "The number of responses by route and class of status");
+                for_each_route(snapshot, [&writer](std::string_view method, std::string_view path, const request_metrics& metrics) {
+                    // the names of the classes
+                    constexpr const std::string_view classes[] = { "1xx", "2xx", "3xx", "4xx", "5xx" };
+
+                    // write the responses for every class
+                    for (std::size_t index{ 0 }; index < std::size(classes); ++index) {
+                        writer.sample("tamed_responses_total", { { "method", method }, { "path", path }, { "code", classes[index] } }, metrics.responses(index + 1));
+                    }
+                });
+
+                // the data received and sent
+                writer.family("tamed_request_bytes_total", "counter", "The number of bytes received in requests by route");
+                for_each_route(snapshot, [&writer](std::string_view method, std::string_view path, const request_metrics& metrics) {
+                    writer.sample("tamed_request_bytes_total", { { "method", method }, { "path", path } }, metrics.bytes_received());
+                });
+                writer.family("tamed_response_bytes_total", "counter", "The number of bytes sent in responses by route");
+                for_each_route(snapshot, [&writer](std::string_view method, std::string_view path, const request_metrics& metrics) {
+                    writer.sample("tamed_response_bytes_total", { { "method", method }, { "path", path } }, metrics.bytes_sent());
+                });
+
+                // the latency of the requests
+                writer.family("tamed_request_duration_seconds", "histogram", "The time from the first byte of a request until its response was written, by route");
+                for_each_route(snapshot, [&writer](std::string_view method, std::string_view path, const request_metrics& metrics) {
+                    writer.histogram("tamed_request_duration_seconds", { { "method", method }, { "path", path } }, metrics.get_latency());
+                });
+
+                // the latency by method, including the requests without a handler
+                writer.family("tamed_method_duration_seconds", "histogram", "The time from the first byte of a request until its response was written, by method");
+                for_each_method([&writer](std::string_view method, const request_metrics& metrics) {
+                    writer.histogram("tamed_method_duration_seconds", { { "method", method } }, metrics.get_latency());
+                });
+
+                // the writes
+                auto writes = get_write_statistics();
+                writer.family("tamed_writes_total", "counter", "The number of writes for responses");
+                writer.sample("tamed_writes_total", {}, writes.writes());
+                writer.family("tamed_writes_capped_total", "counter", "The number of writes that left data behind for lack of buffers");
+                writer.sample("tamed_writes_capped_total", {}, writes.capped_writes());
+
+                // the recycling of connection storage
+                auto allocations = get_allocation_statistics();
+                writer.family("tamed_connection_storage_total", "counter", "The number of connections by where their storage came from");
+                writer.sample("tamed_connection_storage_total", { { "source", "recycled" } }, allocations.connections_recycled());
+                writer.sample("tamed_connection_storage_total", { { "source", "allocated" } }, allocations.connections_allocated());
+                writer.family("tamed_read_buffers_total", "counter", "The number of connections by where their read buffer came from");
+                writer.sample("tamed_read_buffers_total", { { "source", "recycled" } }, allocations.buffers_recycled());
+                writer.sample("tamed_read_buffers_total", { { "source", "allocated" } }, allocations.buffers_allocated());
+            }
+
+            /**
+             *  Answer a request for the metrics
+             *
+             *  The metrics are rendered on the strand for the metrics,
+             *  into the storage of the previous answer, which is kept
+             *  in a cache once it was written. The output is reserved
+             *  at the size of the previous answer, so that rendering
+             *  does not have to grow it.
+             *
+             *  @param  connection  The connection the request came in on
+             *  @param  request     The request for the metrics
+             */
+            void serve_metrics(connection connection, request_type&& request)
+            {
+                // the request is gone once we return, so keep what the response needs
+                auto version    = request.version();
+                auto keep_alive = request.keep_alive();
+
+                // render away from the connection
+                boost::asio::post(*_metrics_strand, [this, connection = std::move(connection), version, keep_alive]() mutable {
+                    // the response to send, its body reuses the cached storage
+                    boost::beast::http::response<metrics_body> response{ boost::beast::http::status::ok, version, metrics_body::value_type{ buffer_cache_allocator<char>{ _metrics_buffers } } };
+                    response.set(boost::beast::http::field::content_type, "text/plain; version=0.0.4");
+                    response.keep_alive(keep_alive);
+
+                    // render the metrics, with room to spare for new series
+                    response.body().reserve(_metrics_size);
+                    render_metrics(response.body(), _metrics_snapshot);
+                    _metrics_size = response.body().size() + response.body().size() / 8;
+
+                    // prepare the header while we are still here
+                    response.prepare_payload();
+
+                    // the response is sent from the executor of the connection
+                    auto executor = connection.get_executor();
+                    boost::asio::post(executor, [connection = std::move(connection), response = std::move(response)]() mutable {
+                        // send the response
+                        connection.send(std::move(response));
+                    });
+                });
+            }
+
+            /**
+             *  Combine the metrics for every route over all
+             *  executors, and those for the requests without
+             *  a handler, which come last
+             *
+             *  @param  snapshot    The combined metrics, the entries are reused
+             */
+            void snapshot_routes(std::vector<request_metrics>& snapshot) const
+            {
+                // the number of routes, and the entry for the requests without one
+                auto routes = _router.get_routes().size();
+
+                // forget the metrics of the previous snapshot
+                for (auto& metrics : snapshot) {
+                    // reset the entry, while keeping its storage
+                    metrics.clear();
+                }
+
+                // make room for every route
+                snapshot.resize(routes + 1);
+
+                // walk over the routes, and the requests without one
+                for (std::size_t route{ 0 }; route <= routes; ++route) {
+                    // requests without a handler come last
+                    auto index = route == routes ? request_statistics::npos : route;
+
+                    // combine the metrics of all executors
+                    for (std::size_t slot{ 0 }; slot < _executors.size(); ++slot) {
+                        // add the metrics, if the route had any requests
+                        if (auto* found = _executors[slot].get_request_statistics().get_route(index); found != nullptr) {
+                            snapshot[route] += *found;
+                        }
+                    }
+                }
+            }
+
+            /**
+             *  Invoke a callback with the metrics for every route,
+             *  and for the requests without a handler
+             *
+             *  @param  snapshot    The metrics combined by snapshot_routes()
+             *  @param  callback    The callback to invoke with the method, path and metrics
+             */
+            template <typename callback_type>
+            void for_each_route(const std::vector<request_metrics>& snapshot, callback_type&& callback) const
+            {
+                // walk over the routes, the requests without one come last
+                for (std::size_t route{ 0 }; route < snapshot.size(); ++route) {
+                    // requests without a handler have no method or path
+                    if (route + 1 == snapshot.size()) {
+                        callback(std::string_view{}, std::string_view{}, snapshot[route]);
+                        continue;
+                    }
+
+                    // the method and path of the route
+                    const auto& entry   = _router.get_routes()[route];
+                    auto        method  = boost::beast::http::to_string(entry.method);
+
+                    // invoke the callback
+                    callback(std::string_view{ method.data(), method.size() }, std::string_view{ entry.path }, snapshot[route]);
+                }
+            }
+
+            /**
+             *  Invoke a callback with the metrics for every
+             *  method, combined over all executors
+             *
+             *  @param  callback    The callback to invoke with the method and metrics
+             */
+            template <typename callback_type>
+            void for_each_method(callback_type&& callback) const
+            {
+                // the methods in the order of their index
+                constexpr const std::array<boost::beast::http::verb, sizeof...(verbs)> methods{ verbs... };
+
+                // walk over the methods, and the methods outside the configuration
+                for (std::size_t index{ 0 }; index <= methods.size(); ++index) {
+                    // the metrics combined over all executors
+                    request_metrics metrics;
+                    for (std::size_t slot{ 0 }; slot < _executors.size(); ++slot) {
+                        // add the metrics, if the method had any requests
+                        if (auto* found = _executors[slot].get_request_statistics().get_method(index); found != nullptr) {
+                            metrics += *found;
+                        }
+                    }
+
+                    // methods outside the configuration are grouped
+                    if (index == methods.size()) {
+                        callback(std::string_view{ "other" }, metrics);
+                        continue;
+                    }
+
+                    // the name of the method
+                    auto method = boost::beast::http::to_string(methods[index]);
+
+                    // invoke the callback
+                    callback(std::string_view{ method.data(), method.size() }, metrics);
+                }
+            }
+
+            /**
+             *  Convert executors to the executor type we use
+             *
+             *  @param  executors   The executors to convert
+             *  @return The converted executors
+             */
+            template <typename input_type>
+            static std::vector<executor_type> convert_executors(const std::vector<input_type>& executors)
+            {
+                // construct our executors from the input
+                return { executors.begin(), executors.end() };
+            }
+
+            executor_pool<executor_type>    _executors;         // the executors to use
+            router_type                     _router;            // the router for the requests
+            settings                        _settings;          // the settings to tune the server
+            std::deque<accept_statistics>   _accept_statistics; // the statistics for every listener
+            std::optional<boost::asio::strand<boost::asio::any_io_executor>>    _metrics_strand;    // the strand to render the metrics on
+            std::shared_ptr<buffer_cache>       _metrics_buffers{ std::make_shared<buffer_cache>() };   // the storage of the last rendered metrics
+            std::vector<request_metrics>        _metrics_snapshot;  // the combined metrics of the routes, only used on the strand
+            std::size_t                         _metrics_size{ 0 }; // the size to reserve for rendering the metrics, only used on the strand
     };
 
     /**
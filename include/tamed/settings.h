@@ -0,0 +1,139 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include "executor_pool.h"
+
+
+namespace tamed {
+
+    /**
+     *  Runtime settings for tuning the server
+     *
+     *  @note   Settings should be configured before the
+     *          server starts listening, listeners and
+     *          connections read them while running
+     *
+     *  @note   Timeouts are checked in ticks of a tenth of a
+     *          second, a timeout of zero disables it. They
+     *          only apply while the connection waits for the
+     *          client, not while a request is being handled.
+     */
+    struct settings
+    {
+        /**
+         *  The maximum number of connections to accept each
+         *  time the acceptor becomes readable. A higher value
+         *  drains bursts of new connections with fewer trips
+         *  through the reactor.
+         */
+        std::size_t accept_batch{ 1 };
+
+        /**
+         *  The maximum number of live connections for the whole
+         *  server. When the limit is reached, the listeners stop
+         *  accepting, leaving new connections in the backlog of
+         *  the kernel, until a connection closes. Set to zero
+         *  for no limit.
+         */
+        std::size_t max_connections{ 0 };
+
+        /**
+         *  The maximum number of live connections for a single
+         *  acceptor, which is every shard for a sharded listener.
+         *  Set to zero for no limit.
+         */
+        std::size_t max_listener_connections{ 0 };
+
+        /**
+         *  How to choose the executor for a new connection,
+         *  when a listener distributes its connections over
+         *  all the executors of the server
+         */
+        dispatch_policy dispatch{ dispatch_policy::round_robin };
+
+        /**
+         *  The maximum number of closed connections for which
+         *  the memory is kept for reuse, for every listener and
+         *  executor. Set to zero to disable recycling.
+         */
+        std::size_t pool_size{ 256 };
+
+        /**
+         *  The maximum capacity of a read buffer that is kept
+         *  for reuse by a new connection, larger buffers are
+         *  released when their connection closes
+         */
+        std::size_t pool_buffer_limit{ 16 * 1024 };
+
+        /**
+         *  The maximum body capacity that a connection keeps
+         *  between requests. Smaller bodies are cleared and
+         *  their storage is reused for the next request on
+         *  the connection, larger bodies are released.
+         */
+        std::size_t request_capacity_limit{ 64 * 1024 };
+
+        /**
+         *  The maximum number of requests in flight on a
+         *  connection. With a depth above one, pipelined
+         *  requests are read and routed while the earlier
+         *  responses are still being produced or written.
+         *  Every request in flight reserves response storage
+         *  on the connection.
+         */
+        std::size_t pipeline_depth{ 1 };
+
+        /**
+         *  The number of bytes after which no more responses
+         *  are added to a write. Responses that are ready are
+         *  gathered into a single write, to send the answers
+         *  to pipelined requests with fewer system calls.
+         */
+        std::size_t write_coalesce_limit{ 64 * 1024 };
+
+        /**
+         *  The maximum number of buffers in a single write. A
+         *  response takes several buffers for its header and
+         *  body, so a wider write can hold more responses, or
+         *  a response with a body in many pieces. The width
+         *  is limited to what the system allows (IOV_MAX).
+         */
+        std::size_t gather_width{ 64 };
+
+        /**
+         *  The time a client has to complete the TLS handshake
+         *  after the connection was accepted
+         */
+        std::chrono::milliseconds handshake_timeout{ std::chrono::seconds{ 10 } };
+
+        /**
+         *  The time a client has to send the header of the
+         *  first request on a connection, and of later
+         *  requests from the first byte that arrives
+         */
+        std::chrono::milliseconds header_timeout{ std::chrono::seconds{ 10 } };
+
+        /**
+         *  The time a client has to send the body of a request,
+         *  starting when the header has been received
+         */
+        std::chrono::milliseconds body_timeout{ std::chrono::seconds{ 30 } };
+
+        /**
+         *  The time a write may take before the client is
+         *  considered gone. The timeout starts again with
+         *  every write, so large responses to a slow client
+         *  are not cut off while they make progress.
+         */
+        std::chrono::milliseconds write_timeout{ std::chrono::seconds{ 30 } };
+
+        /**
+         *  The time a connection is kept open while waiting
+         *  for the first byte of the next request, after all
+         *  responses have been written
+         */
+        std::chrono::milliseconds idle_timeout{ std::chrono::seconds{ 60 } };
+    };
+
+}
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <boost/asio/detail/socket_option.hpp>
+#include <sys/socket.h>
+
+
+namespace tamed {
+
+    /**
+     *  Socket option to allow multiple sockets to bind
+     *  to the same address and port. The kernel then
+     *  distributes incoming connections between them.
+     */
+    using reuse_port = boost::asio::detail::socket_option::boolean<SOL_SOCKET, SO_REUSEPORT>;
+
+}
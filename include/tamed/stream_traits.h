@@ -3,6 +3,7 @@
 #include <type_traits>
 #include <boost/beast/ssl/ssl_stream.hpp>
 #include <boost/asio/basic_socket_acceptor.hpp>
+#include "kernel_tls_stream.h"
 
 
 namespace tamed {
@@ -32,12 +33,61 @@ namespace tamed {
         ))
     >> : std::true_type {};
 
+    /**
+     *  Fallback struct for a stream that transforms
+     *  the data before it reaches the socket
+     */
+    template <typename T, typename = void>
+    struct is_native_socket : std::false_type {};
+
+    /**
+     *  Structure matching on plain sockets, which
+     *  can be written to with system calls directly
+     */
+    template <typename T>
+    struct is_native_socket<T, std::void_t<
+        // wait for the socket to become writable
+        decltype(std::declval<T>().async_wait(
+            std::declval<boost::asio::socket_base::wait_type>(),
+            std::declval<void(*)(const boost::system::error_code&)>()
+        )),
+
+        // retrieve the file descriptor
+        std::enable_if_t<std::is_same_v<decltype(std::declval<T>().native_handle()), int>>
+    >> : std::true_type {};
+
     /**
      *  Value alias for the different traits
      */
     template <typename T>
     constexpr bool is_async_tls_stream_v = is_async_tls_stream<T>::value;
 
+    template <typename T>
+    constexpr bool is_native_socket_v = is_native_socket<T>::value;
+
+    /**
+     *  Fallback struct for a stream that never
+     *  lets the kernel do the encryption
+     */
+    template <typename T, typename = void>
+    struct is_kernel_tls_stream : std::false_type {};
+
+    /**
+     *  Structure matching on streams that may let the
+     *  kernel encrypt the data written to their socket
+     */
+    template <typename T>
+    struct is_kernel_tls_stream<T, std::void_t<
+        // is the data encrypted by the kernel
+        decltype(std::declval<const T&>().kernel_send()),
+
+        // retrieve the socket to write to
+        decltype(std::declval<T&>().next_layer())
+    >> : std::true_type {};
+
+    template <typename T>
+    constexpr bool is_kernel_tls_stream_v = is_kernel_tls_stream<T>::value;
+
     /**
      *  Forward-declare the stream deducer
      *  without implementation (cannot be used)
@@ -69,4 +119,17 @@ namespace tamed {
         using acceptor_type = boost::asio::basic_socket_acceptor<endpoint_type>;
     };
 
+    /**
+     *  Deduce traits for a tls endpoint
+     *  with kernel encryption
+     */
+    template <typename endpoint_type>
+    struct async_stream_traits<endpoint_type, boost::asio::ssl::context, kernel_tls_t>
+    {
+        using protocol_type = typename endpoint_type::protocol_type;
+        using socket_type   = typename protocol_type::socket;
+        using stream_type   = kernel_tls_stream<socket_type>;
+        using acceptor_type = boost::asio::basic_socket_acceptor<endpoint_type>;
+    };
+
 }
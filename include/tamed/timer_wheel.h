@@ -0,0 +1,420 @@
+#pragma once
+
+#include <boost/asio/any_io_executor.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+
+namespace tamed {
+
+    /**
+     *  A hierarchical wheel of timers
+     *
+     *  The wheel keeps its timers in lists per tick, so
+     *  arming and disarming a timer takes constant time,
+     *  no matter how many timers are armed. Timers far in
+     *  the future are kept in coarser levels, and move to
+     *  the finer levels as their expiry comes closer.
+     *
+     *  A single asio timer drives the wheel, and only runs
+     *  while there are timers armed. The wheel is not
+     *  synchronized, timers must be armed and disarmed on
+     *  the executor running the wheel.
+     */
+    class timer_wheel
+    {
+        public:
+            using clock_type    = std::chrono::steady_clock;
+            using duration      = std::chrono::milliseconds;
+
+            /**
+             *  A timer that can be armed on the wheel
+             *
+             *  The timer is meant to be embedded in the object
+             *  it belongs to, it is disarmed when destructed.
+             */
+            class entry
+            {
+                public:
+                    /**
+                     *  The callback to invoke on expiry
+                     */
+                    using callback_type = void(*)(void*) noexcept;
+
+                    /**
+                     *  Constructor
+                     *
+                     *  @param  callback    The callback to invoke when the timer expires
+                     *  @param  context     The pointer to pass to the callback
+                     */
+                    entry(callback_type callback, void* context) noexcept :
+                        _callback{ callback },
+                        _context{ context }
+                    {}
+
+                    /**
+                     *  The wheel refers to the entry,
+                     *  so it cannot be moved
+                     */
+                    entry(const entry&) = delete;
+                    entry(entry&&) = delete;
+
+                    /**
+                     *  Destructor
+                     */
+                    ~entry()
+                    {
+                        // remove the timer from the wheel it was armed on
+                        if (_wheel != nullptr) {
+                            _wheel->disarm(*this);
+                        }
+                    }
+
+                    /**
+                     *  Is the timer armed?
+                     *
+                     *  @return Whether the timer is waiting to expire
+                     */
+                    bool armed() const noexcept
+                    {
+                        return _next != nullptr;
+                    }
+                protected:
+                    /**
+                     *  Constructor for the head of a list
+                     */
+                    entry() noexcept :
+                        _previous{ this },
+                        _next{ this }
+                    {}
+                private:
+                    friend class timer_wheel;
+
+                    /**
+                     *  Add the entry to the end of a list
+                     *
+                     *  @param  head    The head of the list
+                     */
+                    void link(entry& head) noexcept
+                    {
+                        // insert the entry before the head
+                        _previous           = head._previous;
+                        _next               = &head;
+                        _previous->_next    = this;
+                        head._previous      = this;
+                    }
+
+                    /**
+                     *  Remove the entry from its list
+                     */
+                    void unlink() noexcept
+                    {
+                        // connect our neighbours to each other
+                        _previous->_next = _next;
+                        _next->_previous = _previous;
+
+                        // we are no longer in a list
+                        _previous   = nullptr;
+                        _next       = nullptr;
+                    }
+
+                    entry*          _previous{ nullptr };   // the previous entry in the list
+                    entry*          _next{ nullptr };       // the next entry in the list, or a nullptr if not armed
+                    timer_wheel*    _wheel{ nullptr };      // the wheel the entry was armed on
+                    std::uint64_t   _expiry{ 0 };           // the tick on which the timer expires
+                    callback_type   _callback{ nullptr };   // the callback to invoke on expiry
+                    void*           _context{ nullptr };    // the pointer to pass to the callback
+            };
+
+            /**
+             *  Constructor
+             *
+             *  @param  executor    The executor to run the wheel on
+             *  @param  resolution  The duration of a single tick
+             */
+            timer_wheel(boost::asio::any_io_executor executor, duration resolution = default_resolution) :
+                _timer{ executor },
+                _resolution{ resolution },
+                _start{ clock_type::now() }
+            {}
+
+            /**
+             *  The timer refers to the wheel,
+             *  so it cannot be moved
+             */
+            timer_wheel(const timer_wheel&) = delete;
+            timer_wheel(timer_wheel&&) = delete;
+
+            /**
+             *  Destructor
+             *
+             *  Timers may outlive the wheel, when their owners are
+             *  destroyed after the server, so they are disarmed
+             */
+            ~timer_wheel()
+            {
+                // disarm the timers in every slot of every level
+                for (auto& level : _slots) {
+                    for (auto& head : level) {
+                        // remove the timers from the list
+                        while (head._next != &head) {
+                            // the timer no longer refers to the wheel
+                            auto* timer = head._next;
+                            timer->unlink();
+                            timer->_wheel = nullptr;
+                        }
+                    }
+                }
+            }
+
+            /**
+             *  Arm a timer, an armed timer is moved
+             *  to its new expiry
+             *
+             *  @param  timer   The timer to arm
+             *  @param  timeout The time after which the timer expires
+             */
+            void arm(entry& timer, duration timeout) noexcept
+            {
+                // remove the timer from its current list
+                if (timer.armed()) {
+                    disarm(timer);
+                }
+
+                // the tick we are at now
+                auto now = current();
+
+                // is the wheel standing still?
+                if (_armed == 0 && !_running) {
+                    // then all lists are empty, and we can skip ahead
+                    _now = now;
+                }
+
+                // round the timeout up to whole ticks, and
+                // make sure the timer expires in the future
+                auto ticks = static_cast<std::uint64_t>((timeout + _resolution - duration{ 1 }) / _resolution);
+                timer._expiry = std::max(now + ticks, _now + 1);
+                timer._wheel  = this;
+
+                // add the timer to the wheel
+                insert(timer);
+                ++_armed;
+
+                // make sure the wheel is turning
+                schedule();
+            }
+
+            /**
+             *  Disarm a timer
+             *
+             *  @param  timer   The timer to disarm
+             */
+            void disarm(entry& timer) noexcept
+            {
+                // nothing to do if the timer is not armed
+                if (!timer.armed()) {
+                    return;
+                }
+
+                // remove the timer from the wheel
+                timer.unlink();
+                --_armed;
+            }
+
+            /**
+             *  Retrieve the number of armed timers
+             *
+             *  @return The number of timers waiting to expire
+             */
+            std::size_t size() const noexcept
+            {
+                return _armed;
+            }
+
+            /**
+             *  The default duration of a tick
+             */
+            constexpr static duration default_resolution{ 100 };
+        private:
+            /**
+             *  The wheel has a number of levels, each
+             *  with a list of timers for every slot
+             */
+            constexpr const static std::size_t level_bits   = 6;
+            constexpr const static std::size_t level_size   = std::size_t{ 1 } << level_bits;
+            constexpr const static std::size_t level_count  = 4;
+
+            /**
+             *  The furthest a timer can be in the future,
+             *  later timers are moved to the last tick
+             */
+            constexpr const static std::uint64_t max_ticks = (std::uint64_t{ 1 } << (level_bits * level_count)) - 1;
+
+            /**
+             *  The head of a list of timers
+             */
+            class list : public entry
+            {
+                public:
+                    /**
+                     *  Constructor
+                     */
+                    list() noexcept = default;
+            };
+
+            /**
+             *  Retrieve the current tick
+             *
+             *  @return The number of ticks since the wheel was created
+             */
+            std::uint64_t current() const noexcept
+            {
+                return static_cast<std::uint64_t>((clock_type::now() - _start) / _resolution);
+            }
+
+            /**
+             *  Add a timer to the list for its expiry
+             *
+             *  @param  timer   The timer to add
+             */
+            void insert(entry& timer) noexcept
+            {
+                // limit the expiry to what the wheel can hold
+                auto expiry = std::min(timer._expiry, _now + max_ticks);
+                auto delta  = expiry > _now ? expiry - _now : 0;
+
+                // find the level where the timer is less
+                // than a full turn away from its expiry
+                std::size_t level{ 0 };
+                while (level + 1 < level_count && delta >= (std::uint64_t{ 1 } << (level_bits * (level + 1)))) {
+                    ++level;
+                }
+
+                // timers that are due go into the slot being processed
+                if (delta == 0) {
+                    expiry = _now;
+                }
+
+                // add the timer to the slot for its expiry
+                timer.link(_slots[level][(expiry >> (level_bits * level)) & (level_size - 1)]);
+            }
+
+            /**
+             *  Make sure the timer fires on the next tick,
+             *  if there are any timers on the wheel
+             */
+            void schedule() noexcept
+            {
+                // is the wheel already turning, or are there no timers?
+                if (_running || _armed == 0) {
+                    return;
+                }
+
+                // wait for the next tick
+                _running = true;
+                _timer.expires_at(_start + _resolution * (_now + 1));
+                _timer.async_wait([this](const boost::system::error_code& ec) {
+                    // the wheel was destroyed
+                    if (ec == boost::asio::error::operation_aborted) {
+                        return;
+                    }
+
+                    // process the ticks that have passed
+                    _running = false;
+                    advance(current());
+
+                    // and wait for the next one
+                    schedule();
+                });
+            }
+
+            /**
+             *  Process all ticks up to the given one
+             *
+             *  @param  tick    The tick to advance to
+             */
+            void advance(std::uint64_t tick) noexcept
+            {
+                // process the ticks one by one, stopping
+                // early when there are no timers left
+                while (_now < tick && _armed != 0) {
+                    // move to the next tick
+                    ++_now;
+
+                    // move the timers from coarser levels when
+                    // the finer level has made a full turn
+                    for (std::size_t level{ 1 }; level < level_count && (_now & ((std::uint64_t{ 1 } << (level_bits * level)) - 1)) == 0; ++level) {
+                        // move the timers out of the slot
+                        list pending;
+                        splice(_slots[level][(_now >> (level_bits * level)) & (level_size - 1)], pending);
+
+                        // and put them back at their place
+                        while (pending._next != &pending) {
+                            // remove the timer, and insert it again
+                            auto* timer = pending._next;
+                            timer->unlink();
+                            insert(*timer);
+                        }
+                    }
+
+                    // move the timers that expire out of the wheel, so
+                    // callbacks can arm and disarm timers while we run
+                    list expired;
+                    splice(_slots[0][_now & (level_size - 1)], expired);
+
+                    // invoke the callbacks for the expired timers
+                    while (expired._next != &expired) {
+                        // the timer is no longer armed
+                        auto* timer = expired._next;
+                        timer->unlink();
+                        --_armed;
+
+                        // let the owner know
+                        timer->_callback(timer->_context);
+                    }
+                }
+
+                // we have caught up with the clock
+                _now = std::max(_now, tick);
+            }
+
+            /**
+             *  Move all entries from one list to another
+             *
+             *  @param  source  The list to take the entries from
+             *  @param  target  The empty list to move them to
+             */
+            static void splice(entry& source, entry& target) noexcept
+            {
+                // is there anything to move?
+                if (source._next == &source) {
+                    return;
+                }
+
+                // the target takes over the entries
+                target._next                = source._next;
+                target._previous            = source._previous;
+                target._next->_previous     = &target;
+                target._previous->_next     = &target;
+
+                // and the source is empty
+                source._next                = &source;
+                source._previous            = &source;
+            }
+
+            using level_type = std::array<list, level_size>;
+
+            boost::asio::steady_timer               _timer;                 // the timer to drive the wheel
+            duration                                _resolution;            // the duration of a single tick
+            clock_type::time_point                  _start;                 // the time of the first tick
+            std::uint64_t                           _now{ 0 };              // the last tick that was processed
+            std::size_t                             _armed{ 0 };            // the number of armed timers
+            bool                                    _running{ false };      // is the timer waiting for a tick
+            std::array<level_type, level_count>     _slots;                 // the lists of timers, for every level and slot
+    };
+
+}
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "connection_data.h"
+#include "recycling_allocator.h"
 
 
 namespace tamed {
@@ -8,14 +9,21 @@ namespace tamed {
     /**
      *  Read an incoming request
      */
-    template <class router_type, class body_type, typename stream_type, typename executor_type>
+    template <class router_type, class request_type, typename stream_type, typename executor_type, typename logger_type, typename tracer_type>
     class write_operation
     {
         public:
             /**
              *  The connection data type
              */
-            using data_type = connection_data_impl<router_type, body_type, stream_type, executor_type>;
+            using data_type = connection_data_impl<router_type, request_type, stream_type, executor_type, logger_type, tracer_type>;
+
+            /**
+             *  The allocator for memory used by the operation, like
+             *  the completion of the write, which is recycled between
+             *  responses
+             */
+            using allocator_type = recycling_allocator<void>;
 
             /**
              *  Constructor
@@ -37,24 +45,32 @@ namespace tamed {
             }
 
             /**
-             *  Handle the completion of reading the request
+             *  Retrieve the allocator
+             *
+             *  @return The allocator for memory used by the operation
+             */
+            allocator_type get_allocator() const noexcept
+            {
+                return {};
+            }
+
+            /**
+             *  Handle the completion of writing the responses
              *
-             *  @param  ec      The error code from the operation
+             *  @param  ec          The error code from the operation
+             *  @param  transferred The number of bytes that were transferred
              */
-            void operator()(const boost::system::error_code& ec) noexcept
+            void operator()(const boost::system::error_code& ec, std::size_t transferred) noexcept
             {
                 // did an error occur?
                 if (ec != boost::system::error_code{}) {
                     // log the error and abort
-                    std::cerr << "Error occurred during request reading: " << ec.message() << std::endl;
-                    return;
+                    logger_type::log(log_level::info, "Error occurred during response writing: ", ec);
+                    return _data->abort();
                 }
 
-                // do we need to continue reading
-                if (!_data->close) {
-                    // read the next request
-                    _data->read_request();
-                }
+                // continue with the next response and request
+                _data->response_written(transferred);
             }
         private:
             std::shared_ptr<data_type>  _data;  // the connection data
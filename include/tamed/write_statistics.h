@@ -0,0 +1,90 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+
+namespace tamed {
+
+    /**
+     *  Statistics on the writes performed for the
+     *  responses on the connections of an executor
+     */
+    class write_statistics
+    {
+        public:
+            /**
+             *  Constructor
+             */
+            write_statistics() noexcept = default;
+
+            /**
+             *  Copy constructor
+             *
+             *  @param  that    The statistics to copy
+             */
+            write_statistics(const write_statistics& that) noexcept
+            {
+                // add all the counters
+                *this += that;
+            }
+
+            /**
+             *  Record a write
+             *
+             *  @param  capped  Whether the gather width prevented more data from being added
+             */
+            void record(bool capped) noexcept
+            {
+                // update the counters, they are only written
+                // from the executor running the connections
+                _writes.fetch_add(1, std::memory_order_relaxed);
+
+                // did the write leave data behind for lack of buffers?
+                if (capped) {
+                    // the data will take another write
+                    _capped.fetch_add(1, std::memory_order_relaxed);
+                }
+            }
+
+            /**
+             *  Add the counters from other statistics
+             *
+             *  @param  that    The statistics to add
+             *  @return Same object for chaining
+             */
+            write_statistics& operator+=(const write_statistics& that) noexcept
+            {
+                // add the counters
+                _writes.fetch_add(that.writes(), std::memory_order_relaxed);
+                _capped.fetch_add(that.capped_writes(), std::memory_order_relaxed);
+                return *this;
+            }
+
+            /**
+             *  Retrieve the total number of writes
+             *
+             *  @return The number of writes started for responses
+             */
+            std::uint64_t writes() const noexcept
+            {
+                return _writes.load(std::memory_order_relaxed);
+            }
+
+            /**
+             *  Retrieve the number of writes that were cut short
+             *  by the gather width. Every one of them causes an
+             *  extra write for the data that did not fit.
+             *
+             *  @return The number of writes that hit the gather width
+             */
+            std::uint64_t capped_writes() const noexcept
+            {
+                return _capped.load(std::memory_order_relaxed);
+            }
+        private:
+            std::atomic<std::uint64_t>  _writes { 0 };  // the total number of writes
+            std::atomic<std::uint64_t>  _capped { 0 };  // the writes limited by the gather width
+    };
+
+}
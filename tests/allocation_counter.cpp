@@ -0,0 +1,226 @@
+#include "allocation_counter.h"
+#include <cstdlib>
+#include <new>
+
+
+namespace tamed::testing {
+
+    namespace {
+
+        /**
+         *  The counting state of a thread
+         */
+        struct counter_state
+        {
+            allocation_counter::counts_type counts{};           // the allocations in every phase
+            phase                           current{};          // the phase allocations are attributed to
+            bool                            enabled{ false };   // are allocations counted
+        };
+
+        /**
+         *  Retrieve the state for the current thread
+         *
+         *  @return The counting state
+         */
+        counter_state& state() noexcept
+        {
+            // the state is plain data, so it does not allocate itself
+            thread_local counter_state instance;
+            return instance;
+        }
+
+        /**
+         *  Allocate memory, counting the allocation
+         *
+         *  @param  size        The number of bytes to allocate
+         *  @param  alignment   The alignment of the memory
+         *  @return The allocated memory, or a nullptr on failure
+         */
+        void* allocate(std::size_t size, std::size_t alignment) noexcept
+        {
+            // count the allocation
+            allocation_counter::record();
+
+            // allocations of zero bytes must still be unique
+            size = size == 0 ? 1 : size;
+
+            // use the stricter alignment only when asked for
+            if (alignment <= alignof(std::max_align_t)) {
+                return std::malloc(size);
+            }
+
+            // the size must be a multiple of the alignment
+            return std::aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment);
+        }
+
+        /**
+         *  Allocate memory, throwing on failure
+         *
+         *  @param  size        The number of bytes to allocate
+         *  @param  alignment   The alignment of the memory
+         *  @return The allocated memory
+         *  @throws std::bad_alloc
+         */
+        void* allocate_or_throw(std::size_t size, std::size_t alignment)
+        {
+            // try to allocate the memory
+            if (auto* result = allocate(size, alignment); result != nullptr) {
+                return result;
+            }
+
+            throw std::bad_alloc{};
+        }
+
+    }
+
+    /**
+     *  Retrieve the name of a phase
+     *
+     *  @param  value   The phase to name
+     *  @return The name of the phase
+     */
+    const char* to_string(phase value) noexcept
+    {
+        switch (value) {
+            case phase::accept:     return "accept";
+            case phase::read:       return "read";
+            case phase::route:      return "route";
+            case phase::handler:    return "handler";
+            case phase::serialize:  return "serialize";
+            case phase::write:      return "write";
+        }
+
+        return "unknown";
+    }
+
+    /**
+     *  Start counting on the current thread,
+     *  forgetting the earlier counts
+     *
+     *  @param  initial The phase to attribute allocations to until the next phase is entered
+     */
+    void allocation_counter::start(phase initial) noexcept
+    {
+        state().counts  = {};
+        state().current = initial;
+        state().enabled = true;
+    }
+
+    /**
+     *  Stop counting on the current thread
+     */
+    void allocation_counter::stop() noexcept
+    {
+        state().enabled = false;
+    }
+
+    /**
+     *  Move to the next phase
+     *
+     *  @param  next    The phase to attribute allocations to
+     */
+    void allocation_counter::enter(phase next) noexcept
+    {
+        state().current = next;
+    }
+
+    /**
+     *  Count an allocation, if counting on the current thread
+     */
+    void allocation_counter::record() noexcept
+    {
+        // are we counting at all?
+        if (auto& current = state(); current.enabled) {
+            ++current.counts[static_cast<std::size_t>(current.current)];
+        }
+    }
+
+    /**
+     *  Retrieve the allocations counted on the current thread
+     *
+     *  @return The number of allocations for every phase
+     */
+    const allocation_counter::counts_type& allocation_counter::counts() noexcept
+    {
+        return state().counts;
+    }
+
+    /**
+     *  Retrieve the total number of allocations
+     *
+     *  @return The number of allocations in all phases
+     */
+    std::size_t allocation_counter::total() noexcept
+    {
+        // the number of allocations so far
+        std::size_t result{ 0 };
+
+        // add up all the phases
+        for (auto count : counts()) {
+            result += count;
+        }
+
+        return result;
+    }
+
+    /**
+     *  Handle a stage being reached
+     *
+     *  @param  stage   The stage of the timeline that was reached
+     */
+    void phase_tracer::on_stage(request_timeline::time_point request_timeline::* stage) noexcept
+    {
+        // the handler is running until it returns
+        if (stage == &request_timeline::handler_entered) {
+            return allocation_counter::enter(phase::handler);
+        }
+
+        // the parsed request is routed, and the connection
+        // continues with its bookkeeping after the handler
+        if (stage == &request_timeline::body_complete || stage == &request_timeline::handler_returned) {
+            return allocation_counter::enter(phase::route);
+        }
+
+        // the response is stored and serialized
+        if (stage == &request_timeline::response_ready) {
+            return allocation_counter::enter(phase::serialize);
+        }
+
+        // the response data is written
+        if (stage == &request_timeline::first_write || stage == &request_timeline::last_write) {
+            return allocation_counter::enter(phase::write);
+        }
+
+        // the next request is being read
+        if (stage == &request_timeline::first_byte || stage == &request_timeline::header_parsed) {
+            return allocation_counter::enter(phase::read);
+        }
+    }
+
+}
+
+/**
+ *  Replace the global allocation functions, so
+ *  that every allocation can be counted
+ */
+void* operator new(std::size_t size)                                                            { return tamed::testing::allocate_or_throw(size, alignof(std::max_align_t)); }
+void* operator new[](std::size_t size)                                                          { return tamed::testing::allocate_or_throw(size, alignof(std::max_align_t)); }
+void* operator new(std::size_t size, std::align_val_t alignment)                                { return tamed::testing::allocate_or_throw(size, static_cast<std::size_t>(alignment)); }
+void* operator new[](std::size_t size, std::align_val_t alignment)                              { return tamed::testing::allocate_or_throw(size, static_cast<std::size_t>(alignment)); }
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept                            { return tamed::testing::allocate(size, alignof(std::max_align_t)); }
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept                          { return tamed::testing::allocate(size, alignof(std::max_align_t)); }
+void* operator new(std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept    { return tamed::testing::allocate(size, static_cast<std::size_t>(alignment)); }
+void* operator new[](std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept  { return tamed::testing::allocate(size, static_cast<std::size_t>(alignment)); }
+
+void operator delete(void* pointer) noexcept                                                    { std::free(pointer); }
+void operator delete[](void* pointer) noexcept                                                  { std::free(pointer); }
+void operator delete(void* pointer, std::size_t) noexcept                                       { std::free(pointer); }
+void operator delete[](void* pointer, std::size_t) noexcept                                     { std::free(pointer); }
+void operator delete(void* pointer, std::align_val_t) noexcept                                  { std::free(pointer); }
+void operator delete[](void* pointer, std::align_val_t) noexcept                                { std::free(pointer); }
+void operator delete(void* pointer, std::size_t, std::align_val_t) noexcept                     { std::free(pointer); }
+void operator delete[](void* pointer, std::size_t, std::align_val_t) noexcept                   { std::free(pointer); }
+void operator delete(void* pointer, const std::nothrow_t&) noexcept                             { std::free(pointer); }
+void operator delete[](void* pointer, const std::nothrow_t&) noexcept                           { std::free(pointer); }
+void operator delete(void* pointer, std::align_val_t, const std::nothrow_t&) noexcept           { std::free(pointer); }
+void operator delete[](void* pointer, std::align_val_t, const std::nothrow_t&) noexcept         { std::free(pointer); }
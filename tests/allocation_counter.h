@@ -0,0 +1,109 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <tamed/request_tracer.h>
+
+
+namespace tamed::testing {
+
+    /**
+     *  The phases of handling a request that
+     *  allocations are attributed to
+     */
+    enum class phase : std::size_t
+    {
+        accept,         // creating and starting the connection
+        read,           // reading and parsing the request
+        route,          // finding the handler, and the bookkeeping around it
+        handler,        // running the handler
+        serialize,      // storing and serializing the response
+        write,          // writing the response, and processing the completion
+    };
+
+    /**
+     *  The number of phases
+     */
+    constexpr const std::size_t phase_count = static_cast<std::size_t>(phase::write) + 1;
+
+    /**
+     *  Retrieve the name of a phase
+     *
+     *  @param  value   The phase to name
+     *  @return The name of the phase
+     */
+    const char* to_string(phase value) noexcept;
+
+    /**
+     *  Counts the allocations made through the global
+     *  operator new on the current thread, by the phase
+     *  the thread was in when allocating
+     *
+     *  Counting only happens between start() and stop(),
+     *  so the test framework itself is left out.
+     */
+    class allocation_counter
+    {
+        public:
+            using counts_type = std::array<std::size_t, phase_count>;
+
+            /**
+             *  Start counting on the current thread,
+             *  forgetting the earlier counts
+             *
+             *  @param  initial The phase to attribute allocations to until the next phase is entered
+             */
+            static void start(phase initial = phase::accept) noexcept;
+
+            /**
+             *  Stop counting on the current thread
+             */
+            static void stop() noexcept;
+
+            /**
+             *  Move to the next phase
+             *
+             *  @param  next    The phase to attribute allocations to
+             */
+            static void enter(phase next) noexcept;
+
+            /**
+             *  Count an allocation, if counting on the current thread
+             */
+            static void record() noexcept;
+
+            /**
+             *  Retrieve the allocations counted on the current thread
+             *
+             *  @return The number of allocations for every phase
+             */
+            static const counts_type& counts() noexcept;
+
+            /**
+             *  Retrieve the total number of allocations
+             *
+             *  @return The number of allocations in all phases
+             */
+            static std::size_t total() noexcept;
+    };
+
+    /**
+     *  Tracer that moves the allocation counter to
+     *  the phase belonging to every stage reached
+     */
+    struct phase_tracer
+    {
+        /**
+         *  Handle a stage being reached
+         *
+         *  @param  stage   The stage of the timeline that was reached
+         */
+        static void on_stage(request_timeline::time_point request_timeline::* stage) noexcept;
+
+        /**
+         *  Handle a request that was answered
+         */
+        static void on_request(const request_timeline&) noexcept {}
+    };
+
+}
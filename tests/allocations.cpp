@@ -0,0 +1,247 @@
+#include <iostream>
+
+#include "catch2.hpp"
+#include "allocation_counter.h"
+#include "memory_stream.h"
+
+
+namespace {
+
+    using tamed::testing::allocation_counter;
+    using tamed::testing::phase;
+
+    /**
+     *  Servers that report the phases of every
+     *  request to the allocation counter
+     */
+    using counted_config    = tamed::rest_config::with_tracer_type<tamed::testing::phase_tracer>;
+    using pooled_config     = counted_config::with_fields_type<tamed::recycling_fields>;
+
+    /**
+     *  The request sent over and over
+     */
+    constexpr const char* keep_alive_get = "GET / HTTP/1.1\r\nHost: test\r\n\r\n";
+
+    /**
+     *  A request with a body, sent over and over
+     *
+     *  @return The request to send
+     */
+    std::string keep_alive_post()
+    {
+        return std::string{ "POST / HTTP/1.1\r\nHost: test\r\nContent-Length: 4096\r\n\r\n" }.append(4096, 'x');
+    }
+
+    /**
+     *  Answer with a response that was serialized up front
+     */
+    template <typename request_type>
+    void handle_serialized(tamed::connection connection, request_type&&)
+    {
+        connection.send(std::string_view{ "HTTP/1.1 200 OK\r\nContent-Length: 13\r\n\r\nHello, world!" });
+    }
+
+    /**
+     *  Answer with a response message
+     */
+    template <typename request_type>
+    void handle_message(tamed::connection connection, request_type&& request)
+    {
+        boost::beast::http::response<boost::beast::http::string_body>   response{ boost::beast::http::status::ok, request.version() };
+
+        response.body().assign("Hello, world!");
+        connection.send(std::move(response));
+    }
+
+    /**
+     *  Send requests over a warm server, counting the
+     *  allocations made by the connection
+     *
+     *  @param  server      The server to send the requests to
+     *  @param  requests    The number of requests to send
+     *  @param  request     The request to send
+     *  @return The number of allocations in every phase
+     */
+    template <typename server_type>
+    allocation_counter::counts_type count(server_type& server, std::size_t requests, const std::string& request = keep_alive_get)
+    {
+        // warm up the pools and caches
+        server.run(request, requests);
+
+        // the stream is created by the test, not the connection
+        auto stream = server.make_stream(request, requests);
+
+        // count the allocations of a single connection
+        allocation_counter::start();
+        server.run(std::move(stream));
+        allocation_counter::stop();
+
+        return allocation_counter::counts();
+    }
+
+    /**
+     *  Describe the allocations of every phase
+     *
+     *  @param  counts  The number of allocations in every phase
+     *  @return The description, for failing tests
+     */
+    std::string describe(const allocation_counter::counts_type& counts)
+    {
+        std::string result;
+
+        for (std::size_t index{ 0 }; index < counts.size(); ++index) {
+            result.append(tamed::testing::to_string(static_cast<phase>(index))).append("=").append(std::to_string(counts[index])).append(" ");
+        }
+
+        return result;
+    }
+
+}
+
+TEST_CASE("keep-alive requests with pooled storage do not allocate once warm")
+{
+    tamed::testing::memory_server<pooled_config> server;
+
+    server.get_router().add<handle_serialized<decltype(server)::request_type>>(boost::beast::http::verb::get, "/");
+
+    SECTION("with one request in flight") {
+        auto counts = count(server, 1000);
+
+        INFO(describe(counts));
+        REQUIRE(allocation_counter::total() == 0);
+    }
+
+    SECTION("with pipelined requests") {
+        server.get_settings().pipeline_depth = 16;
+
+        auto counts = count(server, 1000);
+
+        INFO(describe(counts));
+
+        // the response slots for a deep pipeline are larger than
+        // the recycled blocks, which costs the connection one
+        // allocation, but the requests must not allocate at all
+        REQUIRE(counts[static_cast<std::size_t>(phase::accept)] <= 1);
+        REQUIRE(allocation_counter::total() == counts[static_cast<std::size_t>(phase::accept)]);
+    }
+}
+
+TEST_CASE("request bodies keep their storage across keep-alive requests")
+{
+    tamed::testing::memory_server<pooled_config> server;
+
+    server.get_router().add<handle_serialized<decltype(server)::request_type>>(boost::beast::http::verb::post, "/");
+
+    SECTION("within the capacity limit") {
+        auto counts = count(server, 1000, keep_alive_post());
+
+        INFO(describe(counts));
+
+        // the first body of the connection allocates its
+        // storage, the other requests read into it as well
+        REQUIRE(counts[static_cast<std::size_t>(phase::read)] == 1);
+        REQUIRE(allocation_counter::total() == 1);
+    }
+
+    SECTION("without keeping any capacity") {
+        server.get_settings().request_capacity_limit = 0;
+
+        auto counts = count(server, 1000, keep_alive_post());
+
+        INFO(describe(counts));
+
+        // every body is read into new storage
+        REQUIRE(counts[static_cast<std::size_t>(phase::read)] >= 1000);
+    }
+}
+
+TEST_CASE("recycled fields remove the allocations of the default fields")
+{
+    tamed::testing::memory_server<counted_config>   plain;
+    tamed::testing::memory_server<pooled_config>    pooled;
+
+    plain.get_router().add<handle_serialized<decltype(plain)::request_type>>(boost::beast::http::verb::get, "/");
+    pooled.get_router().add<handle_serialized<decltype(pooled)::request_type>>(boost::beast::http::verb::get, "/");
+
+    auto before = count(plain, 1000)[static_cast<std::size_t>(phase::read)];
+    auto after  = count(pooled, 1000)[static_cast<std::size_t>(phase::read)];
+
+    INFO("default fields: " << before << ", recycled fields: " << after);
+    REQUIRE(before >= 1000);
+    REQUIRE(after == 0);
+}
+
+TEST_CASE("response messages only allocate their fields")
+{
+    tamed::testing::memory_server<pooled_config> server;
+
+    server.get_router().add<handle_message<decltype(server)::request_type>>(boost::beast::http::verb::get, "/");
+
+    auto counts = count(server, 1000);
+
+    INFO(describe(counts));
+
+    // preparing the payload adds the content length to the fields,
+    // which use the default allocator, the serializer for the message
+    // fits in the response slot and the rest of the connection must
+    // be allocation free
+    REQUIRE(counts[static_cast<std::size_t>(phase::serialize)] == 1000);
+    REQUIRE(allocation_counter::total() == counts[static_cast<std::size_t>(phase::serialize)]);
+}
+
+TEST_CASE("requests with default fields only allocate while reading")
+{
+    tamed::testing::memory_server<counted_config> server;
+
+    server.get_router().add<handle_serialized<decltype(server)::request_type>>(boost::beast::http::verb::get, "/");
+
+    auto counts = count(server, 1000);
+
+    INFO(describe(counts));
+
+    // parsing allocates the target and the host field of every
+    // request, but routing, answering and writing must not
+    // allocate anything
+    REQUIRE(counts[static_cast<std::size_t>(phase::read)] == 2 * 1000);
+    REQUIRE(allocation_counter::total() == counts[static_cast<std::size_t>(phase::read)]);
+}
+
+TEST_CASE("short-lived connections reuse the storage of closed connections")
+{
+    SECTION("with a connection pool") {
+        tamed::testing::memory_server<pooled_config> server;
+
+        server.get_router().add<handle_serialized<decltype(server)::request_type>>(boost::beast::http::verb::get, "/");
+
+        auto counts = count(server, 1);
+
+        INFO(describe(counts));
+        REQUIRE(allocation_counter::total() == 0);
+    }
+
+    SECTION("without a connection pool") {
+        tamed::settings options;
+        options.pool_size = 0;
+
+        tamed::testing::memory_server<pooled_config> server{ options };
+
+        server.get_router().add<handle_serialized<decltype(server)::request_type>>(boost::beast::http::verb::get, "/");
+
+        auto counts = count(server, 1);
+
+        INFO(describe(counts));
+
+        // the connection and its read buffer are allocated again
+        REQUIRE(allocation_counter::total() == 2);
+    }
+}
+
+TEST_CASE("unrouted requests do not allocate once warm")
+{
+    tamed::testing::memory_server<pooled_config> server;
+
+    auto counts = count(server, 1000);
+
+    INFO(describe(counts));
+    REQUIRE(allocation_counter::total() == 0);
+}
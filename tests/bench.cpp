@@ -0,0 +1,187 @@
+#include <iostream>
+
+#include <chrono>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include "allocation_counter.h"
+#include "memory_stream.h"
+
+
+namespace {
+
+    /**
+     *  The outcome of a single benchmark
+     */
+    struct result
+    {
+        std::string     name;           // the name of the benchmark
+        std::size_t     requests;       // the number of requests handled
+        std::size_t     received;       // the number of bytes in the requests
+        std::size_t     sent;           // the number of bytes in the responses
+        double          seconds;        // the time it took to handle the requests
+        std::size_t     allocations;    // the number of allocations made while handling the requests
+    };
+
+    /**
+     *  Answer a request with a short message
+     */
+    template <typename request_type>
+    void handle_hello(tamed::connection connection, request_type&& request)
+    {
+        boost::beast::http::response<boost::beast::http::string_body>   response{ boost::beast::http::status::ok, request.version() };
+
+        response.body().assign("Hello, world!");
+        connection.send(std::move(response));
+    }
+
+    /**
+     *  Answer a request with the size of its body
+     */
+    template <typename request_type>
+    void handle_upload(tamed::connection connection, request_type&& request)
+    {
+        boost::beast::http::response<boost::beast::http::string_body>   response{ boost::beast::http::status::created, request.version() };
+
+        response.body().assign(std::to_string(request.body().size()));
+        connection.send(std::move(response));
+    }
+
+    /**
+     *  Create a request with a body
+     *
+     *  @param  method  The method of the request
+     *  @param  target  The target of the request
+     *  @param  size    The size of the body
+     *  @return The serialized request
+     */
+    std::string make_request(boost::beast::string_view method, boost::beast::string_view target, std::size_t size = 0)
+    {
+        // the request line and the common fields
+        std::string request{ method.data(), method.size() };
+        request.append(" ").append(target.data(), target.size()).append(" HTTP/1.1\r\nHost: bench\r\nUser-Agent: tamed-bench\r\n");
+
+        // add the body, if there is one
+        if (size != 0) {
+            request.append("Content-Length: ").append(std::to_string(size)).append("\r\n\r\n").append(size, 'x');
+        } else {
+            request.append("\r\n");
+        }
+
+        return request;
+    }
+
+    /**
+     *  Run a benchmark on a single keep-alive connection
+     *
+     *  A tenth of the requests is sent over a separate
+     *  connection first, so the pools are warm.
+     *
+     *  @param  server      The server to send the requests to
+     *  @param  name        The name of the benchmark
+     *  @param  request     The requests to send, one after the other
+     *  @param  requests    The number of requests to send
+     *  @return The outcome of the benchmark
+     */
+    template <typename server_type>
+    result measure(server_type& server, std::string name, std::string request, std::size_t requests)
+    {
+        // warm up the pools and caches
+        server.run(request, std::max<std::size_t>(requests / 10, 1));
+
+        // the stream is created before counting
+        auto stream = server.make_stream(request, requests);
+
+        // now time the requests, and count the allocations
+        tamed::testing::allocation_counter::start();
+        auto start  = std::chrono::steady_clock::now();
+        auto sent   = server.run(std::move(stream));
+        auto end    = std::chrono::steady_clock::now();
+        tamed::testing::allocation_counter::stop();
+
+        return { std::move(name), requests, request.size() * requests, sent, std::chrono::duration<double>(end - start).count(), tamed::testing::allocation_counter::total() };
+    }
+
+    /**
+     *  Write the outcome of the benchmarks as JSON
+     *
+     *  @param  results The outcome of the benchmarks
+     */
+    void report(const std::vector<result>& results)
+    {
+        std::cout << "{\n    \"benchmarks\": [";
+
+        // write every benchmark, separated by commas
+        for (std::size_t index{ 0 }; index < results.size(); ++index) {
+            const auto& entry = results[index];
+
+            std::cout << (index == 0 ? "\n" : ",\n")
+                << "        {\n"
+                << "            \"name\": \"" << entry.name << "\",\n"
+                << "            \"requests\": " << entry.requests << ",\n"
+                << "            \"request_bytes\": " << entry.received << ",\n"
+                << "            \"response_bytes\": " << entry.sent << ",\n"
+                << "            \"seconds\": " << entry.seconds << ",\n"
+                << "            \"requests_per_second\": " << entry.requests / entry.seconds << ",\n"
+                << "            \"ns_per_request\": " << entry.seconds * 1e9 / entry.requests << ",\n"
+                << "            \"allocations_per_request\": " << static_cast<double>(entry.allocations) / entry.requests << "\n"
+                << "        }";
+        }
+
+        std::cout << "\n    ]\n}" << std::endl;
+    }
+
+}
+
+
+int main(int argc, char** argv)
+{
+    using rest_server       = tamed::testing::memory_server<tamed::rest_config>;
+    using webdav_server     = tamed::testing::memory_server<tamed::webdav_config>;
+    using rest_request      = rest_server::request_type;
+    using webdav_request    = webdav_server::request_type;
+
+    // the number of small requests to send, larger requests are sent less often
+    std::size_t requests = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 100000;
+    std::vector<result> results;
+
+    // the benchmarks with the routes of a simple REST server
+    {
+        rest_server server;
+
+        server.get_router().add<handle_hello<rest_request>>(boost::beast::http::verb::get, "/");
+        server.get_router().add<handle_upload<rest_request>>(boost::beast::http::verb::post, "/upload");
+
+        results.push_back(measure(server, "get_small", make_request("GET", "/"), requests));
+        results.push_back(measure(server, "post_4k", make_request("POST", "/upload", 4 * 1024), requests / 4));
+        results.push_back(measure(server, "post_1m", make_request("POST", "/upload", 1024 * 1024), std::max<std::size_t>(requests / 1000, 10)));
+        results.push_back(measure(server, "not_found", make_request("GET", "/does/not/exist"), requests));
+    }
+
+    // a mix of the methods of a WebDAV server
+    {
+        webdav_server server;
+
+        // every method is sent to the same resource
+        for (auto method : tamed::webdav_config::methods) {
+            server.get_router().add<handle_hello<webdav_request>>(method, "/dav/resource");
+        }
+
+        // send every method in turn
+        std::string mix;
+        for (auto method : tamed::webdav_config::methods) {
+            mix.append(make_request(boost::beast::http::to_string(method), "/dav/resource", method == boost::beast::http::verb::put ? 64 : 0));
+        }
+
+        // the number of requests is rounded to whole mixes
+        auto rounds = std::max<std::size_t>(requests / tamed::webdav_config::methods.size(), 1);
+        auto outcome = measure(server, "webdav_mix", std::move(mix), rounds);
+
+        // report the single requests rather than the mixes
+        outcome.requests = rounds * tamed::webdav_config::methods.size();
+        results.push_back(std::move(outcome));
+    }
+
+    report(results);
+    return 0;
+}
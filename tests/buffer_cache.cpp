@@ -0,0 +1,59 @@
+#include "catch2.hpp"
+#include <tamed/buffer_cache.h>
+#include <string>
+
+
+namespace {
+
+    /**
+     *  A string taking its storage from a buffer cache
+     */
+    using cached_string = std::basic_string<char, std::char_traits<char>, tamed::buffer_cache_allocator<char>>;
+
+}
+
+TEST_CASE("released buffers are reused when they are large enough")
+{
+    auto cache = std::make_shared<tamed::buffer_cache>();
+
+    // the storage of the first string
+    const char* storage{ nullptr };
+
+    {
+        cached_string output{ tamed::buffer_cache_allocator<char>{ cache } };
+
+        output.reserve(4096);
+        storage = output.data();
+    }
+
+    SECTION("a buffer of the same size reuses the storage") {
+        cached_string output{ tamed::buffer_cache_allocator<char>{ cache } };
+
+        output.reserve(4096);
+        REQUIRE(output.data() == storage);
+    }
+
+    SECTION("a smaller buffer reuses the storage") {
+        cached_string output{ tamed::buffer_cache_allocator<char>{ cache } };
+
+        output.reserve(1024);
+        REQUIRE(output.data() == storage);
+    }
+
+    SECTION("a larger buffer cannot use the storage") {
+        cached_string output{ tamed::buffer_cache_allocator<char>{ cache } };
+
+        output.reserve(8192);
+        REQUIRE(output.data() != storage);
+    }
+
+    SECTION("the storage is handed out only once") {
+        cached_string first{ tamed::buffer_cache_allocator<char>{ cache } };
+        cached_string second{ tamed::buffer_cache_allocator<char>{ cache } };
+
+        first.reserve(4096);
+        second.reserve(4096);
+        REQUIRE(first.data() == storage);
+        REQUIRE(second.data() != storage);
+    }
+}
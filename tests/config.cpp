@@ -0,0 +1,90 @@
+#include <iostream>
+
+#include "catch2.hpp"
+#include "memory_stream.h"
+#include <tamed/server.h>
+
+
+namespace {
+
+    /**
+     *  Tracer that ignores the requests, but
+     *  makes the connections record them
+     */
+    struct ignoring_tracer
+    {
+        static void on_request(const tamed::request_timeline&) noexcept {}
+    };
+
+}
+
+
+TEST_CASE("a server can be created without any methods")
+{
+    boost::asio::io_context                     context;
+    tamed::server<tamed::config<>>              server{ context };
+
+    // there are no routes to add, but the server must exist
+    REQUIRE(tamed::config<>::methods.empty());
+}
+
+TEST_CASE("an enum map without keys finds nothing")
+{
+    using map_type  = tamed::enum_map<boost::beast::http::verb, int>;
+
+    map_type    map;
+
+    REQUIRE(map_type::size() == 0);
+    REQUIRE(map_type::index(boost::beast::http::verb::get) == map_type::npos);
+    REQUIRE(map.find(boost::beast::http::verb::get) == nullptr);
+    REQUIRE_THROWS_AS(map.at(boost::beast::http::verb::get), std::out_of_range);
+}
+
+TEST_CASE("an enum map finds its keys")
+{
+    using map_type  = tamed::enum_map<boost::beast::http::verb, int, boost::beast::http::verb::post, boost::beast::http::verb::get>;
+
+    map_type    map;
+
+    map[boost::beast::http::verb::get]  = 1;
+    map[boost::beast::http::verb::post] = 2;
+
+    REQUIRE(map_type::index(boost::beast::http::verb::post) == 0);
+    REQUIRE(map_type::index(boost::beast::http::verb::get) == 1);
+    REQUIRE(map_type::index(boost::beast::http::verb::put) == map_type::npos);
+    REQUIRE(map_type::index(static_cast<boost::beast::http::verb>(1000)) == map_type::npos);
+    REQUIRE(*map.find(boost::beast::http::verb::get) == 1);
+    REQUIRE(map.find(boost::beast::http::verb::put) == nullptr);
+}
+
+TEST_CASE("the config keeps its positional parameters")
+{
+    using boost::beast::http::verb;
+    using positional    = tamed::config<boost::beast::http::string_body, boost::asio::io_context::executor_type, verb::get, verb::post>;
+    using chained       = tamed::config<>::with_methods<verb::get, verb::post>;
+
+    // the methods still follow the body and the executor
+    STATIC_REQUIRE(std::is_same_v<positional, chained>);
+    STATIC_REQUIRE(std::is_same_v<positional::traits_type, tamed::config_traits<>>);
+    STATIC_REQUIRE(positional::methods.size() == 2);
+}
+
+TEST_CASE("changing a policy keeps the rest of the config")
+{
+    using config_type   = tamed::rest_config::with_fields_type<tamed::recycling_fields>::with_logger_type<tamed::null_logger>;
+
+    STATIC_REQUIRE(std::is_same_v<config_type::fields_type, tamed::recycling_fields>);
+    STATIC_REQUIRE(std::is_same_v<config_type::logger_type, tamed::null_logger>);
+    STATIC_REQUIRE(std::is_same_v<config_type::tracer_type, tamed::rest_config::tracer_type>);
+    STATIC_REQUIRE(config_type::methods.size() == tamed::rest_config::methods.size());
+    STATIC_REQUIRE(std::is_same_v<config_type::with_traits<tamed::config_traits<>>, tamed::rest_config>);
+}
+
+TEST_CASE("connections without a tracer do not store one")
+{
+    using untraced  = tamed::testing::memory_server<tamed::rest_config>::data_type;
+    using traced    = tamed::testing::memory_server<tamed::rest_config::with_tracer_type<ignoring_tracer>>::data_type;
+
+    // only a tracer that records something takes space
+    STATIC_REQUIRE(sizeof(traced) == sizeof(untraced) + sizeof(tamed::request_tracer<ignoring_tracer>));
+}
@@ -0,0 +1,178 @@
+#include "catch2.hpp"
+#include "memory_stream.h"
+#include <vector>
+
+
+namespace {
+
+    using server_type   = tamed::testing::memory_server<tamed::rest_config>;
+    using request_type  = server_type::request_type;
+
+    /**
+     *  The request sent over and over
+     */
+    constexpr const char* keep_alive_get = "GET / HTTP/1.1\r\nHost: test\r\n\r\n";
+
+    /**
+     *  The response that was serialized up front
+     */
+    constexpr const char* serialized = "HTTP/1.1 200 OK\r\nContent-Length: 2\r\n\r\nok";
+
+    /**
+     *  The server under test, and the connections
+     *  waiting for their response
+     */
+    server_type*                    current{ nullptr };
+    std::vector<tamed::connection>  waiting;
+
+    /**
+     *  Drain the server, and answer with a
+     *  response that was serialized up front
+     */
+    void drain_serialized(tamed::connection connection, request_type&&)
+    {
+        current->drain();
+        connection.send(std::string_view{ serialized });
+    }
+
+    /**
+     *  Wait until three requests are in flight, and
+     *  then drain the server and answer all of them
+     */
+    void drain_queued(tamed::connection connection, request_type&& request)
+    {
+        // wait for the other requests
+        waiting.push_back(std::move(connection));
+        if (waiting.size() < 3) {
+            return;
+        }
+
+        // the responses were already on their way
+        current->drain();
+
+        // answer the requests in order
+        for (auto& pending : waiting) {
+            boost::beast::http::response<boost::beast::http::string_body> response{ boost::beast::http::status::ok, request.version() };
+
+            response.body().assign("ok");
+            pending.send(std::move(response));
+        }
+
+        waiting.clear();
+    }
+
+    /**
+     *  Answer a request later, after draining the server,
+     *  so the next request can start arriving first
+     */
+    void drain_later(tamed::connection connection, request_type&&)
+    {
+        // the executor to answer on
+        auto executor = connection.get_executor();
+
+        boost::asio::post(executor, [connection = std::move(connection)]() mutable {
+            current->drain();
+            connection.send(std::string_view{ "HTTP/1.1 200 OK\r\nContent-Length: 4\r\n\r\nslow" });
+        });
+    }
+
+    /**
+     *  Answer a request right away
+     */
+    void answer(tamed::connection connection, request_type&& request)
+    {
+        boost::beast::http::response<boost::beast::http::string_body> response{ boost::beast::http::status::ok, request.version() };
+
+        response.body().assign("ok");
+        connection.send(std::move(response));
+    }
+
+    /**
+     *  Count the occurrences of a line in the output
+     *
+     *  @param  output  The responses that were written
+     *  @param  line    The line to look for
+     *  @return The number of times the line occurs
+     */
+    std::size_t count(const std::string& output, const char* line)
+    {
+        std::size_t result{ 0 };
+
+        for (auto position = output.find(line); position != std::string::npos; position = output.find(line, position + 1)) {
+            ++result;
+        }
+
+        return result;
+    }
+
+}
+
+TEST_CASE("a serialized response asks the client to close while draining")
+{
+    server_type server;
+
+    current = &server;
+    server.get_router().add<drain_serialized>(boost::beast::http::verb::get, "/");
+
+    auto stream = server.make_stream(keep_alive_get, 3);
+    auto copy   = stream;
+
+    copy.keep_output();
+    server.run(std::move(stream));
+
+    // the header is added after the status line, and
+    // the other requests are no longer answered
+    REQUIRE(copy.get_script().output == "HTTP/1.1 200 OK\r\nConnection: close\r\nContent-Length: 2\r\n\r\nok");
+}
+
+TEST_CASE("only the last response in flight asks the client to close")
+{
+    server_type server;
+
+    current = &server;
+    server.get_settings().pipeline_depth = 4;
+    server.get_router().add<drain_queued>(boost::beast::http::verb::get, "/");
+
+    auto stream = server.make_stream(keep_alive_get, 3);
+    auto copy   = stream;
+
+    copy.keep_output();
+    server.run(std::move(stream));
+
+    // all requests are answered, the client is told to close
+    // once, after the responses it is still waiting for
+    auto& output = copy.get_script().output;
+
+    REQUIRE(count(output, "HTTP/1.1 200 OK\r\n") == 3);
+    REQUIRE(count(output, "Connection: close\r\n") == 1);
+    REQUIRE(output.rfind("Connection: close\r\n") > output.rfind("HTTP/1.1 200 OK\r\n"));
+}
+
+TEST_CASE("a pipelined request that has partly arrived is answered while draining")
+{
+    server_type server;
+
+    current = &server;
+    server.get_settings().pipeline_depth = 4;
+    server.get_router().add<drain_later>(boost::beast::http::verb::get, "/slow");
+    server.get_router().add<answer>(boost::beast::http::verb::get, "/");
+
+    // the first read ends halfway through the second request
+    std::string slow    = "GET /slow HTTP/1.1\r\nHost: test\r\n\r\n";
+    std::string next    = "GET / HTTP/1.1\r\nHost: test\r\n\r\n";
+    auto        stream  = server.make_stream(slow + next, 1);
+    auto        copy    = stream;
+
+    stream.limit_reads(slow.size() + 8);
+    copy.keep_output();
+    server.run(std::move(stream));
+
+    // the second request is still answered, and only its
+    // response asks the client to close
+    auto& output = copy.get_script().output;
+
+    REQUIRE(count(output, "HTTP/1.1 200 OK\r\n") == 2);
+    REQUIRE(count(output, "Connection: close\r\n") == 1);
+    REQUIRE(output.find("slow") < output.find("Connection: close\r\n"));
+    REQUIRE(output.compare(output.size() - 2, 2, "ok") == 0);
+}
@@ -0,0 +1,217 @@
+#include <iostream>
+
+#include "catch2.hpp"
+#include <tamed/kernel_tls_stream.h>
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/read.hpp>
+#include <boost/asio/ssl/stream.hpp>
+#include <boost/asio/write.hpp>
+#include <openssl/evp.h>
+#include <openssl/ec.h>
+#include <openssl/x509.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <array>
+#include <memory>
+#include <optional>
+#include <string>
+
+
+namespace {
+
+    using tcp = boost::asio::ip::tcp;
+
+    /**
+     *  Give a server context a new self-signed certificate
+     *
+     *  @param  context The context to add the certificate to
+     */
+    void add_certificate(boost::asio::ssl::context& context)
+    {
+        // generate a key on the P-256 curve
+        std::unique_ptr<EVP_PKEY_CTX, decltype(&EVP_PKEY_CTX_free)> parameters{ EVP_PKEY_CTX_new_id(EVP_PKEY_EC, nullptr), &EVP_PKEY_CTX_free };
+        EVP_PKEY* generated{ nullptr };
+
+        REQUIRE(EVP_PKEY_keygen_init(parameters.get()) == 1);
+        REQUIRE(EVP_PKEY_CTX_set_ec_paramgen_curve_nid(parameters.get(), NID_X9_62_prime256v1) == 1);
+        REQUIRE(EVP_PKEY_keygen(parameters.get(), &generated) == 1);
+
+        std::unique_ptr<EVP_PKEY, decltype(&EVP_PKEY_free)> key{ generated, &EVP_PKEY_free };
+
+        // the certificate, valid for a day, signed with its own key
+        std::unique_ptr<X509, decltype(&X509_free)> certificate{ X509_new(), &X509_free };
+
+        X509_set_version(certificate.get(), 2);
+        ASN1_INTEGER_set(X509_get_serialNumber(certificate.get()), 1);
+        X509_gmtime_adj(X509_getm_notBefore(certificate.get()), 0);
+        X509_gmtime_adj(X509_getm_notAfter(certificate.get()), 24 * 60 * 60);
+        X509_set_pubkey(certificate.get(), key.get());
+        X509_NAME_add_entry_by_txt(X509_get_subject_name(certificate.get()), "CN", MBSTRING_ASC, reinterpret_cast<const unsigned char*>("localhost"), -1, -1, 0);
+        X509_set_issuer_name(certificate.get(), X509_get_subject_name(certificate.get()));
+        REQUIRE(X509_sign(certificate.get(), key.get(), EVP_sha256()) != 0);
+
+        // the context copies what it needs
+        REQUIRE(SSL_CTX_use_certificate(context.native_handle(), certificate.get()) == 1);
+        REQUIRE(SSL_CTX_use_PrivateKey(context.native_handle(), key.get()) == 1);
+    }
+
+    /**
+     *  A kernel TLS stream connected to a client
+     *  over the loopback interface
+     */
+    struct loopback
+    {
+        /**
+         *  Constructor
+         *
+         *  @param  cipher  The TLS 1.2 cipher for the server to use
+         */
+        loopback(const char* cipher)
+        {
+            // the server uses only the given cipher
+            add_certificate(server_context);
+            SSL_CTX_set_max_proto_version(server_context.native_handle(), TLS1_2_VERSION);
+            SSL_CTX_set_cipher_list(server_context.native_handle(), cipher);
+
+            // connect the client to the server
+            tcp::acceptor acceptor{ context, { boost::asio::ip::make_address("127.0.0.1"), 0 } };
+            client.next_layer().connect(acceptor.local_endpoint());
+            server.emplace(acceptor.accept(), server_context, tamed::kernel_tls);
+        }
+
+        /**
+         *  Perform the handshake on both sides
+         */
+        void handshake()
+        {
+            boost::system::error_code server_error{ boost::asio::error::would_block };
+            boost::system::error_code client_error{ boost::asio::error::would_block };
+
+            server->async_handshake(boost::asio::ssl::stream_base::server, [&server_error](const boost::system::error_code& ec) { server_error = ec; });
+            client.async_handshake(boost::asio::ssl::stream_base::client, [&client_error](const boost::system::error_code& ec) { client_error = ec; });
+            context.run();
+            context.restart();
+
+            REQUIRE(server_error == boost::system::error_code{});
+            REQUIRE(client_error == boost::system::error_code{});
+        }
+
+        /**
+         *  Send data from the server to the client
+         *
+         *  @param  target  The stream or socket on the server to write to
+         *  @param  first   The first part of the data
+         *  @param  second  The second part of the data
+         *  @return The data received by the client
+         */
+        template <typename target_type>
+        std::string send(target_type& target, const std::string& first, const std::string& second)
+        {
+            std::array<boost::asio::const_buffer, 2>    buffers{ boost::asio::buffer(first), boost::asio::buffer(second) };
+            std::string                                 received(first.size() + second.size(), '\0');
+            boost::system::error_code                   write_error{ boost::asio::error::would_block };
+            boost::system::error_code                   read_error{ boost::asio::error::would_block };
+
+            boost::asio::async_write(target, buffers, [&write_error](const boost::system::error_code& ec, std::size_t) { write_error = ec; });
+            boost::asio::async_read(client, boost::asio::buffer(received), [&read_error](const boost::system::error_code& ec, std::size_t) { read_error = ec; });
+            context.run();
+            context.restart();
+
+            REQUIRE(write_error == boost::system::error_code{});
+            REQUIRE(read_error == boost::system::error_code{});
+            return received;
+        }
+
+        /**
+         *  Send data from the client to the server
+         *
+         *  @param  data    The data to send
+         *  @return The data received by the server
+         */
+        std::string receive(const std::string& data)
+        {
+            std::string                 received(data.size(), '\0');
+            boost::system::error_code   write_error{ boost::asio::error::would_block };
+            boost::system::error_code   read_error{ boost::asio::error::would_block };
+
+            boost::asio::async_write(client, boost::asio::buffer(data), [&write_error](const boost::system::error_code& ec, std::size_t) { write_error = ec; });
+            boost::asio::async_read(*server, boost::asio::buffer(received), [&read_error](const boost::system::error_code& ec, std::size_t) { read_error = ec; });
+            context.run();
+            context.restart();
+
+            REQUIRE(write_error == boost::system::error_code{});
+            REQUIRE(read_error == boost::system::error_code{});
+            return received;
+        }
+
+        boost::asio::io_context                                     context;
+        boost::asio::ssl::context                                   server_context{ boost::asio::ssl::context::tls_server };
+        boost::asio::ssl::context                                   client_context{ boost::asio::ssl::context::tls_client };
+        boost::asio::ssl::stream<tcp::socket>                       client{ context, client_context };
+        std::optional<tamed::kernel_tls_stream<tcp::socket>>        server;
+    };
+
+    /**
+     *  Check whether the kernel can encrypt TLS records
+     *
+     *  @return Whether the tls module can be attached to a socket
+     */
+    bool kernel_supports_tls()
+    {
+        // openssl must be able to hand over the keys
+        #if !defined(SSL_OP_ENABLE_KTLS) || defined(OPENSSL_NO_KTLS)
+            return false;
+        #else
+            // the module is only attached to a connected socket
+            boost::asio::io_context context;
+            tcp::acceptor           acceptor{ context, { boost::asio::ip::make_address("127.0.0.1"), 0 } };
+            tcp::socket             client{ context };
+
+            client.connect(acceptor.local_endpoint());
+            auto server = acceptor.accept();
+
+            // try to attach the module
+            return ::setsockopt(server.native_handle(), SOL_TCP, TCP_ULP, "tls", sizeof "tls") == 0;
+        #endif
+    }
+
+}
+
+TEST_CASE("the kernel tls stream encrypts in user space without kernel support for the cipher")
+{
+    // the kernel does not encrypt with CBC ciphers
+    loopback connection{ "ECDHE-ECDSA-AES128-SHA" };
+
+    connection.handshake();
+    REQUIRE_FALSE(connection.server->kernel_send());
+
+    // the buffers of a write are combined into records
+    std::string first(100, 'a');
+    std::string second(40000, 'b');
+
+    REQUIRE(connection.send(*connection.server, first, second) == first + second);
+    REQUIRE(connection.receive("GET / HTTP/1.1\r\n\r\n") == "GET / HTTP/1.1\r\n\r\n");
+}
+
+TEST_CASE("the kernel tls stream hands the encryption to the kernel")
+{
+    // is kernel tls available at all?
+    if (!kernel_supports_tls()) {
+        WARN("Skipped, the kernel or openssl does not support kernel tls");
+        return;
+    }
+
+    // the kernel encrypts with GCM ciphers
+    loopback connection{ "ECDHE-ECDSA-AES128-GCM-SHA256" };
+
+    connection.handshake();
+    REQUIRE(connection.server->kernel_send());
+
+    // plain data written to the socket arrives encrypted
+    std::string first(100, 'a');
+    std::string second(40000, 'b');
+
+    REQUIRE(connection.send(connection.server->next_layer(), first, second) == first + second);
+    REQUIRE(connection.receive("GET / HTTP/1.1\r\n\r\n") == "GET / HTTP/1.1\r\n\r\n");
+}
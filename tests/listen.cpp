@@ -0,0 +1,82 @@
+#include <iostream>
+
+#include "catch2.hpp"
+#include <tamed/server.h>
+#include <sys/resource.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+
+TEST_CASE("a sharded listener that fails to bind every shard closes the others")
+{
+    using tcp = boost::asio::ip::tcp;
+
+    boost::asio::io_context context;
+
+    // two shards on the same context
+    tamed::rest_server server{ std::vector<boost::asio::io_context::executor_type>{ context.get_executor(), context.get_executor() } };
+
+    // find a port that is free
+    tcp::endpoint endpoint{ boost::asio::ip::make_address("127.0.0.1"), 0 };
+    {
+        tcp::acceptor probe{ context, endpoint };
+        endpoint.port(probe.local_endpoint().port());
+    }
+
+    // the lowest free descriptor, which the first acceptor will get
+    auto descriptor = ::open("/dev/null", O_RDONLY);
+    REQUIRE(descriptor >= 0);
+    ::close(descriptor);
+
+    // allow only a single new descriptor, so the second shard cannot be opened
+    rlimit original{};
+    ::getrlimit(RLIMIT_NOFILE, &original);
+    rlimit limited{ static_cast<rlim_t>(descriptor + 1), original.rlim_max };
+    ::setrlimit(RLIMIT_NOFILE, &limited);
+
+    // the first shard is bound, the second fails
+    auto ec = server.listen_sharded(endpoint);
+    ::setrlimit(RLIMIT_NOFILE, &original);
+    REQUIRE(ec == boost::system::errc::too_many_files_open);
+
+    // let the first shard close
+    context.poll();
+
+    // nobody should be listening anymore
+    tcp::socket client{ context };
+    client.connect(endpoint, ec);
+    REQUIRE(ec == boost::asio::error::connection_refused);
+}
+
+TEST_CASE("a connection can outlive the server that accepted it")
+{
+    using tcp = boost::asio::ip::tcp;
+
+    // the context is destroyed after the server, like in the example
+    boost::asio::io_context context;
+    tcp::socket             client{ context };
+
+    {
+        tamed::rest_server server{ context.get_executor() };
+
+        // listen on a free port
+        tcp::endpoint endpoint{ boost::asio::ip::make_address("127.0.0.1"), 0 };
+        {
+            tcp::acceptor probe{ context, endpoint };
+            endpoint.port(probe.local_endpoint().port());
+        }
+        REQUIRE(!server.listen(endpoint));
+
+        // connect, and let the server accept the connection
+        client.connect(endpoint);
+        while (server.get_accept_statistics().accepted() == 0) {
+            context.run_one();
+        }
+
+        // the connection is now waiting for a request
+        context.poll();
+    }
+
+    // the pending read of the connection is destroyed with the
+    // context, after the executor slots of the server are gone
+}
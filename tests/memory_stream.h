@@ -0,0 +1,308 @@
+#pragma once
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <boost/asio/buffer.hpp>
+#include <boost/asio/error.hpp>
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/post.hpp>
+#include <boost/beast/core/bind_handler.hpp>
+#include <tamed/server.h>
+
+
+namespace tamed::testing {
+
+    /**
+     *  A stream that serves requests from memory, and
+     *  throws away the responses, so that connections
+     *  can be driven without any sockets involved. The
+     *  responses can be kept instead, for inspection.
+     *
+     *  The stream plays the same request over and over,
+     *  until the requested number of bytes was read, and
+     *  then reports the end of the stream. The reads can
+     *  be limited, so a request arrives in parts.
+     */
+    class memory_stream
+    {
+        public:
+            using executor_type = boost::asio::io_context::executor_type;
+
+            /**
+             *  The data sent and received over the stream
+             */
+            struct script
+            {
+                std::string     request;        // the request to repeat
+                std::size_t     remaining;      // the number of bytes still to be read
+                std::size_t     offset{ 0 };    // the position in the request to read next
+                std::size_t     written{ 0 };   // the number of bytes written to the stream
+                std::size_t     limit{ 0 };     // the most bytes to return from a single read, zero for no limit
+                bool            keep{ false };  // should the written data be kept
+                std::string     output;         // the written data, if it is kept
+            };
+
+            /**
+             *  Constructor
+             *
+             *  @param  executor    The executor to complete operations on
+             *  @param  request     The request to send
+             *  @param  count       The number of times to send the request
+             */
+            memory_stream(executor_type executor, std::string request, std::size_t count) :
+                _executor{ executor },
+                _script{ std::make_shared<script>() }
+            {
+                // send the request the given number of times
+                _script->remaining  = request.size() * count;
+                _script->request    = std::move(request);
+            }
+
+            /**
+             *  Retrieve the data sent and received
+             *
+             *  @return The script of the stream
+             */
+            const script& get_script() const noexcept
+            {
+                return *_script;
+            }
+
+            /**
+             *  Keep the data written to the stream, instead
+             *  of throwing it away, this allocates for it
+             */
+            void keep_output() noexcept
+            {
+                _script->keep = true;
+            }
+
+            /**
+             *  Limit the number of bytes returned from a
+             *  single read, so that requests arrive in parts
+             *
+             *  @param  size    The most bytes to read at once
+             */
+            void limit_reads(std::size_t size) noexcept
+            {
+                _script->limit = size;
+            }
+
+            /**
+             *  Retrieve the executor
+             *
+             *  @return The executor operations complete on
+             */
+            executor_type get_executor() const noexcept
+            {
+                return _executor;
+            }
+
+            /**
+             *  Read from the stream
+             *
+             *  @param  buffers The buffers to read into
+             *  @param  handler The handler to invoke with the result
+             */
+            template <typename buffers_type, typename handler_type>
+            void async_read_some(const buffers_type& buffers, handler_type&& handler)
+            {
+                // the number of bytes read into the buffers
+                std::size_t transferred{ 0 };
+
+                // fill the buffers with the repeated request
+                for (auto buffer : boost::beast::buffers_range_ref(buffers)) {
+                    // the location to write to
+                    auto* data = static_cast<char*>(buffer.data());
+                    auto  size = std::min(buffer.size(), _script->remaining);
+
+                    // is the read limited?
+                    if (_script->limit != 0) {
+                        size = std::min(size, _script->limit - transferred);
+                    }
+
+                    // copy the request, continuing where we left off
+                    for (std::size_t copied{ 0 }; copied < size; ) {
+                        // copy up to the end of the request
+                        auto chunk = std::min(size - copied, _script->request.size() - _script->offset);
+                        std::memcpy(data + copied, _script->request.data() + _script->offset, chunk);
+
+                        // and continue at the start of the request
+                        copied          += chunk;
+                        _script->offset  = (_script->offset + chunk) % _script->request.size();
+                    }
+
+                    // the data was read
+                    transferred         += size;
+                    _script->remaining  -= size;
+                }
+
+                // without data left, the client closed the stream
+                boost::system::error_code ec{};
+                if (transferred == 0 && boost::asio::buffer_size(buffers) != 0) {
+                    ec = boost::asio::error::eof;
+                }
+
+                // complete the read through the executor
+                boost::asio::post(_executor, boost::beast::bind_front_handler(std::move(handler), ec, transferred));
+            }
+
+            /**
+             *  Write to the stream
+             *
+             *  @param  buffers The data to write
+             *  @param  handler The handler to invoke with the result
+             */
+            template <typename buffers_type, typename handler_type>
+            void async_write_some(const buffers_type& buffers, handler_type&& handler)
+            {
+                // the data is accepted, and thrown away unless we keep it
+                auto transferred = boost::asio::buffer_size(buffers);
+                _script->written += transferred;
+
+                // should we keep the data?
+                if (_script->keep) {
+                    // add the data to the output
+                    for (auto buffer : boost::beast::buffers_range_ref(buffers)) {
+                        _script->output.append(static_cast<const char*>(buffer.data()), buffer.size());
+                    }
+                }
+
+                // complete the write through the executor
+                boost::asio::post(_executor, boost::beast::bind_front_handler(std::move(handler), boost::system::error_code{}, transferred));
+            }
+
+            /**
+             *  Close the stream, nothing more will be read
+             *
+             *  @param  ec  The error code from closing
+             */
+            void close(boost::system::error_code& ec) noexcept
+            {
+                _script->remaining = 0;
+                ec = {};
+            }
+        private:
+            executor_type           _executor;  // the executor to complete operations on
+            std::shared_ptr<script> _script;    // the data for the stream, shared with copies
+    };
+
+    /**
+     *  Runs connections over memory streams, with
+     *  the storage a listener would provide them
+     */
+    template <typename config_type>
+    class memory_server
+    {
+        public:
+            using request_type  = boost::beast::http::request<typename config_type::request_body_type, typename config_type::fields_type>;
+            using router_type   = typename server<config_type>::router_type;
+            using executor_type = typename config_type::executor_type;
+            using data_type     = connection_data_impl<router_type, request_type, memory_stream, executor_type, typename config_type::logger_type, typename config_type::tracer_type>;
+
+            /**
+             *  Constructor
+             *
+             *  @param  options The settings for the connections, and their pool
+             */
+            memory_server(const settings& options = {}) :
+                _options{ options },
+                _executors{ std::vector<executor_type>{ _context.get_executor() } },
+                _pool{ std::make_shared<connection_pool>(_options.pool_size, _options.pool_buffer_limit, &_executors[0].get_allocation_statistics()) }
+            {}
+
+            /**
+             *  Retrieve the settings for new connections
+             *
+             *  @return The settings to tune the connections
+             */
+            settings& get_settings() noexcept
+            {
+                return _options;
+            }
+
+            /**
+             *  Retrieve the router
+             *
+             *  @return The router to add the routes to
+             */
+            router_type& get_router() noexcept
+            {
+                return _router;
+            }
+
+            /**
+             *  Create a stream for sending requests
+             *
+             *  @param  request The request to send
+             *  @param  count   The number of times to send the request
+             *  @return The stream to run a connection over
+             */
+            memory_stream make_stream(std::string request, std::size_t count)
+            {
+                return { _context.get_executor(), std::move(request), count };
+            }
+
+            /**
+             *  Drain the connections, like the server would
+             */
+            void drain() noexcept
+            {
+                _executors[0].get_drain_list().drain();
+            }
+
+            /**
+             *  Send a request over a new connection,
+             *  and wait for the connection to close
+             *
+             *  @param  request The request to send
+             *  @param  count   The number of times to send the request
+             *  @return The number of bytes written by the server
+             */
+            std::size_t run(std::string request, std::size_t count)
+            {
+                return run(make_stream(std::move(request), count));
+            }
+
+            /**
+             *  Run a new connection over a stream,
+             *  and wait for the connection to close
+             *
+             *  The stream should be created with make_stream(), the
+             *  connection allocates nothing the pool cannot recycle.
+             *
+             *  @param  stream  The stream to run the connection over
+             *  @return The number of bytes written by the server
+             */
+            std::size_t run(memory_stream stream)
+            {
+                // keep a copy, sharing the script, to find the output
+                auto copy = stream;
+
+                // create the connection, from the pool like the listener would
+                auto connection = std::allocate_shared<data_type>(pool_allocator<data_type>{ _pool }, _router, _executors[0], _pool, _options, connection_permit{ nullptr, nullptr }, std::move(stream));
+                std::weak_ptr<data_type> alive{ connection };
+
+                // start reading
+                connection->start();
+                connection.reset();
+
+                // run the connection until it is closed
+                while (!alive.expired()) {
+                    _context.run_one();
+                }
+
+                // the number of bytes in the responses
+                return copy.get_script().written;
+            }
+        private:
+            boost::asio::io_context             _context;   // the context to run the connections on
+            settings                            _options;   // the settings for the connections
+            router_type                         _router;    // the routes to send the requests to
+            executor_pool<executor_type>        _executors; // the executor slot the connections run on
+            std::shared_ptr<connection_pool>    _pool;      // recycled storage for the connections
+    };
+
+}
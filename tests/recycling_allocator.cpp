@@ -0,0 +1,60 @@
+#include "catch2.hpp"
+#include <tamed/recycling_allocator.h>
+#include <thread>
+#include <vector>
+
+
+namespace {
+
+    /**
+     *  Holds memory from the recycling allocator
+     *  until the thread exits
+     */
+    struct late_owner
+    {
+        /**
+         *  Destructor
+         */
+        ~late_owner()
+        {
+            // is the cache of the thread gone already?
+            destroyed   = tamed::recycling_cache::instance() == nullptr;
+
+            // give back the memory, which must not touch the cache
+            decltype(values){}.swap(values);
+        }
+
+        std::vector<int, tamed::recycling_allocator<int>>   values;         // the memory to release
+        bool&                                               destroyed;      // whether the cache was destroyed first
+    };
+
+}
+
+TEST_CASE("recycled memory is recycled by the releasing thread")
+{
+    tamed::recycling_allocator<int> allocator;
+
+    // a freed block is handed out for the next allocation of its size
+    auto* first = allocator.allocate(16);
+    allocator.deallocate(first, 16);
+
+    auto* second = allocator.allocate(16);
+    REQUIRE(second == first);
+    allocator.deallocate(second, 16);
+}
+
+TEST_CASE("recycled memory can be released after the cache is destroyed")
+{
+    bool destroyed{ false };
+
+    std::thread{ [&destroyed]() {
+        // the owner is created before the cache, so it is
+        // destroyed after the cache when the thread exits
+        thread_local late_owner owner{ {}, destroyed };
+
+        // this creates the cache of the thread
+        owner.values.resize(64);
+    } }.join();
+
+    REQUIRE(destroyed);
+}
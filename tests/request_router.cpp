@@ -0,0 +1,119 @@
+#include <iostream>
+
+#include "catch2.hpp"
+#include "memory_stream.h"
+
+
+namespace {
+
+    using server_type   = tamed::testing::memory_server<tamed::rest_config>;
+
+    /**
+     *  Handler that is never reached
+     */
+    void handle_get(tamed::connection connection, server_type::request_type&&)
+    {
+        connection.send(std::string_view{ "HTTP/1.1 200 OK\r\nContent-Length: 0\r\n\r\n" });
+    }
+
+    /**
+     *  Send a request over a connection
+     *
+     *  @param  server  The server to send the request to
+     *  @param  request The request to send
+     *  @return The responses that were written
+     */
+    std::string send(server_type& server, std::string request)
+    {
+        auto stream = server.make_stream(std::move(request), 1);
+        auto copy   = stream;
+
+        copy.keep_output();
+        server.run(std::move(stream));
+
+        return copy.get_script().output;
+    }
+
+}
+
+TEST_CASE("prepared responses are sent as they are to HTTP/1.1 clients")
+{
+    server_type server;
+
+    REQUIRE(send(server, "GET /missing HTTP/1.1\r\nHost: test\r\n\r\n") ==
+        "HTTP/1.1 404 Not Found\r\n"
+        "Content-Length: 51\r\n"
+        "\r\n"
+        "The requested resource was not found on this server");
+}
+
+TEST_CASE("prepared responses follow the version and connection of the request")
+{
+    server_type server;
+
+    SECTION("an HTTP/1.0 request") {
+        auto output = send(server, "GET /missing HTTP/1.0\r\n\r\n");
+
+        REQUIRE(output.rfind("HTTP/1.0 404 Not Found\r\n", 0) == 0);
+        REQUIRE(output.find("Connection: keep-alive") == std::string::npos);
+        REQUIRE(output.find("\r\n\r\nThe requested resource was not found on this server") != std::string::npos);
+    }
+
+    SECTION("an HTTP/1.0 request to keep the connection alive") {
+        auto output = send(server, "GET /missing HTTP/1.0\r\nConnection: keep-alive\r\n\r\n");
+
+        REQUIRE(output.rfind("HTTP/1.0 404 Not Found\r\n", 0) == 0);
+        REQUIRE(output.find("Connection: keep-alive\r\n") != std::string::npos);
+    }
+
+    SECTION("an HTTP/1.1 request to close the connection") {
+        auto output = send(server, "GET /missing HTTP/1.1\r\nConnection: close\r\n\r\n");
+
+        REQUIRE(output.rfind("HTTP/1.1 404 Not Found\r\n", 0) == 0);
+        REQUIRE(output.find("Connection: close\r\n") != std::string::npos);
+    }
+
+    SECTION("an HTTP/1.0 request for a method that is not supported") {
+        auto output = send(server, "PATCH /missing HTTP/1.0\r\n\r\n");
+
+        REQUIRE(output.rfind("HTTP/1.0 405 Method Not Allowed\r\n", 0) == 0);
+        REQUIRE(output.find("Allow: GET, POST, PUT, DELETE, HEAD, OPTIONS\r\n") != std::string::npos);
+    }
+}
+
+TEST_CASE("the methods of a path follow the version of the request")
+{
+    server_type server;
+
+    server.get_router().add<handle_get>(boost::beast::http::verb::get, "/path");
+
+    SECTION("asking which methods are allowed over HTTP/1.1") {
+        REQUIRE(send(server, "OPTIONS /path HTTP/1.1\r\nHost: test\r\n\r\n") ==
+            "HTTP/1.1 200 OK\r\n"
+            "Allow: GET, HEAD, OPTIONS\r\n"
+            "Content-Length: 0\r\n"
+            "\r\n");
+    }
+
+    SECTION("asking which methods are allowed over HTTP/1.0") {
+        auto output = send(server, "OPTIONS /path HTTP/1.0\r\n\r\n");
+
+        REQUIRE(output.rfind("HTTP/1.0 200 OK\r\n", 0) == 0);
+        REQUIRE(output.find("Allow: GET, HEAD, OPTIONS\r\n") != std::string::npos);
+    }
+
+    SECTION("asking about the server over HTTP/1.0") {
+        auto output = send(server, "OPTIONS * HTTP/1.0\r\nConnection: keep-alive\r\n\r\n");
+
+        REQUIRE(output.rfind("HTTP/1.0 200 OK\r\n", 0) == 0);
+        REQUIRE(output.find("Connection: keep-alive\r\n") != std::string::npos);
+    }
+
+    SECTION("using a method that is not allowed, and closing") {
+        auto output = send(server, "POST /path HTTP/1.1\r\nConnection: close\r\nContent-Length: 0\r\n\r\n");
+
+        REQUIRE(output.rfind("HTTP/1.1 405 Method Not Allowed\r\n", 0) == 0);
+        REQUIRE(output.find("Allow: GET, HEAD, OPTIONS\r\n") != std::string::npos);
+        REQUIRE(output.find("Connection: close\r\n") != std::string::npos);
+    }
+}
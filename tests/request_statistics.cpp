@@ -0,0 +1,30 @@
+#include "catch2.hpp"
+#include <tamed/request_statistics.h>
+
+
+TEST_CASE("requests for routes beyond the table are counted as overflow")
+{
+    tamed::request_statistics statistics;
+
+    // the first route that does not fit in the table
+    constexpr auto limit = std::size_t{ 16 } * 64;
+
+    statistics.record(0, limit - 1, 200, 10, 20, std::chrono::microseconds{ 5 });
+    statistics.record(0, limit, 200, 10, 20, std::chrono::microseconds{ 5 });
+    statistics.record(0, limit + 100, 404, 10, 20, std::chrono::microseconds{ 5 });
+
+    // the last route is tracked on its own
+    REQUIRE(statistics.get_route(limit - 1) != nullptr);
+    REQUIRE(statistics.get_route(limit - 1)->requests() == 1);
+
+    // the others are combined, and not lost
+    REQUIRE(statistics.get_route(limit) == nullptr);
+    REQUIRE(statistics.get_overflow().requests() == 2);
+    REQUIRE(statistics.get_overflow().responses(4) == 1);
+
+    // and they survive combining the statistics
+    tamed::request_statistics combined{ statistics };
+
+    REQUIRE(combined.get_overflow().requests() == 2);
+    REQUIRE(combined.get_method(0)->requests() == 3);
+}
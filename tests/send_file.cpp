@@ -0,0 +1,85 @@
+#include <iostream>
+
+#include "catch2.hpp"
+#include <tamed/send_file.h>
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/local/connect_pair.hpp>
+#include <boost/asio/local/stream_protocol.hpp>
+#include <array>
+#include <functional>
+#include <stdlib.h>
+#include <unistd.h>
+
+
+TEST_CASE("a file truncated while it is sent fails instead of sending nothing")
+{
+    using socket_type = boost::asio::local::stream_protocol::socket;
+
+    boost::asio::io_context         context;
+    socket_type                     writer  { context };
+    socket_type                     reader  { context };
+    std::array<char, 65536>         buffer;
+    std::function<void()>           drain;
+
+    // the sockets on both ends, the reader takes everything
+    boost::asio::local::connect_pair(writer, reader);
+    writer.non_blocking(true);
+
+    drain = [&]() {
+        reader.async_read_some(boost::asio::buffer(buffer), [&](const boost::system::error_code& ec, std::size_t) {
+            if (!ec) {
+                drain();
+            }
+        });
+    };
+    drain();
+
+    // a file that is larger than the socket buffers
+    char path[] = "/tmp/tamed-send-file-XXXXXX";
+    int descriptor = ::mkstemp(path);
+    REQUIRE(descriptor >= 0);
+    ::unlink(path);
+
+    constexpr const std::size_t size = 16 * 1024 * 1024;
+    REQUIRE(::ftruncate(descriptor, size) == 0);
+
+    // send the file the way a connection does, one part at a time
+    tamed::file_region          region  { descriptor, 0, size };
+    boost::system::error_code   result  {};
+    std::size_t                 writes  { 0 };
+
+    while (region.size != 0 && !result && writes < 1000) {
+        // the outcome of this part
+        bool        done        { false };
+        std::size_t transferred { 0 };
+
+        tamed::async_send_file(writer, region, [&](const boost::system::error_code& ec, std::size_t bytes) {
+            result      = ec;
+            transferred = bytes;
+            done        = true;
+        });
+
+        // run until the part is written
+        while (!done) {
+            context.run_one();
+        }
+
+        // the first part is out, now the file shrinks to what was sent
+        if (++writes == 1) {
+            REQUIRE(transferred != 0);
+            REQUIRE(transferred < size);
+            REQUIRE(::ftruncate(descriptor, transferred) == 0);
+        }
+
+        // continue where we left off
+        region.offset   += transferred;
+        region.size     -= transferred;
+    }
+
+    ::close(descriptor);
+
+    // the missing data must be reported, not retried forever
+    REQUIRE(result == boost::asio::error::eof);
+    REQUIRE(writes == 2);
+    REQUIRE(region.size != 0);
+}
@@ -0,0 +1,165 @@
+#include "catch2.hpp"
+#include <tamed/timer_wheel.h>
+#include <boost/asio/io_context.hpp>
+#include <memory>
+#include <vector>
+
+
+namespace {
+
+    using namespace std::chrono_literals;
+
+    /**
+     *  A timer that remembers when it expired
+     */
+    struct recorded_timer
+    {
+        /**
+         *  Constructor
+         *
+         *  @param  name    The name to record on expiry
+         *  @param  order   The names of the timers, in the order they expired
+         */
+        recorded_timer(int name, std::vector<int>& order) :
+            name{ name },
+            order{ order },
+            entry{ &recorded_timer::expired, this }
+        {}
+
+        /**
+         *  Handle the timer expiring
+         *
+         *  @param  context The timer that expired
+         */
+        static void expired(void* context) noexcept
+        {
+            auto* timer = static_cast<recorded_timer*>(context);
+
+            timer->order.push_back(timer->name);
+            timer->time = std::chrono::steady_clock::now();
+        }
+
+        int                                     name;       // the name of the timer
+        std::vector<int>&                       order;      // the order in which the timers expired
+        std::chrono::steady_clock::time_point   time;       // the time the timer expired
+        tamed::timer_wheel::entry               entry;      // the entry on the wheel
+    };
+
+    /**
+     *  Run the context until the wheel has no timers left
+     *
+     *  @param  context The context running the wheel
+     *  @param  wheel   The wheel to wait for
+     */
+    void run(boost::asio::io_context& context, tamed::timer_wheel& wheel)
+    {
+        // the context stops when it ran out of work before
+        context.restart();
+
+        while (wheel.size() != 0 && context.run_one_for(1s) != 0) {}
+    }
+
+}
+
+TEST_CASE("timers expire in the order of their deadline")
+{
+    boost::asio::io_context     context;
+    tamed::timer_wheel          wheel{ context.get_executor(), 1ms };
+    std::vector<int>            order;
+    recorded_timer              first{ 1, order };
+    recorded_timer              second{ 2, order };
+    recorded_timer              third{ 3, order };
+
+    wheel.arm(third.entry, 30ms);
+    wheel.arm(first.entry, 10ms);
+    wheel.arm(second.entry, 20ms);
+    REQUIRE(wheel.size() == 3);
+
+    run(context, wheel);
+
+    REQUIRE(order == std::vector<int>{ 1, 2, 3 });
+    REQUIRE(!first.entry.armed());
+}
+
+TEST_CASE("timers beyond the first level cascade down and expire on time")
+{
+    boost::asio::io_context     context;
+    tamed::timer_wheel          wheel{ context.get_executor(), 1ms };
+    std::vector<int>            order;
+    recorded_timer              near{ 1, order };
+    recorded_timer              far{ 2, order };
+    recorded_timer              further{ 3, order };
+
+    // a level has 64 ticks, so these are kept on the coarser level
+    auto start = std::chrono::steady_clock::now();
+    wheel.arm(further.entry, 200ms);
+    wheel.arm(far.entry, 130ms);
+    wheel.arm(near.entry, 70ms);
+
+    run(context, wheel);
+
+    REQUIRE(order == std::vector<int>{ 1, 2, 3 });
+
+    // no timer expires before its deadline
+    REQUIRE(near.time - start >= 70ms);
+    REQUIRE(far.time - start >= 130ms);
+    REQUIRE(further.time - start >= 200ms);
+}
+
+TEST_CASE("timers can be disarmed and armed again")
+{
+    boost::asio::io_context     context;
+    tamed::timer_wheel          wheel{ context.get_executor(), 1ms };
+    std::vector<int>            order;
+    recorded_timer              first{ 1, order };
+    recorded_timer              second{ 2, order };
+
+    SECTION("a disarmed timer does not expire") {
+        wheel.arm(first.entry, 10ms);
+        wheel.arm(second.entry, 20ms);
+        wheel.disarm(first.entry);
+
+        REQUIRE(!first.entry.armed());
+        REQUIRE(wheel.size() == 1);
+
+        run(context, wheel);
+
+        REQUIRE(order == std::vector<int>{ 2 });
+    }
+
+    SECTION("arming an armed timer moves its deadline") {
+        wheel.arm(first.entry, 10ms);
+        wheel.arm(second.entry, 20ms);
+        wheel.arm(first.entry, 100ms);
+
+        REQUIRE(wheel.size() == 2);
+
+        run(context, wheel);
+
+        REQUIRE(order == std::vector<int>{ 2, 1 });
+    }
+
+    SECTION("a timer can be armed again after it expired") {
+        wheel.arm(first.entry, 10ms);
+        run(context, wheel);
+
+        wheel.arm(first.entry, 10ms);
+        run(context, wheel);
+
+        REQUIRE(order == std::vector<int>{ 1, 1 });
+    }
+
+    SECTION("a destroyed timer is disarmed") {
+        auto timer = std::make_unique<recorded_timer>(3, order);
+
+        wheel.arm(timer->entry, 10ms);
+        wheel.arm(second.entry, 20ms);
+        timer.reset();
+
+        REQUIRE(wheel.size() == 1);
+
+        run(context, wheel);
+
+        REQUIRE(order == std::vector<int>{ 2 });
+    }
+}